@@ -2,6 +2,7 @@
 %include exception.i
 
 %{
+#include <algorithm>
 #include <cmath>
 #include <sentencepiece_processor.h>
 #include <sentencepiece_trainer.h>
@@ -84,6 +85,26 @@ PyObject* MakePyOutputBytes(const std::string& output) {
 #endif
 }
 
+// Returns a bytearray holding a copy of `values`, which numpy can wrap
+// without another copy.
+template <typename T>
+PyObject* MakePyOutputBuffer(const std::vector<T>& values) {
+  return PyByteArray_FromStringAndSize(
+      reinterpret_cast<const char *>(values.data()),
+      values.size() * sizeof(T));
+}
+
+// Releases the GIL while in scope. The C++ code in the scope must not
+// touch Python objects.
+class ScopedGILRelease {
+ public:
+  ScopedGILRelease() : state_(PyEval_SaveThread()) {}
+  ~ScopedGILRelease() { PyEval_RestoreThread(state_); }
+
+ private:
+  PyThreadState *state_ = nullptr;
+};
+
 int ToSwigError(sentencepiece::util::StatusCode code) {
   switch (code) {
     case sentencepiece::util::StatusCode::kNotFound:
@@ -164,6 +185,38 @@ class PySentenceIterator : public sentencepiece::SentenceIterator {
   }
 }
 
+// Runs `method` without the GIL, so that Python threads can encode and
+// decode in parallel. The inputs are converted to C++ values before and the
+// outputs to Python objects after the call.
+%define %release_gil(method)
+%exception method {
+  try {
+    {
+      ScopedGILRelease release_gil;
+      $action
+    }
+    ReleaseResultObject(resultobj);
+  }
+  catch (const sentencepiece::util::Status &status) {
+    SWIG_exception(ToSwigError(status.code()), status.ToString().c_str());
+  }
+}
+%enddef
+
+%release_gil(sentencepiece::SentencePieceProcessor::EncodeAsPieces)
+%release_gil(sentencepiece::SentencePieceProcessor::EncodeAsIds)
+%release_gil(sentencepiece::SentencePieceProcessor::NBestEncodeAsPieces)
+%release_gil(sentencepiece::SentencePieceProcessor::NBestEncodeAsIds)
+%release_gil(sentencepiece::SentencePieceProcessor::SampleEncodeAsPieces)
+%release_gil(sentencepiece::SentencePieceProcessor::SampleEncodeAsIds)
+%release_gil(sentencepiece::SentencePieceProcessor::DecodePieces)
+%release_gil(sentencepiece::SentencePieceProcessor::DecodeIds)
+%release_gil(sentencepiece::SentencePieceProcessor::EncodeAsSerializedProto)
+%release_gil(sentencepiece::SentencePieceProcessor::SampleEncodeAsSerializedProto)
+%release_gil(sentencepiece::SentencePieceProcessor::NBestEncodeAsSerializedProto)
+%release_gil(sentencepiece::SentencePieceProcessor::DecodePiecesAsSerializedProto)
+%release_gil(sentencepiece::SentencePieceProcessor::DecodeIdsAsSerializedProto)
+
 %ignore sentencepiece::util::Status;
 %ignore sentencepiece::util::StatusCode;
 %ignore absl::string_view;
@@ -196,6 +249,58 @@ class PySentenceIterator : public sentencepiece::SentenceIterator {
     return $self->Load(arg);
   }
 
+  PyObject *_EncodeAsIdsArray(PyObject *inputs, int num_threads,
+                              bool add_bos, bool add_eos, bool reverse) {
+    // Keeps the references to the input strings while the GIL is released.
+    PyObject *seq = PySequence_Fast(inputs, "not a sequence");
+    if (seq == nullptr) return nullptr;
+    const Py_ssize_t size = PySequence_Fast_GET_SIZE(seq);
+    std::vector<absl::string_view> views(size);
+    std::vector<PyObject *> input_types(size, nullptr);
+    auto release_inputs = [&]() {
+      for (auto *obj : input_types) ReleaseResultObject(obj);
+      Py_DECREF(seq);
+    };
+    for (Py_ssize_t i = 0; i < size; ++i) {
+      const PyInputString ustring(PySequence_Fast_GET_ITEM(seq, i));
+      if (!ustring.IsAvalable()) {
+        release_inputs();
+        PyErr_SetString(PyExc_TypeError, "sequence must contain strings");
+        return nullptr;
+      }
+      views[i] = absl::string_view(ustring.data(), ustring.size());
+      input_types[i] = ustring.input_type();
+    }
+
+    // ids[offsets[i]:offsets[i + 1]] are the ids of inputs[i].
+    std::vector<int32_t> ids;
+    std::vector<int64_t> offsets(1, 0);
+    sentencepiece::util::Status status;
+    {
+      ScopedGILRelease release_gil;
+      std::vector<std::vector<int>> batch;
+      status = $self->EncodeBatch(views, &batch, num_threads);
+      if (status.ok()) {
+        size_t total = 0;
+        for (const auto &v : batch) total += v.size() + add_bos + add_eos;
+        ids.reserve(total);
+        offsets.reserve(batch.size() + 1);
+        for (auto &v : batch) {
+          if (reverse) std::reverse(v.begin(), v.end());
+          if (add_bos) ids.push_back($self->bos_id());
+          ids.insert(ids.end(), v.begin(), v.end());
+          if (add_eos) ids.push_back($self->eos_id());
+          offsets.push_back(ids.size());
+        }
+      }
+    }
+    release_inputs();
+    if (!status.ok()) throw status;
+
+    return Py_BuildValue("(NN)", MakePyOutputBuffer(ids),
+                         MakePyOutputBuffer(offsets));
+  }
+
 %pythoncode {
   def Init(self,
            model_file=None,
@@ -325,6 +430,61 @@ class PySentenceIterator : public sentencepiece::SentenceIterator {
     return _encode(input)
 
 
+  def EncodeAsIdsArray(self,
+                       input,
+                       add_bos=None,
+                       add_eos=None,
+                       reverse=None,
+                       num_threads=0,
+                       padding=False,
+                       pad_id=None):
+    """Encode a list of texts into ids in numpy arrays.
+
+    The texts are encoded on C++ threads without holding the GIL, and no
+    Python list of ints is made. Sampling is not performed.
+
+      Args:
+      input: list of strings.
+      add_bos: Add <s> to the result (Default = false)
+      add_eos: Add </s> to the result (Default = false) <s>/</s> is added after
+        reversing (if enabled).
+      reverse: Reverses the tokenized sequence (Default = false)
+      num_threads: The number of threads. All the hardware threads are used
+        when num_threads <= 0.
+      padding: Returns a padded 2-D array instead of the flat ids.
+      pad_id: The id filling the padded array (Default = pad_id())
+
+      Returns:
+      A pair of int32 ids and int64 offsets, where
+      ids[offsets[i]:offsets[i + 1]] are the ids of input[i]. When padding is
+      True, an int32 array of shape (len(input), max length).
+    """
+
+    import numpy
+
+    if add_bos is None:
+      add_bos = self._add_bos
+    if add_eos is None:
+      add_eos = self._add_eos
+    if reverse is None:
+      reverse = self._reverse
+
+    ids, offsets = self._EncodeAsIdsArray(input, num_threads, bool(add_bos),
+                                          bool(add_eos), bool(reverse))
+    ids = numpy.frombuffer(ids, dtype=numpy.int32)
+    offsets = numpy.frombuffer(offsets, dtype=numpy.int64)
+    if not padding:
+      return ids, offsets
+
+    if pad_id is None:
+      pad_id = self.pad_id()
+    lengths = numpy.diff(offsets)
+    max_length = lengths.max() if len(lengths) > 0 else 0
+    output = numpy.full((len(lengths), max_length), pad_id, dtype=numpy.int32)
+    output[numpy.arange(max_length) < lengths[:, None]] = ids
+    return output
+
+
   def Decode(self, input):
     """Decode processed id or token sequences."""
 
@@ -176,6 +176,9 @@ class SentencePieceProcessor(object):
     def LoadFromFile(self, arg):
         return _sentencepiece.SentencePieceProcessor_LoadFromFile(self, arg)
 
+    def _EncodeAsIdsArray(self, inputs, num_threads, add_bos, add_eos, reverse):
+        return _sentencepiece.SentencePieceProcessor__EncodeAsIdsArray(self, inputs, num_threads, add_bos, add_eos, reverse)
+
     def Init(self,
              model_file=None,
              model_proto=None,
@@ -304,6 +307,61 @@ class SentencePieceProcessor(object):
       return _encode(input)
 
 
+    def EncodeAsIdsArray(self,
+                         input,
+                         add_bos=None,
+                         add_eos=None,
+                         reverse=None,
+                         num_threads=0,
+                         padding=False,
+                         pad_id=None):
+      """Encode a list of texts into ids in numpy arrays.
+
+      The texts are encoded on C++ threads without holding the GIL, and no
+      Python list of ints is made. Sampling is not performed.
+
+        Args:
+        input: list of strings.
+        add_bos: Add <s> to the result (Default = false)
+        add_eos: Add </s> to the result (Default = false) <s>/</s> is added after
+          reversing (if enabled).
+        reverse: Reverses the tokenized sequence (Default = false)
+        num_threads: The number of threads. All the hardware threads are used
+          when num_threads <= 0.
+        padding: Returns a padded 2-D array instead of the flat ids.
+        pad_id: The id filling the padded array (Default = pad_id())
+
+        Returns:
+        A pair of int32 ids and int64 offsets, where
+        ids[offsets[i]:offsets[i + 1]] are the ids of input[i]. When padding is
+        True, an int32 array of shape (len(input), max length).
+      """
+
+      import numpy
+
+      if add_bos is None:
+        add_bos = self._add_bos
+      if add_eos is None:
+        add_eos = self._add_eos
+      if reverse is None:
+        reverse = self._reverse
+
+      ids, offsets = self._EncodeAsIdsArray(input, num_threads, bool(add_bos),
+                                            bool(add_eos), bool(reverse))
+      ids = numpy.frombuffer(ids, dtype=numpy.int32)
+      offsets = numpy.frombuffer(offsets, dtype=numpy.int64)
+      if not padding:
+        return ids, offsets
+
+      if pad_id is None:
+        pad_id = self.pad_id()
+      lengths = numpy.diff(offsets)
+      max_length = lengths.max() if len(lengths) > 0 else 0
+      output = numpy.full((len(lengths), max_length), pad_id, dtype=numpy.int32)
+      output[numpy.arange(max_length) < lengths[:, None]] = ids
+      return output
+
+
     def Decode(self, input):
       """Decode processed id or token sequences."""
 
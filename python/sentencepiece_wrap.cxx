@@ -2773,6 +2773,7 @@ namespace swig {
 }
 
 
+#include <algorithm>
 #include <cmath>
 #include <sentencepiece_processor.h>
 #include <sentencepiece_trainer.h>
@@ -2855,6 +2856,26 @@ PyObject* MakePyOutputBytes(const std::string& output) {
 #endif
 }
 
+// Returns a bytearray holding a copy of `values`, which numpy can wrap
+// without another copy.
+template <typename T>
+PyObject* MakePyOutputBuffer(const std::vector<T>& values) {
+  return PyByteArray_FromStringAndSize(
+      reinterpret_cast<const char *>(values.data()),
+      values.size() * sizeof(T));
+}
+
+// Releases the GIL while in scope. The C++ code in the scope must not
+// touch Python objects.
+class ScopedGILRelease {
+ public:
+  ScopedGILRelease() : state_(PyEval_SaveThread()) {}
+  ~ScopedGILRelease() { PyEval_RestoreThread(state_); }
+
+ private:
+  PyThreadState *state_ = nullptr;
+};
+
 int ToSwigError(sentencepiece::util::StatusCode code) {
   switch (code) {
     case sentencepiece::util::StatusCode::kNotFound:
@@ -3285,6 +3306,70 @@ SWIGINTERNINLINE PyObject*
 SWIGINTERN sentencepiece::util::Status sentencepiece_SentencePieceProcessor_LoadFromFile(sentencepiece::SentencePieceProcessor *self,absl::string_view arg){
     return self->Load(arg);
   }
+
+SWIGINTERN int
+SWIG_AsVal_bool (PyObject *obj, bool *val)
+{
+  int r;
+  if (!PyBool_Check(obj))
+    return SWIG_ERROR;
+  r = PyObject_IsTrue(obj);
+  if (r == -1)
+    return SWIG_ERROR;
+  if (val) *val = r ? true : false;
+  return SWIG_OK;
+}
+
+SWIGINTERN PyObject *sentencepiece_SentencePieceProcessor__EncodeAsIdsArray(sentencepiece::SentencePieceProcessor *self,PyObject *inputs,int num_threads,bool add_bos,bool add_eos,bool reverse){
+    // Keeps the references to the input strings while the GIL is released.
+    PyObject *seq = PySequence_Fast(inputs, "not a sequence");
+    if (seq == nullptr) return nullptr;
+    const Py_ssize_t size = PySequence_Fast_GET_SIZE(seq);
+    std::vector<absl::string_view> views(size);
+    std::vector<PyObject *> input_types(size, nullptr);
+    auto release_inputs = [&]() {
+      for (auto *obj : input_types) ReleaseResultObject(obj);
+      Py_DECREF(seq);
+    };
+    for (Py_ssize_t i = 0; i < size; ++i) {
+      const PyInputString ustring(PySequence_Fast_GET_ITEM(seq, i));
+      if (!ustring.IsAvalable()) {
+        release_inputs();
+        PyErr_SetString(PyExc_TypeError, "sequence must contain strings");
+        return nullptr;
+      }
+      views[i] = absl::string_view(ustring.data(), ustring.size());
+      input_types[i] = ustring.input_type();
+    }
+
+    // ids[offsets[i]:offsets[i + 1]] are the ids of inputs[i].
+    std::vector<int32_t> ids;
+    std::vector<int64_t> offsets(1, 0);
+    sentencepiece::util::Status status;
+    {
+      ScopedGILRelease release_gil;
+      std::vector<std::vector<int>> batch;
+      status = self->EncodeBatch(views, &batch, num_threads);
+      if (status.ok()) {
+        size_t total = 0;
+        for (const auto &v : batch) total += v.size() + add_bos + add_eos;
+        ids.reserve(total);
+        offsets.reserve(batch.size() + 1);
+        for (auto &v : batch) {
+          if (reverse) std::reverse(v.begin(), v.end());
+          if (add_bos) ids.push_back(self->bos_id());
+          ids.insert(ids.end(), v.begin(), v.end());
+          if (add_eos) ids.push_back(self->eos_id());
+          offsets.push_back(ids.size());
+        }
+      }
+    }
+    release_inputs();
+    if (!status.ok()) throw status;
+
+    return Py_BuildValue("(NN)", MakePyOutputBuffer(ids),
+                         MakePyOutputBuffer(offsets));
+  }
 SWIGINTERN void sentencepiece_SentencePieceTrainer__TrainFromString(absl::string_view arg){
     const auto _status = sentencepiece::SentencePieceTrainer::Train(arg);
     if (!_status.ok()) throw _status;
@@ -3753,7 +3838,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_EncodeAsPieces(PyObject *SWIGU
   }
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->EncodeAsPieces(arg2);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->EncodeAsPieces(arg2);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -3799,7 +3887,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_EncodeAsIds(PyObject *SWIGUNUS
   }
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->EncodeAsIds(arg2);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->EncodeAsIds(arg2);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -3852,7 +3943,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_NBestEncodeAsPieces(PyObject *
   arg3 = static_cast< int >(val3);
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->NBestEncodeAsPieces(arg2,arg3);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->NBestEncodeAsPieces(arg2,arg3);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -3910,7 +4004,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_NBestEncodeAsIds(PyObject *SWI
   arg3 = static_cast< int >(val3);
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->NBestEncodeAsIds(arg2,arg3);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->NBestEncodeAsIds(arg2,arg3);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -3975,7 +4072,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_SampleEncodeAsPieces(PyObject
   arg4 = static_cast< float >(val4);
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->SampleEncodeAsPieces(arg2,arg3,arg4);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->SampleEncodeAsPieces(arg2,arg3,arg4);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -4037,7 +4137,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_SampleEncodeAsIds(PyObject *SW
   arg4 = static_cast< float >(val4);
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->SampleEncodeAsIds(arg2,arg3,arg4);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->SampleEncodeAsIds(arg2,arg3,arg4);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -4094,7 +4197,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_DecodePieces(PyObject *SWIGUNU
   }
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->DecodePieces((std::vector< std::string > const &)*arg2);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->DecodePieces((std::vector< std::string > const &)*arg2);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -4154,7 +4260,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_DecodeIds(PyObject *SWIGUNUSED
   }
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->DecodeIds((std::vector< int > const &)*arg2);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->DecodeIds((std::vector< int > const &)*arg2);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -4203,7 +4312,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_EncodeAsSerializedProto(PyObje
   }
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->EncodeAsSerializedProto(arg2);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->EncodeAsSerializedProto(arg2);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -4261,7 +4373,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_SampleEncodeAsSerializedProto(
   arg4 = static_cast< float >(val4);
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->SampleEncodeAsSerializedProto(arg2,arg3,arg4);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->SampleEncodeAsSerializedProto(arg2,arg3,arg4);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -4311,7 +4426,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_NBestEncodeAsSerializedProto(P
   arg3 = static_cast< int >(val3);
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->NBestEncodeAsSerializedProto(arg2,arg3);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->NBestEncodeAsSerializedProto(arg2,arg3);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -4365,7 +4483,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_DecodePiecesAsSerializedProto(
   }
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->DecodePiecesAsSerializedProto((std::vector< std::string > const &)*arg2);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->DecodePiecesAsSerializedProto((std::vector< std::string > const &)*arg2);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -4424,7 +4545,10 @@ SWIGINTERN PyObject *_wrap_SentencePieceProcessor_DecodeIdsAsSerializedProto(PyO
   }
   {
     try {
-      result = ((sentencepiece::SentencePieceProcessor const *)arg1)->DecodeIdsAsSerializedProto((std::vector< int > const &)*arg2);
+      {
+        ScopedGILRelease release_gil;
+        result = ((sentencepiece::SentencePieceProcessor const *)arg1)->DecodeIdsAsSerializedProto((std::vector< int > const &)*arg2);
+      }
       ReleaseResultObject(resultobj);
     }
     catch (const sentencepiece::util::Status &status) {
@@ -4950,6 +5074,70 @@ fail:
 }
 
 
+SWIGINTERN PyObject *_wrap_SentencePieceProcessor__EncodeAsIdsArray(PyObject *SWIGUNUSEDPARM(self), PyObject *args) {
+  PyObject *resultobj = 0;
+  sentencepiece::SentencePieceProcessor *arg1 = (sentencepiece::SentencePieceProcessor *) 0 ;
+  PyObject *arg2 = (PyObject *) 0 ;
+  int arg3 ;
+  bool arg4 ;
+  bool arg5 ;
+  bool arg6 ;
+  void *argp1 = 0 ;
+  int res1 = 0 ;
+  int val3 ;
+  int ecode3 = 0 ;
+  bool val4 ;
+  int ecode4 = 0 ;
+  bool val5 ;
+  int ecode5 = 0 ;
+  bool val6 ;
+  int ecode6 = 0 ;
+  PyObject *swig_obj[6] ;
+  PyObject *result = 0 ;
+  
+  if (!SWIG_Python_UnpackTuple(args, "SentencePieceProcessor__EncodeAsIdsArray", 6, 6, swig_obj)) SWIG_fail;
+  res1 = SWIG_ConvertPtr(swig_obj[0], &argp1,SWIGTYPE_p_sentencepiece__SentencePieceProcessor, 0 |  0 );
+  if (!SWIG_IsOK(res1)) {
+    SWIG_exception_fail(SWIG_ArgError(res1), "in method '" "SentencePieceProcessor__EncodeAsIdsArray" "', argument " "1"" of type '" "sentencepiece::SentencePieceProcessor *""'"); 
+  }
+  arg1 = reinterpret_cast< sentencepiece::SentencePieceProcessor * >(argp1);
+  arg2 = swig_obj[1];
+  ecode3 = SWIG_AsVal_int(swig_obj[2], &val3);
+  if (!SWIG_IsOK(ecode3)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode3), "in method '" "SentencePieceProcessor__EncodeAsIdsArray" "', argument " "3"" of type '" "int""'");
+  } 
+  arg3 = static_cast< int >(val3);
+  ecode4 = SWIG_AsVal_bool(swig_obj[3], &val4);
+  if (!SWIG_IsOK(ecode4)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode4), "in method '" "SentencePieceProcessor__EncodeAsIdsArray" "', argument " "4"" of type '" "bool""'");
+  } 
+  arg4 = static_cast< bool >(val4);
+  ecode5 = SWIG_AsVal_bool(swig_obj[4], &val5);
+  if (!SWIG_IsOK(ecode5)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode5), "in method '" "SentencePieceProcessor__EncodeAsIdsArray" "', argument " "5"" of type '" "bool""'");
+  } 
+  arg5 = static_cast< bool >(val5);
+  ecode6 = SWIG_AsVal_bool(swig_obj[5], &val6);
+  if (!SWIG_IsOK(ecode6)) {
+    SWIG_exception_fail(SWIG_ArgError(ecode6), "in method '" "SentencePieceProcessor__EncodeAsIdsArray" "', argument " "6"" of type '" "bool""'");
+  } 
+  arg6 = static_cast< bool >(val6);
+  {
+    try {
+      result = (PyObject *)sentencepiece_SentencePieceProcessor__EncodeAsIdsArray(arg1,arg2,arg3,arg4,arg5,arg6);
+      ReleaseResultObject(resultobj);
+    }
+    catch (const sentencepiece::util::Status &status) {
+      SWIG_exception(ToSwigError(status.code()), status.ToString().c_str());
+    }
+  }
+  resultobj = result;
+  return resultobj;
+fail:
+  return NULL;
+}
+
+
 SWIGINTERN PyObject *SentencePieceProcessor_swigregister(PyObject *SWIGUNUSEDPARM(self), PyObject *args) {
   PyObject *obj;
   if (!SWIG_Python_UnpackTuple(args, "swigregister", 1, 1, &obj)) return NULL;
@@ -5289,6 +5477,7 @@ static PyMethodDef SwigMethods[] = {
 	 { "SentencePieceProcessor_pad_id", _wrap_SentencePieceProcessor_pad_id, METH_O, NULL},
 	 { "SentencePieceProcessor_serialized_model_proto", _wrap_SentencePieceProcessor_serialized_model_proto, METH_O, NULL},
 	 { "SentencePieceProcessor_LoadFromFile", _wrap_SentencePieceProcessor_LoadFromFile, METH_VARARGS, NULL},
+	 { "SentencePieceProcessor__EncodeAsIdsArray", _wrap_SentencePieceProcessor__EncodeAsIdsArray, METH_VARARGS, NULL},
 	 { "SentencePieceProcessor_swigregister", SentencePieceProcessor_swigregister, METH_O, NULL},
 	 { "SentencePieceProcessor_swiginit", SentencePieceProcessor_swiginit, METH_VARARGS, NULL},
 	 { "SentencePieceTrainer__TrainFromString", _wrap_SentencePieceTrainer__TrainFromString, METH_O, NULL},
@@ -372,6 +372,58 @@ class TestSentencepieceProcessor(unittest.TestCase):
       ++ids2[' '.join(sp.encode('hello world', enable_sampling=False))]
     self.assertEqual(len(ids2), 1)
 
+  def test_encode_as_ids_array(self):
+    try:
+      import numpy
+    except ImportError:
+      self.skipTest('numpy is not installed')
+
+    sp = spm.SentencePieceProcessor(
+        model_file=os.path.join('test', 'test_model.model'))
+    texts = ['hello world', 'Tokyo', '', u'I saw a girl with a telescope.']
+    expected = sp.encode(texts)
+
+    for num_threads in [0, 1, 3]:
+      ids, offsets = sp.encode_as_ids_array(texts, num_threads=num_threads)
+      self.assertEqual(numpy.int32, ids.dtype)
+      self.assertEqual(len(texts) + 1, len(offsets))
+      for i, e in enumerate(expected):
+        self.assertEqual(e, ids[offsets[i]:offsets[i + 1]].tolist())
+
+    expected = sp.encode(texts, add_bos=True, add_eos=True, reverse=True)
+    padded = sp.encode_as_ids_array(
+        texts, add_bos=True, add_eos=True, reverse=True, padding=True)
+    max_length = max(len(e) for e in expected)
+    self.assertEqual((len(texts), max_length), padded.shape)
+    for i, e in enumerate(expected):
+      self.assertEqual(e + [sp.pad_id()] * (max_length - len(e)),
+                       padded[i].tolist())
+
+    self.assertEqual((0,), sp.encode_as_ids_array([])[0].shape)
+    with self.assertRaises(TypeError):
+      sp.encode_as_ids_array([1, 2])
+
+  def test_encode_in_threads(self):
+    import threading
+    sp = spm.SentencePieceProcessor(
+        model_file=os.path.join('test', 'test_model.model'))
+    with codecs.open(os.path.join('test', 'botchan.txt'), 'r', 'utf-8') as f:
+      texts = [line.rstrip() for line in f][:200]
+    expected = [sp.encode(text) for text in texts]
+
+    results = [None] * 4
+
+    def _encode(n):
+      results[n] = [sp.encode(text) for text in texts]
+
+    threads = [threading.Thread(target=_encode, args=(n,)) for n in range(4)]
+    for t in threads:
+      t.start()
+    for t in threads:
+      t.join()
+    for result in results:
+      self.assertEqual(expected, result)
+
 
 def suite():
   suite = unittest.TestSuite()
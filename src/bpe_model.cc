@@ -34,6 +34,12 @@ Model::Model(const ModelProto &model_proto) {
 
 Model::~Model() {}
 
+EncodeResult Model::Encode(absl::string_view normalized) const {
+  return EncodeWords(normalized, [this](absl::string_view word) {
+    return SampleEncode(word, 0.0);
+  });
+}
+
 std::vector<std::pair<absl::string_view, int>> Model::SampleEncode(
     absl::string_view normalized, float alpha) const {
   if (!status().ok() || normalized.empty()) {
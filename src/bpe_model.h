@@ -32,9 +32,7 @@ class Model : public ModelInterface {
   explicit Model(const ModelProto &model_proto);
   ~Model() override;
 
-  EncodeResult Encode(absl::string_view normalized) const override {
-    return SampleEncode(normalized, 0.0);
-  }
+  EncodeResult Encode(absl::string_view normalized) const override;
 
   // Sampling with BPE-dropout: https://arxiv.org/pdf/1910.13267.pdf
   // `alpha` is merge probability in BPE-dropout paper.
@@ -46,6 +44,8 @@ class Model : public ModelInterface {
   bool IsSampleEncodeAvailable() const override { return true; }
 
   bool IsNBestEncodeAvailable() const override { return false; }
+
+  bool IsWordCacheAvailable() const override { return true; }
 };
 }  // namespace bpe
 }  // namespace sentencepiece
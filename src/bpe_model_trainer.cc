@@ -102,7 +102,7 @@ void Trainer::ComputeFreq(Symbol *symbol) const {
       // In "AAAA", the last "AA" can be counted.
       prev_pos = {-1, 0};
     } else {
-      symbol->freq += sentences_[pos.sid].second;
+      symbol->freq += (*sentences_)[pos.sid].second;
       prev_pos = pos;
       ++it;
     }
@@ -190,9 +190,10 @@ util::Status Trainer::Train() {
   }
 
   // Initializes symbols_. symbols_[sid][i] stores an unary symbol.
-  symbols_.resize(sentences_.size());
-  for (size_t i = 0; i < sentences_.size(); ++i) {
-    for (const char32 c : string_util::UTF8ToUnicodeText(sentences_[i].first)) {
+  symbols_.resize(sentences_->size());
+  for (size_t i = 0; i < sentences_->size(); ++i) {
+    for (const char32 c :
+         string_util::UTF8ToUnicodeText((*sentences_)[i].first)) {
       symbols_[i].push_back(GetCharSymbol(c));
     }
   }
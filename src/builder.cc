@@ -204,13 +204,96 @@ util::Status Builder::CompileCharsMap(const CharsMap &chars_map,
 
   absl::string_view trie_blob(static_cast<const char *>(trie.array()),
                               trie.size() * trie.unit_size());
-  *output = Normalizer::EncodePrecompiledCharsMap(trie_blob, normalized);
+  *output = Normalizer::EncodePrecompiledCharsMap(
+      trie_blob, normalized, MakeCharsMapTable(chars_map, normalized2pos));
 
   LOG(INFO) << "Generated normalizer blob. size=" << output->size();
 
   return util::OkStatus();
 }
 
+// static
+std::string Builder::MakeCharsMapTable(
+    const CharsMap &chars_map, const std::map<Chars, int> &normalized2pos) {
+  // The code points which start longer rules refer to the trie. The identical
+  // blocks of 256 code points are shared.
+  for (const auto &p : normalized2pos) {
+    if (p.second >= Normalizer::kTableUseTrie) return "";
+  }
+
+  std::vector<uint16> table(0x10000, Normalizer::kTableNoRule);
+  for (const auto &p : chars_map) {
+    const char32 c = p.first[0];
+    if (c > 0xFFFF) continue;
+    if (p.first.size() > 1) {
+      table[c] = Normalizer::kTableUseTrie;
+    } else if (table[c] != Normalizer::kTableUseTrie) {
+      table[c] = port::FindOrDie(normalized2pos, p.second);
+    }
+  }
+
+  return PackCharsMapTable(table);
+}
+
+// static
+std::string Builder::MakeCharsMapTable(absl::string_view trie_blob) {
+  Darts::DoubleArray trie;
+  trie.set_array(const_cast<char *>(trie_blob.data()),
+                 trie_blob.size() / trie.unit_size());
+
+  std::vector<uint16> table(0x10000, Normalizer::kTableNoRule);
+  for (char32 c = 1; c < 0x10000; ++c) {
+    if (c >= 0xD800 && c < 0xE000) continue;
+    std::string key = string_util::UnicodeCharToUTF8(c);
+    size_t node_pos = 0, key_pos = 0;
+    const int result =
+        trie.traverse(key.data(), node_pos, key_pos, key.size());
+    if (result < -1) continue;  // No rule starts with c.
+
+    // Longer rules start with c if the node has a child.
+    bool has_child = false;
+    key.push_back(0);
+    for (int b = 0; b <= 255 && !has_child; ++b) {
+      key.back() = static_cast<char>(b);
+      size_t child_node_pos = node_pos, child_key_pos = key_pos;
+      has_child = trie.traverse(key.data(), child_node_pos, child_key_pos,
+                                key.size()) >= -1;
+    }
+    if (has_child) {
+      table[c] = Normalizer::kTableUseTrie;
+    } else if (result >= Normalizer::kTableUseTrie) {
+      return "";
+    } else {
+      table[c] = result;
+    }
+  }
+
+  return PackCharsMapTable(table);
+}
+
+// static
+std::string Builder::PackCharsMapTable(const std::vector<uint16> &table) {
+  std::vector<uint16> index(256);
+  std::vector<uint16> blocks;
+  std::map<std::vector<uint16>, uint16> block2index;
+  for (size_t i = 0; i < index.size(); ++i) {
+    const std::vector<uint16> block(table.begin() + i * 256,
+                                    table.begin() + (i + 1) * 256);
+    auto it = block2index.find(block);
+    if (it == block2index.end()) {
+      it = block2index.emplace(block, block2index.size()).first;
+      blocks.insert(blocks.end(), block.begin(), block.end());
+    }
+    index[i] = it->second;
+  }
+
+  std::string blob(reinterpret_cast<const char *>(index.data()),
+                   index.size() * sizeof(uint16));
+  blob.append(reinterpret_cast<const char *>(blocks.data()),
+              blocks.size() * sizeof(uint16));
+  return blob;
+}
+
 // static
 util::Status Builder::DecompileCharsMap(absl::string_view blob,
                                         Builder::CharsMap *chars_map) {
@@ -277,7 +360,16 @@ util::Status Builder::GetPrecompiledCharsMap(const std::string &name,
   for (size_t i = 0; i < kNormalizationRules_size; ++i) {
     const auto *blob = &kNormalizationRules_blob[i];
     if (blob->name == name) {
-      output->assign(blob->data, blob->size);
+      const absl::string_view data(blob->data, blob->size);
+      absl::string_view trie_blob, normalized, table_blob;
+      RETURN_IF_ERROR(Normalizer::DecodePrecompiledCharsMap(
+          data, &trie_blob, &normalized, &table_blob));
+      if (table_blob.empty()) {
+        *output = Normalizer::EncodePrecompiledCharsMap(
+            trie_blob, normalized, MakeCharsMapTable(trie_blob));
+      } else {
+        output->assign(data.data(), data.size());
+      }
       return util::OkStatus();
     }
   }
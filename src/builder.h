@@ -50,7 +50,8 @@ class Builder {
   static util::Status DecompileCharsMap(absl::string_view blob,
                                         CharsMap *chars_map);
 
-  // Returns a pre-compiled binary index with `name`.
+  // Returns a pre-compiled binary index with `name`. The table of the rules
+  // of the single code points is added if the built-in index lacks it.
   static util::Status GetPrecompiledCharsMap(const std::string &name,
                                              std::string *output);
 
@@ -122,6 +123,19 @@ class Builder {
   // When char_maps have "aa" => "bb" and "a" => "b", the first
   // rule is not necessary since the second rule can cover the first rule.
   static util::Status RemoveRedundantMap(CharsMap *chars_map);
+
+  // Makes the two-level table of the rules of the single code points in the
+  // BMP, where `normalized2pos` gives the positions of the targets in the
+  // normalized string. Returns an empty string if the positions do not fit.
+  static std::string MakeCharsMapTable(
+      const CharsMap &chars_map, const std::map<Chars, int> &normalized2pos);
+
+  // Same as above, but reads the rules from the trie of a compiled index.
+  static std::string MakeCharsMapTable(absl::string_view trie_blob);
+
+  // Shares the identical blocks of 256 code points in `table`, which has
+  // the values of all the code points in the BMP.
+  static std::string PackCharsMapTable(const std::vector<uint16> &table);
 };
 }  // namespace normalizer
 }  // namespace sentencepiece
@@ -273,6 +273,15 @@ const int TrainerSpec::kEosPieceFieldNumber;
 const int TrainerSpec::kPadPieceFieldNumber;
 const int TrainerSpec::kUnkSurfaceFieldNumber;
 const int TrainerSpec::kTrainExtremelyLargeCorpusFieldNumber;
+const int TrainerSpec::kEmConvergenceThresholdFieldNumber;
+const int TrainerSpec::kAdaptiveShrinkingFieldNumber;
+const int TrainerSpec::kMinShrinkingFactorFieldNumber;
+const int TrainerSpec::kSnapshotVocabSizesFieldNumber;
+const int TrainerSpec::kCheckpointIntervalFieldNumber;
+const int TrainerSpec::kSaveCorpusCacheFieldNumber;
+const int TrainerSpec::kResumeFromCheckpointFieldNumber;
+const int TrainerSpec::kTrainingStatsFileFieldNumber;
+const int TrainerSpec::kJointSeedSentencepiecesFieldNumber;
 #endif  // !defined(_MSC_VER) || _MSC_VER >= 1900
 
 TrainerSpec::TrainerSpec()
@@ -289,7 +298,8 @@ TrainerSpec::TrainerSpec(const TrainerSpec& from)
       input_(from.input_),
       accept_language_(from.accept_language_),
       control_symbols_(from.control_symbols_),
-      user_defined_symbols_(from.user_defined_symbols_) {
+      user_defined_symbols_(from.user_defined_symbols_),
+      snapshot_vocab_sizes_(from.snapshot_vocab_sizes_) {
   _internal_metadata_.MergeFrom(from._internal_metadata_);
   _extensions_.MergeFrom(from._extensions_);
   model_prefix_.UnsafeSetDefault(&::google::protobuf::internal::GetEmptyStringAlreadyInited());
@@ -324,9 +334,13 @@ TrainerSpec::TrainerSpec(const TrainerSpec& from)
   if (from.has_pad_piece()) {
     pad_piece_.AssignWithDefault(&::sentencepiece::TrainerSpec::_i_give_permission_to_break_this_code_default_pad_piece_.get(), from.pad_piece_);
   }
+  training_stats_file_.UnsafeSetDefault(&::google::protobuf::internal::GetEmptyStringAlreadyInited());
+  if (from.has_training_stats_file()) {
+    training_stats_file_.AssignWithDefault(&::google::protobuf::internal::GetEmptyStringAlreadyInited(), from.training_stats_file_);
+  }
   ::memcpy(&self_test_sample_size_, &from.self_test_sample_size_,
-    static_cast<size_t>(reinterpret_cast<char*>(&pad_id_) -
-    reinterpret_cast<char*>(&self_test_sample_size_)) + sizeof(pad_id_));
+    static_cast<size_t>(reinterpret_cast<char*>(&joint_seed_sentencepieces_) -
+    reinterpret_cast<char*>(&self_test_sample_size_)) + sizeof(joint_seed_sentencepieces_));
   // @@protoc_insertion_point(copy_constructor:sentencepiece.TrainerSpec)
 }
 
@@ -339,6 +353,7 @@ void TrainerSpec::SharedCtor() {
   bos_piece_.UnsafeSetDefault(&::sentencepiece::TrainerSpec::_i_give_permission_to_break_this_code_default_bos_piece_.get());
   eos_piece_.UnsafeSetDefault(&::sentencepiece::TrainerSpec::_i_give_permission_to_break_this_code_default_eos_piece_.get());
   pad_piece_.UnsafeSetDefault(&::sentencepiece::TrainerSpec::_i_give_permission_to_break_this_code_default_pad_piece_.get());
+  training_stats_file_.UnsafeSetDefault(&::google::protobuf::internal::GetEmptyStringAlreadyInited());
   ::memset(&self_test_sample_size_, 0, static_cast<size_t>(
       reinterpret_cast<char*>(&train_extremely_large_corpus_) -
       reinterpret_cast<char*>(&self_test_sample_size_)) + sizeof(train_extremely_large_corpus_));
@@ -360,6 +375,13 @@ void TrainerSpec::SharedCtor() {
   bos_id_ = 1;
   eos_id_ = 2;
   pad_id_ = -1;
+  em_convergence_threshold_ = 0;
+  adaptive_shrinking_ = false;
+  min_shrinking_factor_ = 0.5f;
+  checkpoint_interval_ = 0;
+  save_corpus_cache_ = false;
+  resume_from_checkpoint_ = false;
+  joint_seed_sentencepieces_ = false;
 }
 
 TrainerSpec::~TrainerSpec() {
@@ -376,6 +398,7 @@ void TrainerSpec::SharedDtor() {
   bos_piece_.DestroyNoArena(&::sentencepiece::TrainerSpec::_i_give_permission_to_break_this_code_default_bos_piece_.get());
   eos_piece_.DestroyNoArena(&::sentencepiece::TrainerSpec::_i_give_permission_to_break_this_code_default_eos_piece_.get());
   pad_piece_.DestroyNoArena(&::sentencepiece::TrainerSpec::_i_give_permission_to_break_this_code_default_pad_piece_.get());
+  training_stats_file_.DestroyNoArena(&::google::protobuf::internal::GetEmptyStringAlreadyInited());
 }
 
 void TrainerSpec::SetCachedSize(int size) const {
@@ -398,6 +421,7 @@ void TrainerSpec::Clear() {
   accept_language_.Clear();
   control_symbols_.Clear();
   user_defined_symbols_.Clear();
+  snapshot_vocab_sizes_.Clear();
   cached_has_bits = _has_bits_[0];
   if (cached_has_bits & 255u) {
     if (cached_has_bits & 0x00000001u) {
@@ -452,11 +476,23 @@ void TrainerSpec::Clear() {
     vocabulary_output_piece_score_ = true;
   }
   cached_has_bits = _has_bits_[1];
-  if (cached_has_bits & 15u) {
+  if (cached_has_bits & 255u) {
     hard_vocab_limit_ = true;
     bos_id_ = 1;
     eos_id_ = 2;
     pad_id_ = -1;
+    em_convergence_threshold_ = 0;
+    adaptive_shrinking_ = false;
+    min_shrinking_factor_ = 0.5f;
+    checkpoint_interval_ = 0;
+  }
+  if (cached_has_bits & 3840u) {
+    if (cached_has_bits & 0x00000400u) {
+      training_stats_file_.ClearNonDefaultToEmptyNoArena();
+    }
+    save_corpus_cache_ = false;
+    resume_from_checkpoint_ = false;
+    joint_seed_sentencepieces_ = false;
   }
   _has_bits_.Clear();
   _internal_metadata_.Clear();
@@ -1021,6 +1057,135 @@ bool TrainerSpec::MergePartialFromCodedStream(
         break;
       }
 
+      // optional float em_convergence_threshold = 50 [default = 0];
+      case 50: {
+        if (static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(149u /* 405 & 0xFF */)) {
+          set_has_em_convergence_threshold();
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   float, ::google::protobuf::internal::WireFormatLite::TYPE_FLOAT>(
+                 input, &em_convergence_threshold_)));
+        } else {
+          goto handle_unusual;
+        }
+        break;
+      }
+
+      // optional bool adaptive_shrinking = 51 [default = false];
+      case 51: {
+        if (static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(152u /* 408 & 0xFF */)) {
+          set_has_adaptive_shrinking();
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &adaptive_shrinking_)));
+        } else {
+          goto handle_unusual;
+        }
+        break;
+      }
+
+      // optional float min_shrinking_factor = 52 [default = 0.5];
+      case 52: {
+        if (static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(165u /* 421 & 0xFF */)) {
+          set_has_min_shrinking_factor();
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   float, ::google::protobuf::internal::WireFormatLite::TYPE_FLOAT>(
+                 input, &min_shrinking_factor_)));
+        } else {
+          goto handle_unusual;
+        }
+        break;
+      }
+
+      // repeated int32 snapshot_vocab_sizes = 53;
+      case 53: {
+        if (static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(168u /* 424 & 0xFF */)) {
+          DO_((::google::protobuf::internal::WireFormatLite::ReadRepeatedPrimitive<
+                   ::google::protobuf::int32, ::google::protobuf::internal::WireFormatLite::TYPE_INT32>(
+                 2, 424u, input, this->mutable_snapshot_vocab_sizes())));
+        } else if (
+            static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(170u /* 426 & 0xFF */)) {
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPackedPrimitiveNoInline<
+                   ::google::protobuf::int32, ::google::protobuf::internal::WireFormatLite::TYPE_INT32>(
+                 input, this->mutable_snapshot_vocab_sizes())));
+        } else {
+          goto handle_unusual;
+        }
+        break;
+      }
+
+      // optional int32 checkpoint_interval = 54 [default = 0];
+      case 54: {
+        if (static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(176u /* 432 & 0xFF */)) {
+          set_has_checkpoint_interval();
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::int32, ::google::protobuf::internal::WireFormatLite::TYPE_INT32>(
+                 input, &checkpoint_interval_)));
+        } else {
+          goto handle_unusual;
+        }
+        break;
+      }
+
+      // optional bool save_corpus_cache = 55 [default = false];
+      case 55: {
+        if (static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(184u /* 440 & 0xFF */)) {
+          set_has_save_corpus_cache();
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &save_corpus_cache_)));
+        } else {
+          goto handle_unusual;
+        }
+        break;
+      }
+
+      // optional bool resume_from_checkpoint = 56 [default = false];
+      case 56: {
+        if (static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(192u /* 448 & 0xFF */)) {
+          set_has_resume_from_checkpoint();
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &resume_from_checkpoint_)));
+        } else {
+          goto handle_unusual;
+        }
+        break;
+      }
+
+      // optional string training_stats_file = 57;
+      case 57: {
+        if (static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(202u /* 458 & 0xFF */)) {
+          DO_(::google::protobuf::internal::WireFormatLite::ReadString(
+                input, this->mutable_training_stats_file()));
+        } else {
+          goto handle_unusual;
+        }
+        break;
+      }
+
+      // optional bool joint_seed_sentencepieces = 58 [default = false];
+      case 58: {
+        if (static_cast< ::google::protobuf::uint8>(tag) ==
+            static_cast< ::google::protobuf::uint8>(208u /* 464 & 0xFF */)) {
+          set_has_joint_seed_sentencepieces();
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &joint_seed_sentencepieces_)));
+        } else {
+          goto handle_unusual;
+        }
+        break;
+      }
+
       default: {
       handle_unusual:
         if (tag == 0) {
@@ -1271,6 +1436,54 @@ void TrainerSpec::SerializeWithCachedSizes(
     ::google::protobuf::internal::WireFormatLite::WriteBool(49, this->train_extremely_large_corpus(), output);
   }
 
+  cached_has_bits = _has_bits_[1];
+  // optional float em_convergence_threshold = 50 [default = 0];
+  if (cached_has_bits & 0x00000010u) {
+    ::google::protobuf::internal::WireFormatLite::WriteFloat(50, this->em_convergence_threshold(), output);
+  }
+
+  // optional bool adaptive_shrinking = 51 [default = false];
+  if (cached_has_bits & 0x00000020u) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(51, this->adaptive_shrinking(), output);
+  }
+
+  // optional float min_shrinking_factor = 52 [default = 0.5];
+  if (cached_has_bits & 0x00000040u) {
+    ::google::protobuf::internal::WireFormatLite::WriteFloat(52, this->min_shrinking_factor(), output);
+  }
+
+  // repeated int32 snapshot_vocab_sizes = 53;
+  for (int i = 0, n = this->snapshot_vocab_sizes_size(); i < n; i++) {
+    ::google::protobuf::internal::WireFormatLite::WriteInt32(
+      53, this->snapshot_vocab_sizes(i), output);
+  }
+
+  // optional int32 checkpoint_interval = 54 [default = 0];
+  if (cached_has_bits & 0x00000080u) {
+    ::google::protobuf::internal::WireFormatLite::WriteInt32(54, this->checkpoint_interval(), output);
+  }
+
+  // optional bool save_corpus_cache = 55 [default = false];
+  if (cached_has_bits & 0x00000100u) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(55, this->save_corpus_cache(), output);
+  }
+
+  // optional bool resume_from_checkpoint = 56 [default = false];
+  if (cached_has_bits & 0x00000200u) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(56, this->resume_from_checkpoint(), output);
+  }
+
+  // optional string training_stats_file = 57;
+  if (cached_has_bits & 0x00000400u) {
+    ::google::protobuf::internal::WireFormatLite::WriteStringMaybeAliased(
+      57, this->training_stats_file(), output);
+  }
+
+  // optional bool joint_seed_sentencepieces = 58 [default = false];
+  if (cached_has_bits & 0x00000800u) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(58, this->joint_seed_sentencepieces(), output);
+  }
+
   // Extension range [200, 536870912)
   _extensions_.SerializeWithCachedSizes(
       200, 536870912, output);
@@ -1320,6 +1533,15 @@ size_t TrainerSpec::ByteSizeLong() const {
       this->user_defined_symbols(i));
   }
 
+  // repeated int32 snapshot_vocab_sizes = 53;
+  {
+    size_t data_size = ::google::protobuf::internal::WireFormatLite::
+      Int32Size(this->snapshot_vocab_sizes_);
+    total_size += 2 *
+                  ::google::protobuf::internal::FromIntSize(this->snapshot_vocab_sizes_size());
+    total_size += data_size;
+  }
+
   if (_has_bits_[0 / 32] & 255u) {
     // optional string model_prefix = 2;
     if (has_model_prefix()) {
@@ -1527,7 +1749,7 @@ size_t TrainerSpec::ByteSizeLong() const {
     }
 
   }
-  if (_has_bits_[32 / 32] & 15u) {
+  if (_has_bits_[32 / 32] & 255u) {
     // optional bool hard_vocab_limit = 33 [default = true];
     if (has_hard_vocab_limit()) {
       total_size += 2 + 1;
@@ -1554,6 +1776,52 @@ size_t TrainerSpec::ByteSizeLong() const {
           this->pad_id());
     }
 
+    // optional float em_convergence_threshold = 50 [default = 0];
+    if (has_em_convergence_threshold()) {
+      total_size += 2 + 4;
+    }
+
+    // optional bool adaptive_shrinking = 51 [default = false];
+    if (has_adaptive_shrinking()) {
+      total_size += 2 + 1;
+    }
+
+    // optional float min_shrinking_factor = 52 [default = 0.5];
+    if (has_min_shrinking_factor()) {
+      total_size += 2 + 4;
+    }
+
+    // optional int32 checkpoint_interval = 54 [default = 0];
+    if (has_checkpoint_interval()) {
+      total_size += 2 +
+        ::google::protobuf::internal::WireFormatLite::Int32Size(
+          this->checkpoint_interval());
+    }
+
+  }
+  if (_has_bits_[40 / 32] & 3840u) {
+    // optional bool save_corpus_cache = 55 [default = false];
+    if (has_save_corpus_cache()) {
+      total_size += 2 + 1;
+    }
+
+    // optional bool resume_from_checkpoint = 56 [default = false];
+    if (has_resume_from_checkpoint()) {
+      total_size += 2 + 1;
+    }
+
+    // optional string training_stats_file = 57;
+    if (has_training_stats_file()) {
+      total_size += 2 +
+        ::google::protobuf::internal::WireFormatLite::StringSize(
+          this->training_stats_file());
+    }
+
+    // optional bool joint_seed_sentencepieces = 58 [default = false];
+    if (has_joint_seed_sentencepieces()) {
+      total_size += 2 + 1;
+    }
+
   }
   int cached_size = ::google::protobuf::internal::ToCachedSize(total_size);
   SetCachedSize(cached_size);
@@ -1577,6 +1845,7 @@ void TrainerSpec::MergeFrom(const TrainerSpec& from) {
   accept_language_.MergeFrom(from.accept_language_);
   control_symbols_.MergeFrom(from.control_symbols_);
   user_defined_symbols_.MergeFrom(from.user_defined_symbols_);
+  snapshot_vocab_sizes_.MergeFrom(from.snapshot_vocab_sizes_);
   cached_has_bits = from._has_bits_[0];
   if (cached_has_bits & 255u) {
     if (cached_has_bits & 0x00000001u) {
@@ -1694,7 +1963,7 @@ void TrainerSpec::MergeFrom(const TrainerSpec& from) {
     _has_bits_[0] |= cached_has_bits;
   }
   cached_has_bits = from._has_bits_[1];
-  if (cached_has_bits & 15u) {
+  if (cached_has_bits & 255u) {
     if (cached_has_bits & 0x00000001u) {
       hard_vocab_limit_ = from.hard_vocab_limit_;
     }
@@ -1707,6 +1976,34 @@ void TrainerSpec::MergeFrom(const TrainerSpec& from) {
     if (cached_has_bits & 0x00000008u) {
       pad_id_ = from.pad_id_;
     }
+    if (cached_has_bits & 0x00000010u) {
+      em_convergence_threshold_ = from.em_convergence_threshold_;
+    }
+    if (cached_has_bits & 0x00000020u) {
+      adaptive_shrinking_ = from.adaptive_shrinking_;
+    }
+    if (cached_has_bits & 0x00000040u) {
+      min_shrinking_factor_ = from.min_shrinking_factor_;
+    }
+    if (cached_has_bits & 0x00000080u) {
+      checkpoint_interval_ = from.checkpoint_interval_;
+    }
+    _has_bits_[1] |= cached_has_bits;
+  }
+  if (cached_has_bits & 3840u) {
+    if (cached_has_bits & 0x00000100u) {
+      save_corpus_cache_ = from.save_corpus_cache_;
+    }
+    if (cached_has_bits & 0x00000200u) {
+      resume_from_checkpoint_ = from.resume_from_checkpoint_;
+    }
+    if (cached_has_bits & 0x00000400u) {
+      set_has_training_stats_file();
+      training_stats_file_.AssignWithDefault(&::google::protobuf::internal::GetEmptyStringAlreadyInited(), from.training_stats_file_);
+    }
+    if (cached_has_bits & 0x00000800u) {
+      joint_seed_sentencepieces_ = from.joint_seed_sentencepieces_;
+    }
     _has_bits_[1] |= cached_has_bits;
   }
 }
@@ -1736,6 +2033,7 @@ void TrainerSpec::InternalSwap(TrainerSpec* other) {
   accept_language_.InternalSwap(CastToBase(&other->accept_language_));
   control_symbols_.InternalSwap(CastToBase(&other->control_symbols_));
   user_defined_symbols_.InternalSwap(CastToBase(&other->user_defined_symbols_));
+  snapshot_vocab_sizes_.InternalSwap(&other->snapshot_vocab_sizes_);
   model_prefix_.Swap(&other->model_prefix_, &::google::protobuf::internal::GetEmptyStringAlreadyInited(),
     GetArenaNoVirtual());
   input_format_.Swap(&other->input_format_, &::google::protobuf::internal::GetEmptyStringAlreadyInited(),
@@ -1752,6 +2050,8 @@ void TrainerSpec::InternalSwap(TrainerSpec* other) {
     GetArenaNoVirtual());
   pad_piece_.Swap(&other->pad_piece_, &::sentencepiece::TrainerSpec::_i_give_permission_to_break_this_code_default_pad_piece_.get(),
     GetArenaNoVirtual());
+  training_stats_file_.Swap(&other->training_stats_file_, &::google::protobuf::internal::GetEmptyStringAlreadyInited(),
+    GetArenaNoVirtual());
   swap(self_test_sample_size_, other->self_test_sample_size_);
   swap(input_sentence_size_, other->input_sentence_size_);
   swap(mining_sentence_size_, other->mining_sentence_size_);
@@ -1780,6 +2080,13 @@ void TrainerSpec::InternalSwap(TrainerSpec* other) {
   swap(bos_id_, other->bos_id_);
   swap(eos_id_, other->eos_id_);
   swap(pad_id_, other->pad_id_);
+  swap(em_convergence_threshold_, other->em_convergence_threshold_);
+  swap(adaptive_shrinking_, other->adaptive_shrinking_);
+  swap(min_shrinking_factor_, other->min_shrinking_factor_);
+  swap(checkpoint_interval_, other->checkpoint_interval_);
+  swap(save_corpus_cache_, other->save_corpus_cache_);
+  swap(resume_from_checkpoint_, other->resume_from_checkpoint_);
+  swap(joint_seed_sentencepieces_, other->joint_seed_sentencepieces_);
   swap(_has_bits_[0], other->_has_bits_[0]);
   swap(_has_bits_[1], other->_has_bits_[1]);
   _internal_metadata_.Swap(&other->_internal_metadata_);
@@ -617,6 +617,82 @@ class TrainerSpec : public ::google::protobuf::MessageLite /* @@protoc_insertion
   ::google::protobuf::int32 pad_id() const;
   void set_pad_id(::google::protobuf::int32 value);
 
+  // optional float em_convergence_threshold = 50 [default = 0];
+  bool has_em_convergence_threshold() const;
+  void clear_em_convergence_threshold();
+  static const int kEmConvergenceThresholdFieldNumber = 50;
+  float em_convergence_threshold() const;
+  void set_em_convergence_threshold(float value);
+
+  // optional bool adaptive_shrinking = 51 [default = false];
+  bool has_adaptive_shrinking() const;
+  void clear_adaptive_shrinking();
+  static const int kAdaptiveShrinkingFieldNumber = 51;
+  bool adaptive_shrinking() const;
+  void set_adaptive_shrinking(bool value);
+
+  // optional float min_shrinking_factor = 52 [default = 0.5];
+  bool has_min_shrinking_factor() const;
+  void clear_min_shrinking_factor();
+  static const int kMinShrinkingFactorFieldNumber = 52;
+  float min_shrinking_factor() const;
+  void set_min_shrinking_factor(float value);
+
+  // repeated int32 snapshot_vocab_sizes = 53;
+  int snapshot_vocab_sizes_size() const;
+  void clear_snapshot_vocab_sizes();
+  static const int kSnapshotVocabSizesFieldNumber = 53;
+  ::google::protobuf::int32 snapshot_vocab_sizes(int index) const;
+  void set_snapshot_vocab_sizes(int index, ::google::protobuf::int32 value);
+  void add_snapshot_vocab_sizes(::google::protobuf::int32 value);
+  const ::google::protobuf::RepeatedField< ::google::protobuf::int32 >&
+      snapshot_vocab_sizes() const;
+  ::google::protobuf::RepeatedField< ::google::protobuf::int32 >*
+      mutable_snapshot_vocab_sizes();
+
+  // optional int32 checkpoint_interval = 54 [default = 0];
+  bool has_checkpoint_interval() const;
+  void clear_checkpoint_interval();
+  static const int kCheckpointIntervalFieldNumber = 54;
+  ::google::protobuf::int32 checkpoint_interval() const;
+  void set_checkpoint_interval(::google::protobuf::int32 value);
+
+  // optional bool save_corpus_cache = 55 [default = false];
+  bool has_save_corpus_cache() const;
+  void clear_save_corpus_cache();
+  static const int kSaveCorpusCacheFieldNumber = 55;
+  bool save_corpus_cache() const;
+  void set_save_corpus_cache(bool value);
+
+  // optional bool resume_from_checkpoint = 56 [default = false];
+  bool has_resume_from_checkpoint() const;
+  void clear_resume_from_checkpoint();
+  static const int kResumeFromCheckpointFieldNumber = 56;
+  bool resume_from_checkpoint() const;
+  void set_resume_from_checkpoint(bool value);
+
+  // optional string training_stats_file = 57;
+  bool has_training_stats_file() const;
+  void clear_training_stats_file();
+  static const int kTrainingStatsFileFieldNumber = 57;
+  const ::std::string& training_stats_file() const;
+  void set_training_stats_file(const ::std::string& value);
+  #if LANG_CXX11
+  void set_training_stats_file(::std::string&& value);
+  #endif
+  void set_training_stats_file(const char* value);
+  void set_training_stats_file(const char* value, size_t size);
+  ::std::string* mutable_training_stats_file();
+  ::std::string* release_training_stats_file();
+  void set_allocated_training_stats_file(::std::string* training_stats_file);
+
+  // optional bool joint_seed_sentencepieces = 58 [default = false];
+  bool has_joint_seed_sentencepieces() const;
+  void clear_joint_seed_sentencepieces();
+  static const int kJointSeedSentencepiecesFieldNumber = 58;
+  bool joint_seed_sentencepieces() const;
+  void set_joint_seed_sentencepieces(bool value);
+
   GOOGLE_PROTOBUF_EXTENSION_ACCESSORS(TrainerSpec)
   // @@protoc_insertion_point(class_scope:sentencepiece.TrainerSpec)
  private:
@@ -692,6 +768,22 @@ class TrainerSpec : public ::google::protobuf::MessageLite /* @@protoc_insertion
   void clear_has_unk_surface();
   void set_has_train_extremely_large_corpus();
   void clear_has_train_extremely_large_corpus();
+  void set_has_em_convergence_threshold();
+  void clear_has_em_convergence_threshold();
+  void set_has_adaptive_shrinking();
+  void clear_has_adaptive_shrinking();
+  void set_has_min_shrinking_factor();
+  void clear_has_min_shrinking_factor();
+  void set_has_checkpoint_interval();
+  void clear_has_checkpoint_interval();
+  void set_has_save_corpus_cache();
+  void clear_has_save_corpus_cache();
+  void set_has_resume_from_checkpoint();
+  void clear_has_resume_from_checkpoint();
+  void set_has_training_stats_file();
+  void clear_has_training_stats_file();
+  void set_has_joint_seed_sentencepieces();
+  void clear_has_joint_seed_sentencepieces();
 
   ::google::protobuf::internal::ExtensionSet _extensions_;
 
@@ -752,6 +844,15 @@ class TrainerSpec : public ::google::protobuf::MessageLite /* @@protoc_insertion
   ::google::protobuf::int32 bos_id_;
   ::google::protobuf::int32 eos_id_;
   ::google::protobuf::int32 pad_id_;
+  float em_convergence_threshold_;
+  bool adaptive_shrinking_;
+  float min_shrinking_factor_;
+  ::google::protobuf::int32 checkpoint_interval_;
+  bool save_corpus_cache_;
+  bool resume_from_checkpoint_;
+  bool joint_seed_sentencepieces_;
+  ::google::protobuf::internal::ArenaStringPtr training_stats_file_;
+  ::google::protobuf::RepeatedField< ::google::protobuf::int32 > snapshot_vocab_sizes_;
   mutable ::google::protobuf::internal::CachedSize _cached_size_;
   friend struct ::protobuf_sentencepiece_5fmodel_2eproto::TableStruct;
 };
@@ -3036,6 +3137,270 @@ inline void TrainerSpec::set_train_extremely_large_corpus(bool value) {
   // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.train_extremely_large_corpus)
 }
 
+// optional float em_convergence_threshold = 50 [default = 0];
+inline bool TrainerSpec::has_em_convergence_threshold() const {
+  return (_has_bits_[1] & 0x00000010u) != 0;
+}
+inline void TrainerSpec::set_has_em_convergence_threshold() {
+  _has_bits_[1] |= 0x00000010u;
+}
+inline void TrainerSpec::clear_has_em_convergence_threshold() {
+  _has_bits_[1] &= ~0x00000010u;
+}
+inline void TrainerSpec::clear_em_convergence_threshold() {
+  em_convergence_threshold_ = 0;
+  clear_has_em_convergence_threshold();
+}
+inline float TrainerSpec::em_convergence_threshold() const {
+  // @@protoc_insertion_point(field_get:sentencepiece.TrainerSpec.em_convergence_threshold)
+  return em_convergence_threshold_;
+}
+inline void TrainerSpec::set_em_convergence_threshold(float value) {
+  set_has_em_convergence_threshold();
+  em_convergence_threshold_ = value;
+  // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.em_convergence_threshold)
+}
+
+// optional bool adaptive_shrinking = 51 [default = false];
+inline bool TrainerSpec::has_adaptive_shrinking() const {
+  return (_has_bits_[1] & 0x00000020u) != 0;
+}
+inline void TrainerSpec::set_has_adaptive_shrinking() {
+  _has_bits_[1] |= 0x00000020u;
+}
+inline void TrainerSpec::clear_has_adaptive_shrinking() {
+  _has_bits_[1] &= ~0x00000020u;
+}
+inline void TrainerSpec::clear_adaptive_shrinking() {
+  adaptive_shrinking_ = false;
+  clear_has_adaptive_shrinking();
+}
+inline bool TrainerSpec::adaptive_shrinking() const {
+  // @@protoc_insertion_point(field_get:sentencepiece.TrainerSpec.adaptive_shrinking)
+  return adaptive_shrinking_;
+}
+inline void TrainerSpec::set_adaptive_shrinking(bool value) {
+  set_has_adaptive_shrinking();
+  adaptive_shrinking_ = value;
+  // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.adaptive_shrinking)
+}
+
+// optional float min_shrinking_factor = 52 [default = 0.5];
+inline bool TrainerSpec::has_min_shrinking_factor() const {
+  return (_has_bits_[1] & 0x00000040u) != 0;
+}
+inline void TrainerSpec::set_has_min_shrinking_factor() {
+  _has_bits_[1] |= 0x00000040u;
+}
+inline void TrainerSpec::clear_has_min_shrinking_factor() {
+  _has_bits_[1] &= ~0x00000040u;
+}
+inline void TrainerSpec::clear_min_shrinking_factor() {
+  min_shrinking_factor_ = 0.5f;
+  clear_has_min_shrinking_factor();
+}
+inline float TrainerSpec::min_shrinking_factor() const {
+  // @@protoc_insertion_point(field_get:sentencepiece.TrainerSpec.min_shrinking_factor)
+  return min_shrinking_factor_;
+}
+inline void TrainerSpec::set_min_shrinking_factor(float value) {
+  set_has_min_shrinking_factor();
+  min_shrinking_factor_ = value;
+  // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.min_shrinking_factor)
+}
+
+// repeated int32 snapshot_vocab_sizes = 53;
+inline int TrainerSpec::snapshot_vocab_sizes_size() const {
+  return snapshot_vocab_sizes_.size();
+}
+inline void TrainerSpec::clear_snapshot_vocab_sizes() {
+  snapshot_vocab_sizes_.Clear();
+}
+inline ::google::protobuf::int32 TrainerSpec::snapshot_vocab_sizes(int index) const {
+  // @@protoc_insertion_point(field_get:sentencepiece.TrainerSpec.snapshot_vocab_sizes)
+  return snapshot_vocab_sizes_.Get(index);
+}
+inline void TrainerSpec::set_snapshot_vocab_sizes(int index, ::google::protobuf::int32 value) {
+  snapshot_vocab_sizes_.Set(index, value);
+  // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.snapshot_vocab_sizes)
+}
+inline void TrainerSpec::add_snapshot_vocab_sizes(::google::protobuf::int32 value) {
+  snapshot_vocab_sizes_.Add(value);
+  // @@protoc_insertion_point(field_add:sentencepiece.TrainerSpec.snapshot_vocab_sizes)
+}
+inline const ::google::protobuf::RepeatedField< ::google::protobuf::int32 >&
+TrainerSpec::snapshot_vocab_sizes() const {
+  // @@protoc_insertion_point(field_list:sentencepiece.TrainerSpec.snapshot_vocab_sizes)
+  return snapshot_vocab_sizes_;
+}
+inline ::google::protobuf::RepeatedField< ::google::protobuf::int32 >*
+TrainerSpec::mutable_snapshot_vocab_sizes() {
+  // @@protoc_insertion_point(field_mutable_list:sentencepiece.TrainerSpec.snapshot_vocab_sizes)
+  return &snapshot_vocab_sizes_;
+}
+
+// optional int32 checkpoint_interval = 54 [default = 0];
+inline bool TrainerSpec::has_checkpoint_interval() const {
+  return (_has_bits_[1] & 0x00000080u) != 0;
+}
+inline void TrainerSpec::set_has_checkpoint_interval() {
+  _has_bits_[1] |= 0x00000080u;
+}
+inline void TrainerSpec::clear_has_checkpoint_interval() {
+  _has_bits_[1] &= ~0x00000080u;
+}
+inline void TrainerSpec::clear_checkpoint_interval() {
+  checkpoint_interval_ = 0;
+  clear_has_checkpoint_interval();
+}
+inline ::google::protobuf::int32 TrainerSpec::checkpoint_interval() const {
+  // @@protoc_insertion_point(field_get:sentencepiece.TrainerSpec.checkpoint_interval)
+  return checkpoint_interval_;
+}
+inline void TrainerSpec::set_checkpoint_interval(::google::protobuf::int32 value) {
+  set_has_checkpoint_interval();
+  checkpoint_interval_ = value;
+  // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.checkpoint_interval)
+}
+
+// optional bool save_corpus_cache = 55 [default = false];
+inline bool TrainerSpec::has_save_corpus_cache() const {
+  return (_has_bits_[1] & 0x00000100u) != 0;
+}
+inline void TrainerSpec::set_has_save_corpus_cache() {
+  _has_bits_[1] |= 0x00000100u;
+}
+inline void TrainerSpec::clear_has_save_corpus_cache() {
+  _has_bits_[1] &= ~0x00000100u;
+}
+inline void TrainerSpec::clear_save_corpus_cache() {
+  save_corpus_cache_ = false;
+  clear_has_save_corpus_cache();
+}
+inline bool TrainerSpec::save_corpus_cache() const {
+  // @@protoc_insertion_point(field_get:sentencepiece.TrainerSpec.save_corpus_cache)
+  return save_corpus_cache_;
+}
+inline void TrainerSpec::set_save_corpus_cache(bool value) {
+  set_has_save_corpus_cache();
+  save_corpus_cache_ = value;
+  // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.save_corpus_cache)
+}
+
+// optional bool resume_from_checkpoint = 56 [default = false];
+inline bool TrainerSpec::has_resume_from_checkpoint() const {
+  return (_has_bits_[1] & 0x00000200u) != 0;
+}
+inline void TrainerSpec::set_has_resume_from_checkpoint() {
+  _has_bits_[1] |= 0x00000200u;
+}
+inline void TrainerSpec::clear_has_resume_from_checkpoint() {
+  _has_bits_[1] &= ~0x00000200u;
+}
+inline void TrainerSpec::clear_resume_from_checkpoint() {
+  resume_from_checkpoint_ = false;
+  clear_has_resume_from_checkpoint();
+}
+inline bool TrainerSpec::resume_from_checkpoint() const {
+  // @@protoc_insertion_point(field_get:sentencepiece.TrainerSpec.resume_from_checkpoint)
+  return resume_from_checkpoint_;
+}
+inline void TrainerSpec::set_resume_from_checkpoint(bool value) {
+  set_has_resume_from_checkpoint();
+  resume_from_checkpoint_ = value;
+  // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.resume_from_checkpoint)
+}
+
+// optional string training_stats_file = 57;
+inline bool TrainerSpec::has_training_stats_file() const {
+  return (_has_bits_[1] & 0x00000400u) != 0;
+}
+inline void TrainerSpec::set_has_training_stats_file() {
+  _has_bits_[1] |= 0x00000400u;
+}
+inline void TrainerSpec::clear_has_training_stats_file() {
+  _has_bits_[1] &= ~0x00000400u;
+}
+inline void TrainerSpec::clear_training_stats_file() {
+  training_stats_file_.ClearToEmptyNoArena(&::google::protobuf::internal::GetEmptyStringAlreadyInited());
+  clear_has_training_stats_file();
+}
+inline const ::std::string& TrainerSpec::training_stats_file() const {
+  // @@protoc_insertion_point(field_get:sentencepiece.TrainerSpec.training_stats_file)
+  return training_stats_file_.GetNoArena();
+}
+inline void TrainerSpec::set_training_stats_file(const ::std::string& value) {
+  set_has_training_stats_file();
+  training_stats_file_.SetNoArena(&::google::protobuf::internal::GetEmptyStringAlreadyInited(), value);
+  // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.training_stats_file)
+}
+#if LANG_CXX11
+inline void TrainerSpec::set_training_stats_file(::std::string&& value) {
+  set_has_training_stats_file();
+  training_stats_file_.SetNoArena(
+    &::google::protobuf::internal::GetEmptyStringAlreadyInited(), ::std::move(value));
+  // @@protoc_insertion_point(field_set_rvalue:sentencepiece.TrainerSpec.training_stats_file)
+}
+#endif
+inline void TrainerSpec::set_training_stats_file(const char* value) {
+  GOOGLE_DCHECK(value != NULL);
+  set_has_training_stats_file();
+  training_stats_file_.SetNoArena(&::google::protobuf::internal::GetEmptyStringAlreadyInited(), ::std::string(value));
+  // @@protoc_insertion_point(field_set_char:sentencepiece.TrainerSpec.training_stats_file)
+}
+inline void TrainerSpec::set_training_stats_file(const char* value, size_t size) {
+  set_has_training_stats_file();
+  training_stats_file_.SetNoArena(&::google::protobuf::internal::GetEmptyStringAlreadyInited(),
+      ::std::string(reinterpret_cast<const char*>(value), size));
+  // @@protoc_insertion_point(field_set_pointer:sentencepiece.TrainerSpec.training_stats_file)
+}
+inline ::std::string* TrainerSpec::mutable_training_stats_file() {
+  set_has_training_stats_file();
+  // @@protoc_insertion_point(field_mutable:sentencepiece.TrainerSpec.training_stats_file)
+  return training_stats_file_.MutableNoArena(&::google::protobuf::internal::GetEmptyStringAlreadyInited());
+}
+inline ::std::string* TrainerSpec::release_training_stats_file() {
+  // @@protoc_insertion_point(field_release:sentencepiece.TrainerSpec.training_stats_file)
+  if (!has_training_stats_file()) {
+    return NULL;
+  }
+  clear_has_training_stats_file();
+  return training_stats_file_.ReleaseNonDefaultNoArena(&::google::protobuf::internal::GetEmptyStringAlreadyInited());
+}
+inline void TrainerSpec::set_allocated_training_stats_file(::std::string* training_stats_file) {
+  if (training_stats_file != NULL) {
+    set_has_training_stats_file();
+  } else {
+    clear_has_training_stats_file();
+  }
+  training_stats_file_.SetAllocatedNoArena(&::google::protobuf::internal::GetEmptyStringAlreadyInited(), training_stats_file);
+  // @@protoc_insertion_point(field_set_allocated:sentencepiece.TrainerSpec.training_stats_file)
+}
+
+// optional bool joint_seed_sentencepieces = 58 [default = false];
+inline bool TrainerSpec::has_joint_seed_sentencepieces() const {
+  return (_has_bits_[1] & 0x00000800u) != 0;
+}
+inline void TrainerSpec::set_has_joint_seed_sentencepieces() {
+  _has_bits_[1] |= 0x00000800u;
+}
+inline void TrainerSpec::clear_has_joint_seed_sentencepieces() {
+  _has_bits_[1] &= ~0x00000800u;
+}
+inline void TrainerSpec::clear_joint_seed_sentencepieces() {
+  joint_seed_sentencepieces_ = false;
+  clear_has_joint_seed_sentencepieces();
+}
+inline bool TrainerSpec::joint_seed_sentencepieces() const {
+  // @@protoc_insertion_point(field_get:sentencepiece.TrainerSpec.joint_seed_sentencepieces)
+  return joint_seed_sentencepieces_;
+}
+inline void TrainerSpec::set_joint_seed_sentencepieces(bool value) {
+  set_has_joint_seed_sentencepieces();
+  joint_seed_sentencepieces_ = value;
+  // @@protoc_insertion_point(field_set:sentencepiece.TrainerSpec.joint_seed_sentencepieces)
+}
+
 // -------------------------------------------------------------------
 
 // NormalizerSpec
@@ -12,12 +12,20 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.!
 
+#include <cstdio>
 #include <iostream>
 
 #include "filesystem.h"
 #include "third_party/absl/memory/memory.h"
 #include "util.h"
 
+#ifndef OS_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // OS_WIN
+
 #if defined(OS_WIN) && defined(UNICODE) && defined(_UNICODE)
 #define WPATH(path) (::sentencepiece::win32::Utf8ToWide(path).c_str())
 #else
@@ -67,12 +75,12 @@ class PosixReadableFile : public ReadableFile {
 
 class PosixWritableFile : public WritableFile {
  public:
-  PosixWritableFile(absl::string_view filename, bool is_binary = false)
+  PosixWritableFile(absl::string_view filename, bool is_binary = false,
+                    bool append = false)
       : os_(filename.empty()
                 ? &std::cout
                 : new std::ofstream(WPATH(filename.data()),
-                                    is_binary ? std::ios::binary | std::ios::out
-                                              : std::ios::out)) {
+                                    OpenMode(is_binary, append))) {
     if (!*os_)
       status_ =
           util::StatusBuilder(util::StatusCode::kPermissionDenied, GTL_LOC)
@@ -93,12 +101,81 @@ class PosixWritableFile : public WritableFile {
   bool WriteLine(absl::string_view text) { return Write(text) && Write("\n"); }
 
  private:
+  static std::ios::openmode OpenMode(bool is_binary, bool append) {
+    std::ios::openmode mode = std::ios::out;
+    if (is_binary) mode |= std::ios::binary;
+    if (append) mode |= std::ios::app;
+    return mode;
+  }
+
   util::Status status_;
   std::ostream *os_;
 };
 
+#ifdef OS_WIN
+class InMemoryMappedFile : public MappedFile {
+ public:
+  explicit InMemoryMappedFile(absl::string_view filename) {
+    PosixReadableFile input(filename, true);
+    status_ = input.status();
+    if (status_.ok() && !input.ReadAll(&data_))
+      status_ = util::StatusBuilder(util::StatusCode::kInternal, GTL_LOC)
+                << "\"" << filename.data() << "\": cannot read the file.";
+  }
+
+  util::Status status() const { return status_; }
+  absl::string_view data() const { return data_; }
+
+ private:
+  util::Status status_;
+  std::string data_;
+};
+#else
+class PosixMappedFile : public MappedFile {
+ public:
+  explicit PosixMappedFile(absl::string_view filename) {
+    const std::string path(filename.data(), filename.size());
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+      status_ = util::StatusBuilder(util::StatusCode::kNotFound, GTL_LOC)
+                << "\"" << path << "\": " << util::StrError(errno);
+    } else if (st.st_size > 0) {
+      void *addr =
+          ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+        status_ = util::StatusBuilder(util::StatusCode::kInternal, GTL_LOC)
+                  << "\"" << path << "\": " << util::StrError(errno);
+      } else {
+        ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+        data_ = absl::string_view(static_cast<const char *>(addr),
+                                  st.st_size);
+      }
+    }
+    if (fd >= 0) ::close(fd);
+  }
+
+  ~PosixMappedFile() {
+    if (!data_.empty())
+      ::munmap(const_cast<char *>(data_.data()), data_.size());
+  }
+
+  util::Status status() const { return status_; }
+  absl::string_view data() const { return data_; }
+
+ private:
+  util::Status status_;
+  absl::string_view data_;
+};
+#endif  // OS_WIN
+
 using DefaultReadableFile = PosixReadableFile;
 using DefaultWritableFile = PosixWritableFile;
+#ifdef OS_WIN
+using DefaultMappedFile = InMemoryMappedFile;
+#else
+using DefaultMappedFile = PosixMappedFile;
+#endif  // OS_WIN
 
 std::unique_ptr<ReadableFile> NewReadableFile(absl::string_view filename,
                                               bool is_binary) {
@@ -110,5 +187,32 @@ std::unique_ptr<WritableFile> NewWritableFile(absl::string_view filename,
   return absl::make_unique<DefaultWritableFile>(filename, is_binary);
 }
 
+std::unique_ptr<WritableFile> NewAppendableFile(absl::string_view filename,
+                                                bool is_binary) {
+  return absl::make_unique<DefaultWritableFile>(filename, is_binary, true);
+}
+
+std::unique_ptr<MappedFile> NewMappedFile(absl::string_view filename) {
+  return absl::make_unique<DefaultMappedFile>(filename);
+}
+
+util::Status WriteFileAtomically(absl::string_view filename,
+                                 absl::string_view data) {
+  const std::string target(filename.data(), filename.size());
+  const std::string tmp = target + ".tmp";
+  {
+    auto output = NewWritableFile(tmp, true);
+    RETURN_IF_ERROR(output->status());
+    CHECK_OR_RETURN(output->Write(data)) << "Failed to write " << tmp;
+  }
+  // rename() does not replace an existing file on Windows.
+  if (std::rename(tmp.c_str(), target.c_str()) != 0) {
+    std::remove(target.c_str());
+    CHECK_EQ_OR_RETURN(0, std::rename(tmp.c_str(), target.c_str()))
+        << "Failed to rename " << tmp << ": " << util::StrError(errno);
+  }
+  return util::OkStatus();
+}
+
 }  // namespace filesystem
 }  // namespace sentencepiece
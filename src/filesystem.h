@@ -49,11 +49,33 @@ class WritableFile {
   virtual bool WriteLine(absl::string_view text) = 0;
 };
 
+// Read-only view of a whole file. The file is memory-mapped where mmap is
+// available and read into memory otherwise.
+class MappedFile {
+ public:
+  MappedFile() {}
+  virtual ~MappedFile() {}
+
+  virtual util::Status status() const = 0;
+  virtual absl::string_view data() const = 0;
+};
+
 std::unique_ptr<ReadableFile> NewReadableFile(absl::string_view filename,
                                               bool is_binary = false);
+std::unique_ptr<MappedFile> NewMappedFile(absl::string_view filename);
 std::unique_ptr<WritableFile> NewWritableFile(absl::string_view filename,
                                               bool is_binary = false);
 
+// Same as NewWritableFile(), but writes after the existing contents of
+// |filename| instead of truncating it.
+std::unique_ptr<WritableFile> NewAppendableFile(absl::string_view filename,
+                                                bool is_binary = false);
+
+// Writes |data| to |filename| via a temporary file, so that an interrupted
+// write never leaves a truncated |filename| behind.
+util::Status WriteFileAtomically(absl::string_view filename,
+                                 absl::string_view data);
+
 }  // namespace filesystem
 }  // namespace sentencepiece
 #endif  // FILESYSTEM_H_
@@ -51,4 +51,30 @@ TEST(UtilTest, FilesystemInvalidFileTest) {
   EXPECT_FALSE(input->status().ok());
 }
 
+TEST(UtilTest, MappedFileTest) {
+  const std::string filename =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "test_file");
+  {
+    auto output = filesystem::NewWritableFile(filename);
+    output->WriteLine("This");
+    output->WriteLine("is a test");
+  }
+
+  {
+    auto input = filesystem::NewMappedFile(filename);
+    EXPECT_TRUE(input->status().ok());
+    EXPECT_EQ("This\nis a test\n", input->data());
+  }
+
+  {
+    filesystem::NewWritableFile(filename);
+    auto input = filesystem::NewMappedFile(filename);
+    EXPECT_TRUE(input->status().ok());
+    EXPECT_TRUE(input->data().empty());
+  }
+
+  auto input = filesystem::NewMappedFile("__UNKNOWN__FILE__");
+  EXPECT_FALSE(input->status().ok());
+}
+
 }  // namespace sentencepiece
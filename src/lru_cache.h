@@ -0,0 +1,168 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#ifndef LRU_CACHE_H_
+#define LRU_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "common.h"
+#include "sentencepiece_processor.h"
+#include "third_party/absl/strings/string_view.h"
+#include "util.h"
+
+namespace sentencepiece {
+
+// A bounded LRU cache from a string to a Value, shared by the encoding
+// threads. The entries are spread over shards with their own locks, so that
+// the threads rarely wait for each other.
+template <typename Value>
+class ShardedLruCache {
+ public:
+  // Memory of an entry besides the key and the value, i.e., the list node,
+  // the hash map node and its bucket.
+  static constexpr size_t kEntryOverhead = 96;
+
+  // |max_bytes| bounds the memory used by the entries.
+  explicit ShardedLruCache(size_t max_bytes)
+      : max_bytes_(max_bytes),
+        max_shard_bytes_(max_bytes / kNumShards),
+        shards_(new Shard[kNumShards]) {}
+
+  ShardedLruCache(const ShardedLruCache &) = delete;
+  ShardedLruCache &operator=(const ShardedLruCache &) = delete;
+
+  // Calls |found| with the value of |key| under the lock of its shard and
+  // returns its result, which tells whether the value is usable. A false
+  // result is counted as a miss.
+  template <typename Found>
+  bool Lookup(absl::string_view key, const Found &found) {
+    Shard *shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    const auto it = shard->index.find(key);
+    if (it == shard->index.end() || !found(it->second->value)) {
+      ++shard->misses;
+      return false;
+    }
+    ++shard->hits;
+    shard->entries.splice(shard->entries.begin(), shard->entries, it->second);
+    return true;
+  }
+
+  // Caches |value| of |key|, replacing the old one. |value_bytes| is the
+  // memory used by |value|. Returns the number of the evicted entries.
+  size_t Insert(absl::string_view key, Value value, size_t value_bytes) {
+    const size_t bytes = kEntryOverhead + key.size() + value_bytes;
+    if (bytes > max_shard_bytes_) return 0;
+
+    Shard *shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    const auto it = shard->index.find(key);
+    if (it != shard->index.end()) Erase(shard, it->second);
+
+    size_t evictions = 0;
+    while (!shard->entries.empty() &&
+           shard->bytes + bytes > max_shard_bytes_) {
+      Erase(shard, std::prev(shard->entries.end()));
+      ++evictions;
+    }
+    shard->evictions += evictions;
+
+    shard->entries.emplace_front();
+    auto &entry = shard->entries.front();
+    entry.key.assign(key.data(), key.size());
+    entry.value = std::move(value);
+    entry.bytes = bytes;
+    shard->index.emplace(entry.key, shard->entries.begin());
+    shard->bytes += bytes;
+    return evictions;
+  }
+
+  // Removes all the entries. The counters of the statistics are kept.
+  void Clear() {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      shards_[i].index.clear();
+      shards_[i].entries.clear();
+      shards_[i].bytes = 0;
+    }
+  }
+
+  CacheStats GetStats() const {
+    CacheStats stats;
+    for (size_t i = 0; i < kNumShards; ++i) {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      stats.hits += shards_[i].hits;
+      stats.misses += shards_[i].misses;
+      stats.evictions += shards_[i].evictions;
+      stats.entries += shards_[i].entries.size();
+      stats.bytes += shards_[i].bytes;
+    }
+    return stats;
+  }
+
+  size_t max_bytes() const { return max_bytes_; }
+
+ private:
+  static constexpr size_t kNumShards = 16;
+
+  struct Entry {
+    std::string key;
+    Value value;
+    size_t bytes = 0;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  struct Shard {
+    mutable std::mutex mutex;
+    // The most recently used entry comes first.
+    EntryList entries;
+    // Keys are views into Entry::key.
+    std::unordered_map<absl::string_view, typename EntryList::iterator,
+                       string_util::string_view_hash>
+        index;
+    size_t bytes = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+  };
+
+  Shard *GetShard(absl::string_view key) const {
+    // The hash map of the shard takes the lower bits of the same hash.
+    const uint64 hash = string_util::string_view_hash()(key);
+    return &shards_[(hash * 0x9E3779B97F4A7C15ULL) >> 60];
+  }
+
+  static void Erase(Shard *shard, typename EntryList::iterator it) {
+    shard->index.erase(it->key);
+    shard->bytes -= it->bytes;
+    shard->entries.erase(it);
+  }
+
+  const size_t max_bytes_;
+  const size_t max_shard_bytes_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+template <typename Value>
+constexpr size_t ShardedLruCache<Value>::kEntryOverhead;
+template <typename Value>
+constexpr size_t ShardedLruCache<Value>::kNumShards;
+
+}  // namespace sentencepiece
+#endif  // LRU_CACHE_H_
@@ -0,0 +1,252 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "metrics.h"
+
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#ifdef SPM_NO_THREADLOCAL
+#include <pthread.h>
+#endif
+
+namespace sentencepiece {
+namespace metrics {
+namespace {
+
+void AddTo(const ThreadStats &stats, Snapshot *snapshot) {
+  for (int c = 0; c < NUM_COUNTERS; ++c) {
+    snapshot->counters[c] += stats.counters[c].load(std::memory_order_relaxed);
+  }
+  for (int s = 0; s < NUM_STAGES; ++s) {
+    for (int b = 0; b < kNumBuckets; ++b) {
+      snapshot->buckets[s][b] +=
+          stats.buckets[s][b].load(std::memory_order_relaxed);
+    }
+    snapshot->sum_nanos[s] +=
+        stats.sum_nanos[s].load(std::memory_order_relaxed);
+  }
+}
+
+// Keeps the stats of the live threads and the sum of the exited threads.
+// The lock is taken only when a thread starts or exits and on export.
+class Registry {
+ public:
+  void Register(ThreadStats *stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    live_.insert(stats);
+  }
+
+  void Unregister(ThreadStats *stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AddTo(*stats, &exited_);
+    live_.erase(stats);
+  }
+
+  Snapshot GetSnapshot() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot snapshot = exited_;
+    for (const auto *stats : live_) AddTo(*stats, &snapshot);
+    return snapshot;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::set<ThreadStats *> live_;
+  Snapshot exited_;
+};
+
+// Never deleted, as threads may exit after the static destructors.
+Registry *GetRegistry() {
+  static Registry *registry = new Registry;
+  return registry;
+}
+
+class ThreadStatsHolder {
+ public:
+  ThreadStatsHolder() { GetRegistry()->Register(&stats_); }
+  ~ThreadStatsHolder() { GetRegistry()->Unregister(&stats_); }
+
+  ThreadStats *get() { return &stats_; }
+
+ private:
+  ThreadStats stats_;
+};
+
+// Upper bound of |bucket| in microseconds.
+uint64 BucketBound(int bucket) { return static_cast<uint64>(1) << bucket; }
+}  // namespace
+
+int GetBucket(uint64 nanos) {
+  uint64 usec = nanos / 1000;
+  int bucket = 0;
+  while (usec > 0 && bucket < kNumBuckets - 1) {
+    usec >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+const char *CounterName(Counter counter) {
+  static const char *kNames[] = {
+      "encode_calls",       "decode_calls",       "input_bytes",
+      "output_pieces",      "unknown_pieces",     "trie_lookups",
+      "lattice_nodes",      "word_cache_hits",    "word_cache_misses",
+      "word_cache_evictions", "sentence_cache_hits", "sentence_cache_misses",
+      "sentence_cache_evictions"};
+  static_assert(sizeof(kNames) / sizeof(kNames[0]) == NUM_COUNTERS,
+                "CounterName");
+  return kNames[counter];
+}
+
+const char *StageName(Stage stage) {
+  static const char *kNames[] = {"normalize", "encode", "populate", "decode"};
+  static_assert(sizeof(kNames) / sizeof(kNames[0]) == NUM_STAGES,
+                "StageName");
+  return kNames[stage];
+}
+
+ThreadStats::ThreadStats() {
+  for (auto &value : counters) value.store(0);
+  for (auto &stage : buckets) {
+    for (auto &value : stage) value.store(0);
+  }
+  for (auto &value : sum_nanos) value.store(0);
+}
+
+#ifdef SPM_NO_THREADLOCAL
+namespace {
+class ThreadStatsStorage {
+ public:
+  ThreadStatsStorage() { pthread_key_create(&key_, &ThreadStatsStorage::Delete); }
+  virtual ~ThreadStatsStorage() { pthread_key_delete(key_); }
+
+  ThreadStats *Get() {
+    auto *result = static_cast<ThreadStatsHolder *>(pthread_getspecific(key_));
+    if (result == nullptr) {
+      result = new ThreadStatsHolder;
+      pthread_setspecific(key_, result);
+    }
+    return result->get();
+  }
+
+ private:
+  static void Delete(void *value) {
+    delete static_cast<ThreadStatsHolder *>(value);
+  }
+  pthread_key_t key_;
+};
+}  // namespace
+
+ThreadStats *GetThreadStats() {
+  static ThreadStatsStorage *storage = new ThreadStatsStorage;
+  return storage->Get();
+}
+#else
+ThreadStats *GetThreadStats() {
+  thread_local static ThreadStatsHolder holder;
+  return holder.get();
+}
+#endif
+
+uint64 Snapshot::count(Stage stage) const {
+  uint64 count = 0;
+  for (int b = 0; b < kNumBuckets; ++b) count += buckets[stage][b];
+  return count;
+}
+
+Snapshot GetSnapshot() { return GetRegistry()->GetSnapshot(); }
+
+std::string ToPrometheus(const Snapshot &snapshot) {
+  std::ostringstream os;
+  for (int c = 0; c < NUM_COUNTERS; ++c) {
+    const std::string name =
+        std::string("sentencepiece_") + CounterName(static_cast<Counter>(c)) +
+        "_total";
+    os << "# TYPE " << name << " counter\n"
+       << name << " " << snapshot.counters[c] << "\n";
+  }
+
+  const char *name = "sentencepiece_stage_latency_seconds";
+  os << "# TYPE " << name << " histogram\n";
+  for (int s = 0; s < NUM_STAGES; ++s) {
+    const std::string stage = StageName(static_cast<Stage>(s));
+    uint64 cumulative = 0;
+    for (int b = 0; b < kNumBuckets; ++b) {
+      cumulative += snapshot.buckets[s][b];
+      os << name << "_bucket{stage=\"" << stage << "\",le=\"";
+      if (b == kNumBuckets - 1) {
+        os << "+Inf";
+      } else {
+        os << BucketBound(b) * 1e-6;
+      }
+      os << "\"} " << cumulative << "\n";
+    }
+    os << name << "_sum{stage=\"" << stage << "\"} "
+       << snapshot.sum_nanos[s] * 1e-9 << "\n";
+    os << name << "_count{stage=\"" << stage << "\"} " << cumulative << "\n";
+  }
+  return os.str();
+}
+
+std::string ToJson(const Snapshot &snapshot) {
+  std::ostringstream os;
+  os << "{\"counters\": {";
+  for (int c = 0; c < NUM_COUNTERS; ++c) {
+    os << (c == 0 ? "" : ", ") << "\"" << CounterName(static_cast<Counter>(c))
+       << "\": " << snapshot.counters[c];
+  }
+  const uint64 pieces = snapshot.counters[OUTPUT_PIECES];
+  os << "}, \"unknown_rate\": "
+     << (pieces == 0 ? 0.0
+                     : static_cast<double>(snapshot.counters[UNKNOWN_PIECES]) /
+                           pieces)
+     << ", \"stages\": {";
+  for (int s = 0; s < NUM_STAGES; ++s) {
+    const Stage stage = static_cast<Stage>(s);
+    os << (s == 0 ? "" : ", ") << "\"" << StageName(stage)
+       << "\": {\"count\": " << snapshot.count(stage)
+       << ", \"sum_sec\": " << snapshot.sum_nanos[s] * 1e-9
+       << ", \"buckets\": [";
+    // Each bucket has its own count, i.e., they are not cumulative.
+    for (int b = 0; b < kNumBuckets; ++b) {
+      os << (b == 0 ? "" : ", ") << "{\"le_usec\": ";
+      if (b == kNumBuckets - 1) {
+        os << "null";
+      } else {
+        os << BucketBound(b);
+      }
+      os << ", \"count\": " << snapshot.buckets[s][b] << "}";
+    }
+    os << "]}";
+  }
+  os << "}}";
+  return os.str();
+}
+
+bool IsEnabled() {
+#ifdef SPM_ENABLE_METRICS
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::string ToPrometheus() {
+  return IsEnabled() ? ToPrometheus(GetSnapshot()) : "";
+}
+
+std::string ToJson() { return IsEnabled() ? ToJson(GetSnapshot()) : ""; }
+
+}  // namespace metrics
+}  // namespace sentencepiece
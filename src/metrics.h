@@ -0,0 +1,159 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "common.h"
+#include "sentencepiece_processor.h"
+
+// Hot-path counters and stage timers of the encoder and decoder.
+//
+// The recording macros below are compiled only when SPM_ENABLE_METRICS is
+// defined, i.e., cmake -DSPM_ENABLE_METRICS=ON. Otherwise they expand to
+// dead code and the arguments are never evaluated.
+//
+// Each thread records into its own ThreadStats without locks. The stats of
+// all threads are summed when exported by metrics::ToPrometheus() or
+// metrics::ToJson() declared in sentencepiece_processor.h.
+//
+//   SPM_METRICS_ADD(INPUT_BYTES, input.size());
+//   {
+//     SPM_METRICS_TIMER(NORMALIZE);
+//     ...
+//   }
+
+namespace sentencepiece {
+namespace metrics {
+
+enum Counter {
+  ENCODE_CALLS = 0,
+  DECODE_CALLS,
+  INPUT_BYTES,     // of the encoded sentences.
+  OUTPUT_PIECES,   // of the encoded sentences.
+  UNKNOWN_PIECES,  // of the encoded sentences.
+  TRIE_LOOKUPS,    // prefix searches from each position of the lattice.
+  LATTICE_NODES,   // nodes found by the prefix searches.
+  WORD_CACHE_HITS,
+  WORD_CACHE_MISSES,
+  WORD_CACHE_EVICTIONS,
+  SENTENCE_CACHE_HITS,
+  SENTENCE_CACHE_MISSES,
+  SENTENCE_CACHE_EVICTIONS,
+  NUM_COUNTERS
+};
+
+enum Stage { NORMALIZE = 0, ENCODE, POPULATE, DECODE, NUM_STAGES };
+
+// Latencies are counted in log2 buckets. Bucket 0 holds < 1us and bucket
+// b holds [2^(b-1), 2^b) us. The last bucket holds the rest.
+constexpr int kNumBuckets = 24;
+
+// Returns the bucket of |nanos|.
+int GetBucket(uint64 nanos);
+
+// Returns the names used in the exported metrics.
+const char *CounterName(Counter counter);
+const char *StageName(Stage stage);
+
+// Counters and latency histograms written by one thread.
+// Only the owner thread writes them, so that a relaxed load and store is
+// enough. Readers may see a slightly old value.
+struct ThreadStats {
+  ThreadStats();
+
+  std::atomic<uint64> counters[NUM_COUNTERS];
+  std::atomic<uint64> buckets[NUM_STAGES][kNumBuckets];
+  std::atomic<uint64> sum_nanos[NUM_STAGES];
+
+  void Add(Counter counter, uint64 value) {
+    Increment(&counters[counter], value);
+  }
+
+  void Record(Stage stage, uint64 nanos) {
+    Increment(&buckets[stage][GetBucket(nanos)], 1);
+    Increment(&sum_nanos[stage], nanos);
+  }
+
+ private:
+  static void Increment(std::atomic<uint64> *value, uint64 delta) {
+    value->store(value->load(std::memory_order_relaxed) + delta,
+                 std::memory_order_relaxed);
+  }
+};
+
+// Returns the stats of the current thread. When the thread exits, its
+// stats are folded into the registry, so that nothing is lost.
+ThreadStats *GetThreadStats();
+
+// The sum of the stats of all threads.
+struct Snapshot {
+  uint64 counters[NUM_COUNTERS] = {};
+  uint64 buckets[NUM_STAGES][kNumBuckets] = {};
+  uint64 sum_nanos[NUM_STAGES] = {};
+
+  // Returns the number of the records of |stage|.
+  uint64 count(Stage stage) const;
+};
+
+Snapshot GetSnapshot();
+
+// Formats |snapshot|. The text format of Prometheus is used for
+// ToPrometheus().
+std::string ToPrometheus(const Snapshot &snapshot);
+std::string ToJson(const Snapshot &snapshot);
+
+// Records the wall time from the construction to the destruction.
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Stage stage)
+      : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+
+  ~ScopedTimer() {
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start_)
+                           .count();
+    GetThreadStats()->Record(stage_, nanos);
+  }
+
+ private:
+  const Stage stage_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace metrics
+}  // namespace sentencepiece
+
+#ifdef SPM_ENABLE_METRICS
+#define SPM_METRICS_ADD(counter, value)                       \
+  ::sentencepiece::metrics::GetThreadStats()->Add(            \
+      ::sentencepiece::metrics::counter, static_cast<uint64>(value))
+#define SPM_METRICS_TIMER(stage)                               \
+  const ::sentencepiece::metrics::ScopedTimer spm_metrics_timer_ \
+      (::sentencepiece::metrics::stage)
+#else
+// |value| is referred to in dead code, so that the variables only used for
+// the metrics are not reported as unused.
+#define SPM_METRICS_ADD(counter, value) \
+  do {                                  \
+    if (false) static_cast<void>(value); \
+  } while (0)
+#define SPM_METRICS_TIMER(stage) \
+  do {                           \
+  } while (0)
+#endif  // SPM_ENABLE_METRICS
+
+#endif  // METRICS_H_
@@ -0,0 +1,147 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "metrics.h"
+
+#include <thread>
+
+#include "sentencepiece_trainer.h"
+#include "testharness.h"
+#include "third_party/absl/strings/str_cat.h"
+#include "util.h"
+
+namespace sentencepiece {
+namespace metrics {
+namespace {
+
+TEST(MetricsTest, GetBucketTest) {
+  EXPECT_EQ(0, GetBucket(0));
+  EXPECT_EQ(0, GetBucket(999));
+  EXPECT_EQ(1, GetBucket(1000));
+  EXPECT_EQ(1, GetBucket(1999));
+  EXPECT_EQ(2, GetBucket(2000));
+  EXPECT_EQ(10, GetBucket(1000000));  // 1msec is in [512, 1024) usec.
+  EXPECT_EQ(kNumBuckets - 1, GetBucket(static_cast<uint64>(-1)));
+}
+
+TEST(MetricsTest, FormatTest) {
+  Snapshot snapshot;
+  snapshot.counters[ENCODE_CALLS] = 3;
+  snapshot.counters[OUTPUT_PIECES] = 8;
+  snapshot.counters[UNKNOWN_PIECES] = 2;
+  snapshot.buckets[NORMALIZE][0] = 1;
+  snapshot.buckets[NORMALIZE][2] = 1;
+  snapshot.sum_nanos[NORMALIZE] = 3500;
+  EXPECT_EQ(2, snapshot.count(NORMALIZE));
+  EXPECT_EQ(0, snapshot.count(DECODE));
+
+  const std::string prometheus = ToPrometheus(snapshot);
+  for (const char *line : {
+           "# TYPE sentencepiece_encode_calls_total counter\n",
+           "sentencepiece_encode_calls_total 3\n",
+           "sentencepiece_unknown_pieces_total 2\n",
+           "sentencepiece_stage_latency_seconds_bucket{stage=\"normalize\","
+           "le=\"1e-06\"} 1\n",
+           "sentencepiece_stage_latency_seconds_bucket{stage=\"normalize\","
+           "le=\"2e-06\"} 1\n",
+           "sentencepiece_stage_latency_seconds_bucket{stage=\"normalize\","
+           "le=\"4e-06\"} 2\n",
+           "sentencepiece_stage_latency_seconds_bucket{stage=\"normalize\","
+           "le=\"+Inf\"} 2\n",
+           "sentencepiece_stage_latency_seconds_sum{stage=\"normalize\"} "
+           "3.5e-06\n",
+           "sentencepiece_stage_latency_seconds_count{stage=\"normalize\"} 2\n",
+           "sentencepiece_stage_latency_seconds_count{stage=\"decode\"} 0\n"}) {
+    EXPECT_NE(std::string::npos, prometheus.find(line)) << line;
+  }
+
+  const std::string json = ToJson(snapshot);
+  for (const char *field :
+       {"\"encode_calls\": 3", "\"unknown_rate\": 0.25",
+        "\"normalize\": {\"count\": 2, \"sum_sec\": 3.5e-06",
+        "{\"le_usec\": 4, \"count\": 1}", "{\"le_usec\": null, \"count\": 0}"}) {
+    EXPECT_NE(std::string::npos, json.find(field)) << field;
+  }
+}
+
+TEST(MetricsTest, ThreadStatsTest) {
+  const Snapshot before = GetSnapshot();
+
+  // The stats of the exited threads are kept.
+  std::vector<std::thread> threads;
+  for (int n = 0; n < 4; ++n) {
+    threads.emplace_back([]() {
+      GetThreadStats()->Add(TRIE_LOOKUPS, 10);
+      GetThreadStats()->Record(DECODE, 1500);
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  GetThreadStats()->Add(TRIE_LOOKUPS, 1);
+
+  const Snapshot after = GetSnapshot();
+  EXPECT_EQ(41, after.counters[TRIE_LOOKUPS] - before.counters[TRIE_LOOKUPS]);
+  EXPECT_EQ(4, after.buckets[DECODE][1] - before.buckets[DECODE][1]);
+  EXPECT_EQ(6000, after.sum_nanos[DECODE] - before.sum_nanos[DECODE]);
+}
+
+TEST(MetricsTest, ProcessorTest) {
+  const std::string model_prefix =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "metrics");
+  ASSERT_TRUE(
+      SentencePieceTrainer::Train(
+          absl::StrCat("--input=",
+                       util::JoinPath(absl::GetFlag(FLAGS_test_srcdir),
+                                      "botchan.txt"),
+                       " --model_prefix=", model_prefix, " --vocab_size=1000"))
+          .ok());
+  SentencePieceProcessor sp;
+  ASSERT_TRUE(sp.Load(model_prefix + ".model").ok());
+
+  const Snapshot before = GetSnapshot();
+  std::vector<std::string> pieces;
+  ASSERT_TRUE(sp.Encode("I saw a girl with a telescope.", &pieces).ok());
+  std::string detok;
+  ASSERT_TRUE(sp.Decode(pieces, &detok).ok());
+  const Snapshot after = GetSnapshot();
+
+  auto diff = [&](Counter counter) {
+    return after.counters[counter] - before.counters[counter];
+  };
+
+#ifdef SPM_ENABLE_METRICS
+  EXPECT_TRUE(IsEnabled());
+  EXPECT_EQ(1, diff(ENCODE_CALLS));
+  EXPECT_EQ(1, diff(DECODE_CALLS));
+  EXPECT_EQ(30, diff(INPUT_BYTES));
+  EXPECT_EQ(pieces.size(), diff(OUTPUT_PIECES));
+  EXPECT_EQ(0, diff(UNKNOWN_PIECES));
+  EXPECT_LT(0, diff(TRIE_LOOKUPS));
+  EXPECT_LE(pieces.size(), diff(LATTICE_NODES));
+  for (const Stage stage : {NORMALIZE, ENCODE, POPULATE, DECODE}) {
+    EXPECT_EQ(1, after.count(stage) - before.count(stage));
+  }
+  EXPECT_NE(std::string::npos,
+            metrics::ToPrometheus().find("sentencepiece_encode_calls_total"));
+  EXPECT_EQ('{', metrics::ToJson()[0]);
+#else
+  EXPECT_FALSE(IsEnabled());
+  for (int c = 0; c < NUM_COUNTERS; ++c) {
+    EXPECT_EQ(0, diff(static_cast<Counter>(c)));
+  }
+  EXPECT_TRUE(metrics::ToPrometheus().empty());
+  EXPECT_TRUE(metrics::ToJson().empty());
+#endif
+}
+
+}  // namespace
+}  // namespace metrics
+}  // namespace sentencepiece
@@ -14,6 +14,7 @@
 
 #include <algorithm>
 
+#include "metrics.h"
 #include "model_interface.h"
 #include "sentencepiece_model.pb.h"
 #include "third_party/absl/memory/memory.h"
@@ -60,10 +61,71 @@ int ModelInterface::PieceToId(absl::string_view piece) const {
   return unk_id_;
 }
 
+void ModelInterface::InitializePieceTable() {
+  piece_table_.resize(model_proto_->pieces_size());
+  for (int i = 0; i < model_proto_->pieces_size(); ++i) {
+    const auto &sp = model_proto_->pieces(i);
+    piece_table_[i].score = sp.score();
+    piece_table_[i].type = sp.type();
+  }
+
+  // The cached encodings may use the pieces which are unused now.
+  if (word_cache_ != nullptr) word_cache_->Clear();
+}
+
+util::Status ModelInterface::SetWordCacheSize(size_t max_bytes) {
+  RETURN_IF_ERROR(status());
+  word_cache_.reset();
+  if (max_bytes == 0) return util::OkStatus();
+
+  if (!IsWordCacheAvailable()) {
+    LOG(INFO) << "The model does not support the word cache.";
+    return util::OkStatus();
+  }
+
+  // The words are encoded separately only if every boundary of the words
+  // is a boundary of the pieces, i.e., no piece has a whitespace other
+  // than at its beginning (or its end with treat_whitespace_as_suffix).
+  const auto &trainer_spec = model_proto_->trainer_spec();
+  bool safe = trainer_spec.split_by_whitespace();
+  for (int i = 0; safe && i < model_proto_->pieces_size(); ++i) {
+    safe = SplitIntoWords(model_proto_->pieces(i).piece(),
+                          trainer_spec.treat_whitespace_as_suffix())
+               .size() <= 1;
+  }
+  if (!safe) {
+    LOG(INFO) << "The word cache is disabled as a piece can span over "
+                 "whitespaces.";
+    return util::OkStatus();
+  }
+
+  word_cache_ = absl::make_unique<WordCache>(max_bytes);
+  return util::OkStatus();
+}
+
+EncodeResult ModelInterface::EncodeWords(
+    absl::string_view normalized,
+    const std::function<EncodeResult(absl::string_view)> &encode_word) const {
+  if (word_cache_ == nullptr) return encode_word(normalized);
+
+  EncodeResult output;
+  const bool treat_whitespace_as_suffix =
+      model_proto_->trainer_spec().treat_whitespace_as_suffix();
+  for (const auto word :
+       SplitIntoWords(normalized, treat_whitespace_as_suffix)) {
+    if (word_cache_->Lookup(word, &output)) continue;
+    const auto pieces = encode_word(word);
+    word_cache_->Insert(word, pieces);
+    output.insert(output.end(), pieces.begin(), pieces.end());
+  }
+  return output;
+}
+
 void ModelInterface::InitializePieces() {
   pieces_.clear();
   reserved_id_map_.clear();
   unk_id_ = -1;
+  InitializePieceTable();
 
   std::set<absl::string_view> user_defined_symbols;
   std::vector<bool> byte_found(256, false);
@@ -190,4 +252,24 @@ int PieceToByte(absl::string_view piece) {
   }
 }
 
+util::Status EncodeResultToIds(const ModelInterface &model,
+                               const EncodeResult &result,
+                               std::vector<int> *ids) {
+  bool is_prev_unk = false;
+  for (const auto &p : result) {
+    CHECK_OR_RETURN(!p.first.empty()) << "Empty piece is not allowed.";
+    const bool is_unk = model.IsUnknown(p.second);
+    SPM_METRICS_ADD(UNKNOWN_PIECES, is_unk);
+    if (is_unk && model.ByteFallbackEnabled()) {
+      for (const char b : p.first) {
+        ids->push_back(model.PieceToId(ByteToPiece(b)));
+      }
+    } else if (!is_prev_unk || !is_unk) {
+      ids->push_back(p.second);
+    }
+    is_prev_unk = is_unk;
+  }
+  return util::OkStatus();
+}
+
 }  // namespace sentencepiece
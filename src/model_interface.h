@@ -15,6 +15,7 @@
 #ifndef MODEL_INTERFACE_H_
 #define MODEL_INTERFACE_H_
 
+#include <functional>
 #include <memory>
 #include <set>
 #include <string>
@@ -29,6 +30,7 @@
 #include "third_party/absl/strings/string_view.h"
 #include "third_party/darts_clone/darts.h"
 #include "util.h"
+#include "word_cache.h"
 
 namespace sentencepiece {
 
@@ -83,16 +85,32 @@ class ModelInterface {
   // use.
   virtual util::Status SetEncoderVersion(EncoderVersion encoder_version) {
     encoder_version_ = encoder_version;
+    if (word_cache_ != nullptr) word_cache_->Clear();
     return util::OkStatus();
   }
 
   // Returns the current encoder version in use.
   virtual EncoderVersion GetEncoderVersion() const { return encoder_version_; }
 
+  // Returns the name of the encoder selected for the pieces of the model,
+  // e.g., "optimized" or "optimized_user_defined" in unigram. Empty for the
+  // models with a single encoder.
+  virtual std::string GetEncoderVariant() const { return ""; }
+
   // Given a normalized string, returns a sequence of sentence pieces with ids.
   // The concatenation of pieces must be the same as `normalized`.
   virtual EncodeResult Encode(absl::string_view normalized) const = 0;
 
+  // Same as Encode() for each of |normalized|. Models may process the inputs
+  // together, e.g., to overlap their memory accesses.
+  virtual std::vector<EncodeResult> EncodeBatch(
+      const std::vector<absl::string_view> &normalized) const {
+    std::vector<EncodeResult> results;
+    results.reserve(normalized.size());
+    for (const auto text : normalized) results.push_back(Encode(text));
+    return results;
+  }
+
   // The same as above, but returns nbest result with score.
   virtual NBestEncodeResult NBestEncode(absl::string_view normalized,
                                         int nbest_size) const {
@@ -112,6 +130,21 @@ class ModelInterface {
   // Return true if NBestEncode returns a valid result.
   virtual bool IsNBestEncodeAvailable() const { return false; }
 
+  // Returns true if Encode() can use the word cache, i.e., encoding the
+  // words separately always gives the same pieces. Unigram does not, as the
+  // Viterbi scores summed over a sentence round differently and may break
+  // ties in another way.
+  virtual bool IsWordCacheAvailable() const { return false; }
+
+  // Caches the encodings of the words in up to |max_bytes| of memory.
+  // 0 disables the cache. The cache is enabled only when the model encodes
+  // each word separately, i.e., no piece can span over a word boundary.
+  // Not thread-safe with the encoders.
+  util::Status SetWordCacheSize(size_t max_bytes);
+
+  // Returns the word cache, or nullptr when disabled.
+  const WordCache *word_cache() const { return word_cache_.get(); }
+
   // Returns the vocab id of `piece`.
   // Returns UNK(0) if `piece` is unknown
   virtual int PieceToId(absl::string_view piece) const;
@@ -129,37 +162,31 @@ class ModelInterface {
   // Returns the score of `id`.
   // Score represents a log probability of the piece.
   // We can roughly estimate the unigram frequency of the piece.
-  virtual float GetScore(int id) const {
-    return model_proto_->pieces(id).score();
-  }
+  virtual float GetScore(int id) const { return piece_table_[id].score; }
 
   // Returns true if `id` is unknown symbol.
   virtual bool IsUnknown(int id) const {
-    return (model_proto_->pieces(id).type() ==
-            ModelProto::SentencePiece::UNKNOWN);
+    return piece_table_[id].type == ModelProto::SentencePiece::UNKNOWN;
   }
 
   // Returns true if `id` is control symbol.
   virtual bool IsControl(int id) const {
-    return (model_proto_->pieces(id).type() ==
-            ModelProto::SentencePiece::CONTROL);
+    return piece_table_[id].type == ModelProto::SentencePiece::CONTROL;
   }
 
   // Returns true if `id` is unused symbol.
   virtual bool IsUnused(int id) const {
-    return (model_proto_->pieces(id).type() ==
-            ModelProto::SentencePiece::UNUSED);
+    return piece_table_[id].type == ModelProto::SentencePiece::UNUSED;
   }
 
   // Returns true if `id` is user defined symbol.
   virtual bool IsUserDefined(int id) const {
-    return (model_proto_->pieces(id).type() ==
-            ModelProto::SentencePiece::USER_DEFINED);
+    return piece_table_[id].type == ModelProto::SentencePiece::USER_DEFINED;
   }
 
   // Returns true if `id` is byte symbol.
   virtual bool IsByte(int id) const {
-    return (model_proto_->pieces(id).type() == ModelProto::SentencePiece::BYTE);
+    return piece_table_[id].type == ModelProto::SentencePiece::BYTE;
   }
 
   virtual bool ByteFallbackEnabled() const {
@@ -176,40 +203,67 @@ class ModelInterface {
     return expected == actual;
   }
 
+  // Rebuilds the internal trie in a cache friendly layout for the inputs
+  // like |normalized_sample|. The encoding results do not change.
+  // Not thread-safe with the encoders.
+  virtual util::Status RelayoutTrie(
+      const std::vector<absl::string_view> & /*normalized_sample*/,
+      bool /*use_huge_pages*/) {
+    return util::OkStatus();
+  }
+
+  // Copies the scores and types of model_proto_ into the flat table read by
+  // GetScore(), IsUnknown() etc. Must be called again when the pieces of
+  // model_proto_ are modified.
+  virtual void InitializePieceTable();
+
  protected:
   void InitializePieces();
 
+  // Encodes |normalized| word by word with |encode_word|, taking the words
+  // from the word cache when possible.
+  EncodeResult EncodeWords(
+      absl::string_view normalized,
+      const std::function<EncodeResult(absl::string_view)> &encode_word) const;
+
   // Non-virtual (inlined) implementation for faster execution.
-  inline float GetScoreInlined(int id) const {
-    return model_proto_->pieces(id).score();
-  }
+  inline float GetScoreInlined(int id) const { return piece_table_[id].score; }
 
   inline bool IsUnknownInlined(int id) const {
-    return (model_proto_->pieces(id).type() ==
-            ModelProto::SentencePiece::UNKNOWN);
+    return piece_table_[id].type == ModelProto::SentencePiece::UNKNOWN;
   }
 
   inline bool IsControlInlined(int id) const {
-    return (model_proto_->pieces(id).type() ==
-            ModelProto::SentencePiece::CONTROL);
+    return piece_table_[id].type == ModelProto::SentencePiece::CONTROL;
   }
 
   inline bool IsUnusedInlined(int id) const {
-    return (model_proto_->pieces(id).type() ==
-            ModelProto::SentencePiece::UNUSED);
+    return piece_table_[id].type == ModelProto::SentencePiece::UNUSED;
   }
 
   inline bool IsUserDefinedInlined(int id) const {
-    return (model_proto_->pieces(id).type() ==
-            ModelProto::SentencePiece::USER_DEFINED);
+    return piece_table_[id].type == ModelProto::SentencePiece::USER_DEFINED;
   }
 
   inline bool IsByteInlined(int id) const {
-    return (model_proto_->pieces(id).type() == ModelProto::SentencePiece::BYTE);
+    return piece_table_[id].type == ModelProto::SentencePiece::BYTE;
   }
 
   const ModelProto *model_proto_ = nullptr;
 
+  // Score and type of a piece packed in 8 bytes. The accessors above read
+  // them from one contiguous array instead of going through the message
+  // objects of model_proto_.
+  struct PieceInfo {
+    float score;
+    int32 type;  // ModelProto::SentencePiece::Type
+  };
+  static_assert(sizeof(PieceInfo) == 8, "PieceInfo must be packed.");
+  std::vector<PieceInfo> piece_table_;
+
+  // Cache of the encodings of the words. nullptr when disabled.
+  std::unique_ptr<WordCache> word_cache_;
+
   // PrefixMatcher for user defined symbols.
   std::unique_ptr<normalizer::PrefixMatcher> matcher_;
 
@@ -229,5 +283,13 @@ class ModelInterface {
   // status.
   util::Status status_;
 };
+
+// Appends the ids of |result| encoded by |model| to |ids| in the same way
+// as SentencePieceProcessor, i.e., an unknown piece is decomposed into
+// byte pieces with byte fallback, and a run of unknown pieces is merged
+// into one otherwise.
+util::Status EncodeResultToIds(const ModelInterface &model,
+                               const EncodeResult &result,
+                               std::vector<int> *ids);
 }  // namespace sentencepiece
 #endif  // MODEL_INTERFACE_H_
@@ -206,6 +206,25 @@ TEST(ModelInterfaceTest, PieceToIdTest) {
   }
 }
 
+TEST(ModelInterfaceTest, InitializePieceTableTest) {
+  for (const auto type : kModelTypes) {
+    ModelProto model_proto = MakeBaseModelProto(type);
+    AddPiece(&model_proto, "a", 0.1);  // 3
+    AddPiece(&model_proto, "b", 0.2);  // 4
+
+    auto model = ModelFactory::Create(model_proto);
+    EXPECT_FALSE(model->IsUnused(4));
+
+    // The table is a copy of the pieces, which is updated on request.
+    model_proto.mutable_pieces(3)->set_score(0.5);
+    model_proto.mutable_pieces(4)->set_type(ModelProto::SentencePiece::UNUSED);
+    model->InitializePieceTable();
+    EXPECT_NEAR(0.5, model->GetScore(3), 0.0001);
+    EXPECT_FALSE(model->IsUnused(3));
+    EXPECT_TRUE(model->IsUnused(4));
+  }
+}
+
 TEST(ModelInterfaceTest, InvalidModelTest) {
   // Empty piece.
   {
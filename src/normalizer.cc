@@ -12,9 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.!
 
+#include <cstring>
+#include <limits>
 #include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "common.h"
 #include "normalizer.h"
 #include "third_party/absl/memory/memory.h"
@@ -28,6 +34,9 @@ namespace sentencepiece {
 namespace normalizer {
 
 constexpr int Normalizer::kMaxTrieResultsSize;
+constexpr uint32 Normalizer::kTableMagic;
+constexpr uint16 Normalizer::kTableNoRule;
+constexpr uint16 Normalizer::kTableUseTrie;
 
 Normalizer::Normalizer(const NormalizerSpec &spec,
                        const TrainerSpec &trainer_spec)
@@ -45,12 +54,31 @@ Normalizer::Normalizer(const NormalizerSpec &spec)
 Normalizer::~Normalizer() {}
 
 void Normalizer::Init() {
+  // Selects the instances of NormalizeImpl() for the spec, so that the flags
+  // are not checked for every character.
+  const bool escape = spec_->escape_whitespaces();
+  const bool remove = spec_->remove_extra_whitespaces();
+  if (escape && remove) {
+    normalize_ = &Normalizer::NormalizeImpl<true, true, false>;
+    normalize_aligned_ = &Normalizer::NormalizeImpl<true, true, true>;
+  } else if (escape) {
+    normalize_ = &Normalizer::NormalizeImpl<true, false, false>;
+    normalize_aligned_ = &Normalizer::NormalizeImpl<true, false, true>;
+  } else if (remove) {
+    normalize_ = &Normalizer::NormalizeImpl<false, true, false>;
+    normalize_aligned_ = &Normalizer::NormalizeImpl<false, true, true>;
+  } else {
+    normalize_ = &Normalizer::NormalizeImpl<false, false, false>;
+    normalize_aligned_ = &Normalizer::NormalizeImpl<false, false, true>;
+  }
+
   absl::string_view index = spec_->precompiled_charsmap();
   if (index.empty()) {
     LOG(INFO) << "precompiled_charsmap is empty. use identity normalization.";
   } else {
-    absl::string_view trie_blob, normalized;
-    status_ = DecodePrecompiledCharsMap(index, &trie_blob, &normalized);
+    absl::string_view trie_blob, normalized, table_blob;
+    status_ = DecodePrecompiledCharsMap(index, &trie_blob, &normalized,
+                                        &table_blob);
     if (!status_.ok()) return;
 
     // Reads the body of double array.
@@ -62,13 +90,124 @@ void Normalizer::Init() {
                      trie_blob.size() / trie_->unit_size());
 
     normalized_ = normalized.data();
+
+    if (!table_blob.empty()) {
+      status_ = InitTable(table_blob, normalized.size());
+      if (!status_.ok()) return;
+    }
   }
+
+  InitAsciiFlags();
+}
+
+util::Status Normalizer::InitTable(absl::string_view table_blob,
+                                   size_t normalized_size) {
+  // <index (256 x uint16)><blocks (256 x uint16 each)>
+  constexpr size_t kBlockBytes = 256 * sizeof(uint16);
+  CHECK_OR_RETURN(table_blob.size() > kBlockBytes &&
+                  table_blob.size() % kBlockBytes == 0)
+      << "Table for normalization rule is broken.";
+  table_index_.resize(256);
+  memcpy(table_index_.data(), table_blob.data(), kBlockBytes);
+  table_blob.remove_prefix(kBlockBytes);
+  table_blocks_.resize(table_blob.size() / sizeof(uint16));
+  memcpy(table_blocks_.data(), table_blob.data(), table_blob.size());
+
+  const size_t num_blocks = table_blocks_.size() / 256;
+  for (const uint16 block : table_index_) {
+    CHECK_LT_OR_RETURN(block, num_blocks);
+  }
+  for (const uint16 value : table_blocks_) {
+    CHECK_OR_RETURN(value == kTableNoRule || value == kTableUseTrie ||
+                    value < normalized_size);
+  }
+  return util::OkStatus();
+}
+
+void Normalizer::SetPrefixMatcher(const PrefixMatcher *matcher) {
+  matcher_ = matcher;
+  if (status_.ok()) InitAsciiFlags();
+}
+
+void Normalizer::InitAsciiFlags() {
+  memset(ascii_flags_, 0, sizeof(ascii_flags_));
+  // '\0' is the terminal label of the trie and always takes the slow path.
+  for (int c = 1; c < 0x80; ++c) {
+    uint8 flags = kUnchanged | kUnchangedBeforeAny;
+    if (trie_ != nullptr) {
+      const char key = c;
+      size_t node_pos = 0, key_pos = 0;
+      const int result = trie_->traverse(&key, node_pos, key_pos, 1);
+      if (result >= 0) {
+        // |c| itself has a rule.
+        flags = 0;
+      } else if (result == -1) {
+        // Only longer rules start with |c|, e.g., "A" + U+0300. They are
+        // not applicable if the next byte is ASCII.
+        flags = kUnchanged;
+        for (int next = 1; next < 0x80; ++next) {
+          const char next_key = next;
+          size_t next_node_pos = node_pos, next_key_pos = 0;
+          if (trie_->traverse(&next_key, next_node_pos, next_key_pos, 1) !=
+              -2) {
+            flags = 0;
+            break;
+          }
+        }
+      }
+    }
+    if (matcher_ != nullptr && matcher_->IsFirstByte(c)) flags = 0;
+    if ((flags & kUnchanged) && c != ' ') flags |= kSkippable;
+    ascii_flags_[c] = flags;
+  }
+
+  is_printable_ascii_skippable_ = true;
+  for (int c = 0x21; c < 0x7F; ++c) {
+    if (!(ascii_flags_[c] & kSkippable)) is_printable_ascii_skippable_ = false;
+  }
+}
+
+const char *Normalizer::SkipUnchangedAscii(absl::string_view input) const {
+  const char *begin = input.data();
+  const char *end = begin + input.size();
+  const char *p = begin;
+
+#if defined(__SSE2__)
+  // Classifies 16 bytes at once. The bytes >= 0x80 are negative.
+  if (is_printable_ascii_skippable_) {
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i upper = _mm_set1_epi8(0x7F);
+    while (end - p >= 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+      const int mask = _mm_movemask_epi8(
+          _mm_and_si128(_mm_cmpgt_epi8(v, lower), _mm_cmplt_epi8(v, upper)));
+      if (mask != 0xFFFF) {
+        p += __builtin_ctz(~mask);
+        break;
+      }
+      p += 16;
+    }
+  }
+#endif
+
+  while (p < end &&
+         (ascii_flags_[static_cast<unsigned char>(*p)] & kSkippable)) {
+    ++p;
+  }
+
+  // The last byte may have a rule together with the following non-ASCII
+  // character.
+  if (p != begin && p != end && static_cast<unsigned char>(*p) >= 0x80 &&
+      !(ascii_flags_[static_cast<unsigned char>(p[-1])] & kUnchangedBeforeAny))
+    --p;
+
+  return p;
 }
 
 util::Status Normalizer::Normalize(absl::string_view input,
                                    std::string *normalized,
-                                   std::vector<size_t> *norm_to_orig) const {
-  norm_to_orig->clear();
+                                   std::vector<uint32> *norm_to_orig) const {
+  if (norm_to_orig != nullptr) norm_to_orig->clear();
   normalized->clear();
 
   if (input.empty()) {
@@ -77,10 +216,24 @@ util::Status Normalizer::Normalize(absl::string_view input,
 
   RETURN_IF_ERROR(status());
 
-  int consumed = 0;
+  if (norm_to_orig != nullptr) {
+    CHECK_LT_OR_RETURN(input.size(), std::numeric_limits<uint32>::max())
+        << "The alignment does not fit in uint32.";
+  }
+
+  return norm_to_orig == nullptr
+             ? (this->*normalize_)(input, normalized, nullptr)
+             : (this->*normalize_aligned_)(input, normalized, norm_to_orig);
+}
+
+template <bool kEscapeWhitespaces, bool kRemoveExtraWhitespaces, bool kAlign>
+util::Status Normalizer::NormalizeImpl(
+    absl::string_view input, std::string *normalized,
+    std::vector<uint32> *norm_to_orig) const {
+  uint32 consumed = 0;
 
   // Ignores heading space.
-  if (spec_->remove_extra_whitespaces()) {
+  if (kRemoveExtraWhitespaces) {
     while (!input.empty()) {
       const auto p = NormalizePrefix(input);
       if (p.first != " ") {
@@ -96,25 +249,50 @@ util::Status Normalizer::Normalize(absl::string_view input,
     return util::OkStatus();
   }
 
-  // Reserves the output buffer to avoid re-allocations.
-  const size_t kReservedSize = input.size() * 3;
+  // Reserves the output buffer to avoid re-allocations. Most characters are
+  // unchanged, and the escaped ' ' and the dummy prefix are three bytes.
+  const size_t kReservedSize = input.size() + input.size() / 2 + 3;
   normalized->reserve(kReservedSize);
-  norm_to_orig->reserve(kReservedSize);
+  if (kAlign) norm_to_orig->reserve(kReservedSize + 1);
+
+  // Aligns the next |length| bytes of |normalized| to |consumed|.
+  auto add_alignment = [&consumed, &norm_to_orig](size_t length) {
+    if (!kAlign) return;
+    for (size_t n = 0; n < length; ++n) norm_to_orig->push_back(consumed);
+  };
 
   // Replaces white space with U+2581 (LOWER ONE EIGHT BLOCK)
   // if escape_whitespaces() is set (default = true).
   const absl::string_view kSpaceSymbol = "\xe2\x96\x81";
 
   // adds kSpaceSymbol to the current context.
-  auto add_ws = [this, &consumed, &normalized, &norm_to_orig, &kSpaceSymbol]() {
-    if (spec_->escape_whitespaces()) {
+  auto add_ws = [&normalized, &add_alignment, &kSpaceSymbol]() {
+    if (kEscapeWhitespaces) {
       normalized->append(kSpaceSymbol.data(), kSpaceSymbol.size());
-      for (size_t n = 0; n < kSpaceSymbol.size(); ++n) {
-        norm_to_orig->push_back(consumed);
-      }
+      add_alignment(kSpaceSymbol.size());
     } else {
       normalized->append(" ");
-      norm_to_orig->push_back(consumed);
+      add_alignment(1);
+    }
+  };
+
+  // Appends |sp|, replacing ' ' with kSpaceSymbol.
+  auto add_escaped = [&normalized, &add_alignment, &add_ws](
+                         absl::string_view sp) {
+    while (!sp.empty()) {
+      const char *space =
+          kEscapeWhitespaces
+              ? static_cast<const char *>(memchr(sp.data(), ' ', sp.size()))
+              : nullptr;
+      const size_t length =
+          space == nullptr ? sp.size() : space - sp.data();
+      normalized->append(sp.data(), length);
+      add_alignment(length);
+      sp.remove_prefix(length);
+      if (space != nullptr) {
+        add_ws();
+        sp.remove_prefix(1);
+      }
     }
   };
 
@@ -124,71 +302,134 @@ util::Status Normalizer::Normalize(absl::string_view input,
   // "_world" as one symbol.
   if (!treat_whitespace_as_suffix_ && spec_->add_dummy_prefix()) add_ws();
 
-  bool is_prev_space = spec_->remove_extra_whitespaces();
+  // The characters which the rules leave unchanged are appended at once
+  // when the run of them ends.
+  const char *run_begin = input.data();
+  const char *run_end = input.data();
+  auto flush_run = [&]() {
+    if (run_begin == run_end) return;
+    normalized->append(run_begin, run_end - run_begin);
+    run_begin = run_end;
+  };
+
+  bool is_prev_space = kRemoveExtraWhitespaces;
   while (!input.empty()) {
-    auto p = NormalizePrefix(input);
+    // Copies the unchanged ASCII characters without the lookups.
+    const char *begin = input.data();
+    const char *end =
+        (ascii_flags_[static_cast<unsigned char>(*begin)] & kSkippable)
+            ? SkipUnchangedAscii(input)
+            : begin;
+    if (end != begin) {
+      if (run_end != begin) {
+        flush_run();
+        run_begin = begin;
+      }
+      run_end = end;
+      const size_t length = end - begin;
+      if (kAlign) {
+        for (uint32 n = 0; n < length; ++n) {
+          norm_to_orig->push_back(consumed + n);
+        }
+      }
+      consumed += length;
+      input.remove_prefix(length);
+      is_prev_space = false;
+      continue;
+    }
+
+    // ' ' is usually unchanged as well.
+    const uint8 flags = ascii_flags_[static_cast<unsigned char>(*begin)];
+    const auto p =
+        (flags & kUnchangedBeforeAny) ||
+                ((flags & kUnchanged) &&
+                 (input.size() == 1 || static_cast<uint8>(input[1]) < 0x80))
+            ? std::make_pair(input.substr(0, 1), 1)
+            : NormalizePrefix(input);
     absl::string_view sp = p.first;
 
     // Removes heading spaces in sentence piece,
     // if the previous sentence piece ends with whitespace.
-    while (is_prev_space && absl::ConsumePrefix(&sp, " ")) {
+    while (kRemoveExtraWhitespaces && is_prev_space &&
+           absl::ConsumePrefix(&sp, " ")) {
     }
 
     if (!sp.empty()) {
-      const char *data = sp.data();
-      for (size_t n = 0; n < sp.size(); ++n) {
-        if (spec_->escape_whitespaces() && data[n] == ' ') {
-          // replace ' ' with kSpaceSymbol.
-          normalized->append(kSpaceSymbol.data(), kSpaceSymbol.size());
-          for (size_t m = 0; m < kSpaceSymbol.size(); ++m) {
-            norm_to_orig->push_back(consumed);
-          }
+      // Most of the characters are one byte and unchanged.
+      const bool unchanged =
+          sp.data() == input.data() && sp.size() == p.second &&
+          (!kEscapeWhitespaces ||
+           (sp.size() == 1
+                ? sp[0] != ' '
+                : memchr(sp.data(), ' ', sp.size()) == nullptr));
+      if (unchanged) {
+        if (run_end != sp.data()) {
+          flush_run();
+          run_begin = sp.data();
+        }
+        run_end = sp.data() + sp.size();
+        add_alignment(sp.size());
+      } else {
+        flush_run();
+        if (sp.size() == 1 && sp[0] == ' ') {
+          add_ws();
         } else {
-          *normalized += data[n];
-          norm_to_orig->push_back(consumed);
+          add_escaped(sp);
         }
       }
       // Checks whether the last character of sp is whitespace.
-      is_prev_space = absl::EndsWith(sp, " ");
+      if (kRemoveExtraWhitespaces) is_prev_space = absl::EndsWith(sp, " ");
     }
 
     consumed += p.second;
     input.remove_prefix(p.second);
-    if (!spec_->remove_extra_whitespaces()) {
-      is_prev_space = false;
-    }
   }
+  flush_run();
 
   // Ignores tailing space.
-  if (spec_->remove_extra_whitespaces()) {
-    const absl::string_view space =
-        spec_->escape_whitespaces() ? kSpaceSymbol : " ";
+  if (kRemoveExtraWhitespaces) {
+    const absl::string_view space = kEscapeWhitespaces ? kSpaceSymbol : " ";
     while (absl::EndsWith(*normalized, space)) {
       const int length = normalized->size() - space.size();
       CHECK_GE_OR_RETURN(length, 0);
-      consumed = (*norm_to_orig)[length];
       normalized->resize(length);
-      norm_to_orig->resize(length);
+      if (kAlign) {
+        consumed = (*norm_to_orig)[length];
+        norm_to_orig->resize(length);
+      }
     }
   }
 
   // Adds a space symbol as a suffix (default is false)
   if (treat_whitespace_as_suffix_ && spec_->add_dummy_prefix()) add_ws();
 
-  norm_to_orig->push_back(consumed);
-
-  CHECK_EQ_OR_RETURN(norm_to_orig->size(), normalized->size() + 1);
+  if (kAlign) {
+    norm_to_orig->push_back(consumed);
+    CHECK_EQ_OR_RETURN(norm_to_orig->size(), normalized->size() + 1);
+  }
 
   return util::OkStatus();
 }
 
 std::string Normalizer::Normalize(absl::string_view input) const {
-  std::vector<size_t> norm_to_orig;
   std::string normalized;
-  Normalize(input, &normalized, &norm_to_orig).IgnoreError();
+  Normalize(input, &normalized, nullptr).IgnoreError();
   return normalized;
 }
 
+util::Status Normalizer::RelayoutTrie(
+    const std::vector<absl::string_view> &sample, bool use_huge_pages) {
+  RETURN_IF_ERROR(status());
+  if (trie_ == nullptr) return util::OkStatus();
+  auto units = absl::make_unique<trie_layout::UnitArray>();
+  RETURN_IF_ERROR(trie_layout::Relayout(
+      *trie_, trie_layout::CountVisits(*trie_, sample), use_huge_pages,
+      units.get()));
+  trie_->set_array(units->data(), units->size());
+  trie_units_ = std::move(units);
+  return util::OkStatus();
+}
+
 std::pair<absl::string_view, int> Normalizer::NormalizePrefix(
     absl::string_view input) const {
   std::pair<absl::string_view, int> result;
@@ -201,6 +442,22 @@ std::pair<absl::string_view, int> Normalizer::NormalizePrefix(
     if (found) return std::make_pair(input.substr(0, mblen), mblen);
   }
 
+  // Most characters are looked up in the table.
+  if (!table_blocks_.empty()) {
+    size_t mblen = 0;
+    const char32 c = string_util::DecodeUTF8(input, &mblen);
+    if (c <= 0xFFFF && (c != kUnicodeError || mblen == 3)) {
+      const uint16 value =
+          table_blocks_[table_index_[c >> 8] * 256 + (c & 0xFF)];
+      if (value == kTableNoRule) {
+        return std::make_pair(input.substr(0, mblen), static_cast<int>(mblen));
+      } else if (value != kTableUseTrie) {
+        return std::make_pair(absl::string_view(&normalized_[value]),
+                              static_cast<int>(mblen));
+      }
+    }
+  }
+
   size_t longest_length = 0;
   int longest_value = 0;
 
@@ -251,19 +508,27 @@ std::pair<absl::string_view, int> Normalizer::NormalizePrefix(
 
 // static
 std::string Normalizer::EncodePrecompiledCharsMap(
-    absl::string_view trie_blob, absl::string_view normalized) {
+    absl::string_view trie_blob, absl::string_view normalized,
+    absl::string_view table_blob) {
   // <trie size(4byte)><double array trie><normalized string>
+  // The table follows as <table><table size(4byte)><kTableMagic(4byte)>,
+  // which the older versions read as a part of the normalized string.
   std::string blob;
   blob.append(string_util::EncodePOD<uint32>(trie_blob.size()));
   blob.append(trie_blob.data(), trie_blob.size());
   blob.append(normalized.data(), normalized.size());
+  if (!table_blob.empty()) {
+    blob.append(table_blob.data(), table_blob.size());
+    blob.append(string_util::EncodePOD<uint32>(table_blob.size()));
+    blob.append(string_util::EncodePOD<uint32>(kTableMagic));
+  }
   return blob;
 }
 
 // static
 util::Status Normalizer::DecodePrecompiledCharsMap(
     absl::string_view blob, absl::string_view *trie_blob,
-    absl::string_view *normalized) {
+    absl::string_view *normalized, absl::string_view *table_blob) {
   uint32 trie_blob_size = 0;
   if (blob.size() <= sizeof(trie_blob_size) ||
       !string_util::DecodePOD<uint32>(
@@ -277,7 +542,26 @@ util::Status Normalizer::DecodePrecompiledCharsMap(
   *trie_blob = absl::string_view(blob.data(), trie_blob_size);
 
   blob.remove_prefix(trie_blob_size);
+
+  absl::string_view table;
+  uint32 magic = 0, table_size = 0;
+  if (blob.size() >= 2 * sizeof(uint32) &&
+      string_util::DecodePOD<uint32>(blob.substr(blob.size() - sizeof(uint32)),
+                                     &magic) &&
+      magic == kTableMagic) {
+    blob.remove_suffix(sizeof(uint32));
+    if (!string_util::DecodePOD<uint32>(
+            blob.substr(blob.size() - sizeof(uint32)), &table_size) ||
+        table_size > blob.size() - sizeof(uint32)) {
+      return util::InternalError("Blob for normalization rule is broken.");
+    }
+    blob.remove_suffix(sizeof(uint32));
+    table = blob.substr(blob.size() - table_size);
+    blob.remove_suffix(table_size);
+  }
+
   *normalized = absl::string_view(blob.data(), blob.size());
+  if (table_blob != nullptr) *table_blob = table;
 
   return util::OkStatus();
 }
@@ -286,7 +570,10 @@ PrefixMatcher::PrefixMatcher(const std::set<absl::string_view> &dic) {
   if (dic.empty()) return;
   std::vector<const char *> key;
   key.reserve(dic.size());
-  for (const auto &it : dic) key.push_back(it.data());
+  for (const auto &it : dic) {
+    key.push_back(it.data());
+    if (!it.empty()) first_bytes_.set(static_cast<unsigned char>(it[0]));
+  }
   trie_ = absl::make_unique<Darts::DoubleArray>();
   CHECK_EQ(0, trie_->build(key.size(), const_cast<char **>(&key[0]), nullptr,
                            nullptr));
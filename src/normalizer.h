@@ -15,6 +15,7 @@
 #ifndef NORMALIZER_NORMALIZER_H_
 #define NORMALIZER_NORMALIZER_H_
 
+#include <bitset>
 #include <memory>
 #include <set>
 #include <string>
@@ -26,6 +27,7 @@
 #include "sentencepiece_processor.h"
 #include "third_party/absl/strings/string_view.h"
 #include "third_party/darts_clone/darts.h"
+#include "trie_layout.h"
 
 namespace sentencepiece {
 namespace normalizer {
@@ -46,8 +48,15 @@ class PrefixMatcher {
   // Replaces entries in `w` with `out`.
   std::string GlobalReplace(absl::string_view w, absl::string_view out) const;
 
+  // Returns true if `dic` is empty, i.e., nothing matches.
+  bool empty() const { return trie_ == nullptr; }
+
+  // Returns true if an entry of `dic` starts with the byte `c`.
+  bool IsFirstByte(unsigned char c) const { return first_bytes_[c]; }
+
  private:
   std::unique_ptr<Darts::DoubleArray> trie_;
+  std::bitset<256> first_bytes_;
 };
 
 // Normalizer implements a simple text normalizer with
@@ -68,9 +77,7 @@ class Normalizer {
   Normalizer(const NormalizerSpec &spec, const TrainerSpec &trainer_Spec);
   virtual ~Normalizer();
 
-  virtual void SetPrefixMatcher(const PrefixMatcher *matcher) {
-    matcher_ = matcher;
-  }
+  virtual void SetPrefixMatcher(const PrefixMatcher *matcher);
 
   // Returns Status.
   // Normalizes function is valid only when status is OK.
@@ -78,7 +85,10 @@ class Normalizer {
 
   // Normalizes a plain utf8 string into an internal representation for
   // Sentencepiece model. |norm_to_orig| stores the byte-alignment from
-  // normalized string to the original input.
+  // normalized string to the original input. |norm_to_orig| can be nullptr
+  // when the alignment is not needed, which skips all the work for it.
+  // The alignment is 32-bit as SentencePieceText, so the input must be
+  // shorter than 4GB when it is requested.
   // This function can do the following normalizations:
   // - Character normalization.
   //   (NFKC / full-width to half-width conversion etc).
@@ -87,19 +97,42 @@ class Normalizer {
   // - Removing heading, tailing and other redundant spaces.
   virtual util::Status Normalize(absl::string_view input,
                                  std::string *normalized,
-                                 std::vector<size_t> *norm_to_orig) const;
+                                 std::vector<uint32> *norm_to_orig) const;
 
   // Returns a normalized string without alignments.
   // This function is used in sentencepiece training.
   virtual std::string Normalize(absl::string_view input) const;
 
+  // Rebuilds the trie of the chars map in a cache friendly layout for the
+  // inputs like |sample|. The normalization results do not change.
+  // Not thread-safe with Normalize().
+  util::Status RelayoutTrie(const std::vector<absl::string_view> &sample,
+                            bool use_huge_pages);
+
   friend class Builder;
 
  private:
   FRIEND_TEST(NormalizerTest, EncodeDecodePrecompiledCharsMapTest);
+  FRIEND_TEST(NormalizerTest, PrecompiledCharsMapTableTest);
 
   void Init();
 
+  // Sets |table_index_| and |table_blocks_| from |table_blob|.
+  util::Status InitTable(absl::string_view table_blob, size_t normalized_size);
+
+  // Sets |ascii_flags_| from the chars map and the prefix matcher.
+  void InitAsciiFlags();
+
+  // Returns the end of the run of the ASCII characters at the beginning of
+  // |input|, which the rules leave unchanged. ' ' is not included.
+  const char *SkipUnchangedAscii(absl::string_view input) const;
+
+  // Normalize() specialized for the flags of the spec. |norm_to_orig| is
+  // used only when kAlign is true. The outputs must be empty.
+  template <bool kEscapeWhitespaces, bool kRemoveExtraWhitespaces, bool kAlign>
+  util::Status NormalizeImpl(absl::string_view input, std::string *normalized,
+                             std::vector<uint32> *norm_to_orig) const;
+
   // Normalizes the prefix of |input| and returns the pair of
   // normalized prefix and length we must consume after
   // normalization.
@@ -115,14 +148,25 @@ class Normalizer {
   std::pair<absl::string_view, int> NormalizePrefix(
       absl::string_view input) const;
 
-  // Encodes trie_blob and normalized string and return compiled blob.
-  static std::string EncodePrecompiledCharsMap(absl::string_view trie_blob,
-                                               absl::string_view normalized);
+  // Encodes trie_blob, normalized string and the optional table_blob and
+  // return compiled blob.
+  static std::string EncodePrecompiledCharsMap(
+      absl::string_view trie_blob, absl::string_view normalized,
+      absl::string_view table_blob = absl::string_view());
 
-  // Decodes blob into trie_blob and normalized string.
-  static util::Status DecodePrecompiledCharsMap(absl::string_view blob,
-                                                absl::string_view *trie_blob,
-                                                absl::string_view *normalized);
+  // Decodes blob into trie_blob, normalized string and table_blob.
+  // |table_blob| is empty for the blobs without the table. It can be nullptr.
+  static util::Status DecodePrecompiledCharsMap(
+      absl::string_view blob, absl::string_view *trie_blob,
+      absl::string_view *normalized, absl::string_view *table_blob = nullptr);
+
+  // Magic number at the end of the blobs with the table. Its last byte is
+  // never '\0', with which the blobs without the table end.
+  static constexpr uint32 kTableMagic = 0x01545053;  // "SPT\x01"
+
+  // Values of the table other than the positions in the normalized string.
+  static constexpr uint16 kTableNoRule = 0xFFFF;
+  static constexpr uint16 kTableUseTrie = 0xFFFE;
 
   // Maximum size of the return value of Trie, which corresponds
   // to the maximum size of shared common prefix in the chars map.
@@ -131,16 +175,49 @@ class Normalizer {
   // Internal trie for efficient longest matching.
   std::unique_ptr<Darts::DoubleArray> trie_;
 
+  // Units of |trie_| after RelayoutTrie().
+  std::unique_ptr<trie_layout::UnitArray> trie_units_;
+
   // "\0" delimitered output string.
   // the value of |trie_| stores pointers to this string.
   const char *normalized_ = nullptr;
 
+  // Two-level table of the rules of the single code points in the BMP,
+  // indexed by the upper and the lower byte. The values are positions in
+  // |normalized_| or kTableNoRule, or kTableUseTrie if longer rules start
+  // with the code point. Empty if the chars map has no table.
+  std::vector<uint16> table_index_;
+  std::vector<uint16> table_blocks_;
+
   // Spec for normalization.
   const NormalizerSpec *spec_;
 
+  // The instances of NormalizeImpl() selected by Init() without and with
+  // the alignment.
+  using NormalizeFunc = util::Status (Normalizer::*)(
+      absl::string_view, std::string *, std::vector<uint32> *) const;
+  NormalizeFunc normalize_ = nullptr;
+  NormalizeFunc normalize_aligned_ = nullptr;
+
   // Prefix matcher;
   const PrefixMatcher *matcher_ = nullptr;
 
+  // Flags of |ascii_flags_|.
+  enum AsciiFlag : uint8 {
+    // The byte is unchanged when an ASCII byte or nothing follows it.
+    kUnchanged = 1,
+    // The byte is unchanged whatever follows it.
+    kUnchangedBeforeAny = 2,
+    // kUnchanged and not ' ', which SkipUnchangedAscii() skips.
+    kSkippable = 4,
+  };
+
+  // AsciiFlag of each byte. Always 0 for the bytes >= 0x80.
+  uint8 ascii_flags_[256] = {};
+
+  // True if all the printable ASCII characters except ' ' are kSkippable.
+  bool is_printable_ascii_skippable_ = false;
+
   // Split hello world into "hello_" and "world_" instead of
   // "_hello" and "_world".
   const bool treat_whitespace_as_suffix_ = false;
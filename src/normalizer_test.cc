@@ -274,8 +274,99 @@ TEST(NormalizerTest, NormalizeReplacementChar) {
   EXPECT_EQ("ab" RC RC "xy", normalizer.Normalize("ab\xc0\x82xy"));
 }
 
+TEST(NormalizerTest, NormalizeWithoutAlignmentTest) {
+  for (const bool treat_whitespace_as_suffix : {false, true}) {
+    auto spec = MakeDefaultSpec();
+    TrainerSpec trainer_spec;
+    trainer_spec.set_treat_whitespace_as_suffix(treat_whitespace_as_suffix);
+    const Normalizer normalizer(spec, trainer_spec);
+    for (const char *input :
+         {"", " ", "I saw a girl", "  ＡＢＣ　 ｄｅｆ  ", "ab\xe3\x81xy "}) {
+      std::string expected, output = "dirty";
+      std::vector<uint32> n2i;
+      EXPECT_TRUE(normalizer.Normalize(input, &expected, &n2i).ok());
+      EXPECT_TRUE(normalizer.Normalize(input, &output, nullptr).ok());
+      EXPECT_EQ(expected, output);
+      EXPECT_EQ(expected, normalizer.Normalize(input));
+    }
+  }
+}
+
+TEST(NormalizerTest, NormalizeIdentityTest) {
+  auto spec = SentencePieceTrainer::GetNormalizerSpec("identity");
+  std::vector<uint32> n2i;
+  std::string output;
+
+  // All the combinations of the flags select different instances.
+  for (const bool escape_whitespaces : {false, true}) {
+    for (const bool remove_extra_whitespaces : {false, true}) {
+      spec.set_escape_whitespaces(escape_whitespaces);
+      spec.set_remove_extra_whitespaces(remove_extra_whitespaces);
+      const Normalizer normalizer(spec);
+      for (const char *input : {"abc", " a  b\xe3\x81\x82 c ",
+                                "ab\xe3\x81xy", "ＡＢＣ"}) {
+        EXPECT_TRUE(normalizer.Normalize(input, &output, &n2i).ok());
+        EXPECT_EQ(output.size() + 1, n2i.size());
+        EXPECT_EQ(output, normalizer.Normalize(input));
+      }
+    }
+  }
+
+  spec.set_escape_whitespaces(true);
+  spec.set_remove_extra_whitespaces(true);
+  {
+    const Normalizer normalizer(spec);
+    EXPECT_TRUE(
+        normalizer.Normalize(" a  b\xe3\x81\x82 c ", &output, &n2i).ok());
+    EXPECT_EQ(WS "a" WS "b\xe3\x81\x82" WS "c", output);
+    EXPECT_EQ(std::vector<uint32>(
+                  {1, 1, 1, 1, 2, 2, 2, 4, 5, 5, 5, 8, 8, 8, 9, 10}),
+              n2i);
+  }
+
+  spec.set_escape_whitespaces(false);
+  spec.set_remove_extra_whitespaces(false);
+  {
+    const Normalizer normalizer(spec);
+    EXPECT_TRUE(normalizer.Normalize(" a  b ", &output, &n2i).ok());
+    EXPECT_EQ("  a  b ", output);
+    EXPECT_EQ(std::vector<uint32>({0, 0, 1, 2, 3, 4, 5, 6}), n2i);
+  }
+}
+
+TEST(NormalizerTest, NormalizeAsciiRunTest) {
+  auto spec = MakeDefaultSpec();
+  std::vector<uint32> n2i;
+  std::string output;
+
+  const Normalizer normalizer(spec);
+  const std::string kLong = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+  // The runs are longer than 16 bytes.
+  EXPECT_EQ(WS + kLong + WS + kLong,
+            normalizer.Normalize(kLong + " " + kLong));
+
+  // "e" + U+0301 is composed into U+00E9 at the end of the run.
+  EXPECT_EQ(WS "abcd\xc3\xa9", normalizer.Normalize("abcde\xcc\x81"));
+  EXPECT_TRUE(normalizer.Normalize("abcde\xcc\x81", &output, &n2i).ok());
+  EXPECT_EQ(std::vector<uint32>({0, 0, 0, 0, 1, 2, 3, 4, 4, 7}), n2i);
+  EXPECT_EQ(WS "a\xc3\xa9" WS "b", normalizer.Normalize("ae\xcc\x81 b"));
+  EXPECT_EQ(WS "1\xcc\x81", normalizer.Normalize("1\xcc\x81"));
+
+  // Control characters are removed, and "ＡＢ" is half-width.
+  EXPECT_EQ(WS "abcAB" WS "xyz",
+            normalizer.Normalize("ab\x01" "cＡＢ xyz\x7f"));
+
+  // User defined symbols are not skipped.
+  Normalizer with_matcher(spec);
+  const PrefixMatcher matcher({"<sep>", "b" WS});
+  with_matcher.SetPrefixMatcher(&matcher);
+  EXPECT_EQ(WS "ab<sep>c", with_matcher.Normalize("ab<sep>c"));
+  EXPECT_EQ(WS "ab" WS "c", with_matcher.Normalize("ab" WS "c"));
+}
+
 TEST(NormalizerTest, NormalizeFullTest) {
-  std::vector<size_t> n2i;
+  std::vector<uint32> n2i;
   std::string output;
 
   auto spec = MakeDefaultSpec();
@@ -285,7 +376,7 @@ TEST(NormalizerTest, NormalizeFullTest) {
     const std::string input = "I saw a girl";
     EXPECT_TRUE(normalizer.Normalize(input, &output, &n2i).ok());
     EXPECT_EQ(WS "I" WS "saw" WS "a" WS "girl", output);
-    const std::vector<size_t> expected = {0, 0, 0,       // WS (3byte)
+    const std::vector<uint32> expected = {0, 0, 0,       // WS (3byte)
                                           0,             // I
                                           1, 1, 1,       // WS
                                           2, 3, 4,       // saw
@@ -302,7 +393,7 @@ TEST(NormalizerTest, NormalizeFullTest) {
     EXPECT_TRUE(normalizer.Normalize(input, &output, &n2i).ok());
     LOG(INFO) << output;
     EXPECT_EQ(WS "I" WS "saw" WS "a" WS "girl", output);
-    const std::vector<size_t> expected = {1,  1,  1,       // WS (3byte)
+    const std::vector<uint32> expected = {1,  1,  1,       // WS (3byte)
                                           1,               // I
                                           2,  2,  2,       // WS
                                           5,  6,  7,       // saw
@@ -318,7 +409,7 @@ TEST(NormalizerTest, NormalizeFullTest) {
     const std::string input = " ｸﾞｰｸﾞﾙ ";  // halfwidth katakana
     EXPECT_TRUE(normalizer.Normalize(input, &output, &n2i).ok());
     EXPECT_EQ(WS "グーグル", output);
-    const std::vector<size_t> expected = {1,  1,  1,   // WS (3byte)
+    const std::vector<uint32> expected = {1,  1,  1,   // WS (3byte)
                                           1,  1,  1,   // グ
                                           7,  7,  7,   // ー
                                           10, 10, 10,  // グ
@@ -331,7 +422,7 @@ TEST(NormalizerTest, NormalizeFullTest) {
     const std::string input = "①②③";
     EXPECT_TRUE(normalizer.Normalize(input, &output, &n2i).ok());
     EXPECT_EQ(WS "123", output);
-    const std::vector<size_t> expected = {0, 0, 0,  // WS (3byte)
+    const std::vector<uint32> expected = {0, 0, 0,  // WS (3byte)
                                           0,        // 1
                                           3,        // 2
                                           6,        // 3
@@ -343,7 +434,7 @@ TEST(NormalizerTest, NormalizeFullTest) {
     const std::string input = "㍿";
     EXPECT_TRUE(normalizer.Normalize(input, &output, &n2i).ok());
     EXPECT_EQ(WS "株式会社", output);
-    const std::vector<size_t> expected = {0, 0, 0,  // WS (3byte)
+    const std::vector<uint32> expected = {0, 0, 0,  // WS (3byte)
                                           0, 0, 0,  // 株
                                           0, 0, 0,  // 式
                                           0, 0, 0,  // 会
@@ -368,6 +459,124 @@ TEST(NormalizerTest, EncodeDecodePrecompiledCharsMapTest) {
   EXPECT_FALSE(
       Normalizer::DecodePrecompiledCharsMap("", &trie_blob, &normalized_blob)
           .ok());
+
+  // With the table.
+  absl::string_view table_blob;
+  const std::string blob_with_table =
+      Normalizer::EncodePrecompiledCharsMap("foo", "bar", "baz");
+  EXPECT_TRUE(Normalizer::DecodePrecompiledCharsMap(
+                  blob_with_table, &trie_blob, &normalized_blob, &table_blob)
+                  .ok());
+  EXPECT_EQ("foo", trie_blob);
+  EXPECT_EQ("bar", normalized_blob);
+  EXPECT_EQ("baz", table_blob);
+
+  EXPECT_TRUE(Normalizer::DecodePrecompiledCharsMap(blob, &trie_blob,
+                                                    &normalized_blob,
+                                                    &table_blob)
+                  .ok());
+  EXPECT_TRUE(table_blob.empty());
+
+  // The table is larger than the blob.
+  std::string broken = blob_with_table;
+  broken[broken.size() - 8] = 100;
+  EXPECT_FALSE(Normalizer::DecodePrecompiledCharsMap(
+                   broken, &trie_blob, &normalized_blob, &table_blob)
+                   .ok());
+}
+
+TEST(NormalizerTest, PrecompiledCharsMapTableTest) {
+  Builder::CharsMap chars_map;
+  chars_map[{0x61}] = {0x41};             // a => A
+  chars_map[{0x65}] = {0x45};             // e => E
+  chars_map[{0x65, 0x0301}] = {0xE9};     // e + U+0301 => é
+  chars_map[{0xFF21}] = {0x41};           // Ａ => A
+  chars_map[{0x3042, 0x3044}] = {0x78};   // あい => x
+  chars_map[{0x1F600}] = {0x3A, 0x29};    // U+1F600 => :)
+  chars_map[{0x00A0}] = {0x20};           // NBSP => ' '
+  chars_map[{0x01}] = {};                 // Removed.
+
+  NormalizerSpec spec;
+  ASSERT_TRUE(
+      Builder::CompileCharsMap(chars_map, spec.mutable_precompiled_charsmap())
+          .ok());
+
+  absl::string_view trie_blob, normalized_blob, table_blob;
+  ASSERT_TRUE(Normalizer::DecodePrecompiledCharsMap(
+                  spec.precompiled_charsmap(), &trie_blob, &normalized_blob,
+                  &table_blob)
+                  .ok());
+  EXPECT_FALSE(table_blob.empty());
+
+  // The blob without the table, as made by the older versions.
+  NormalizerSpec trie_only_spec;
+  trie_only_spec.set_precompiled_charsmap(
+      Normalizer::EncodePrecompiledCharsMap(trie_blob, normalized_blob));
+
+  Builder::CharsMap decompiled_chars_map;
+  EXPECT_TRUE(Builder::DecompileCharsMap(spec.precompiled_charsmap(),
+                                         &decompiled_chars_map)
+                  .ok());
+  EXPECT_EQ(chars_map, decompiled_chars_map);
+
+  const Normalizer normalizer(spec);
+  const Normalizer trie_only_normalizer(trie_only_spec);
+  EXPECT_EQ(WS "Abc\xc3\xa9" WS "x",
+            normalizer.Normalize("abce\xcc\x81 あい"));
+
+  std::string output, expected;
+  std::vector<uint32> n2i, expected_n2i;
+  for (const char *input :
+       {"abcde", "e\xcc\x81", "e\xcc\x80", "ＡＡ\xc2\xa0Ａ", "あいう",
+        "あう", "\xf0\x9f\x98\x80!", "\x01x\x01", "\xef\xbf\xbd",
+        "\xe3\x81", "\xed\xa0\x80", "\xf4\x90\x80\x80"}) {
+    EXPECT_TRUE(normalizer.Normalize(input, &output, &n2i).ok());
+    EXPECT_TRUE(
+        trie_only_normalizer.Normalize(input, &expected, &expected_n2i).ok());
+    EXPECT_EQ(expected, output);
+    EXPECT_EQ(expected_n2i, n2i);
+  }
+
+  // The built-in chars map has the table, either compiled in or added from
+  // its trie. Both it and the table compiled from the rules agree with the
+  // trie over the BMP.
+  const NormalizerSpec builtin_spec = MakeDefaultSpec();
+  ASSERT_TRUE(Normalizer::DecodePrecompiledCharsMap(
+                  builtin_spec.precompiled_charsmap(), &trie_blob,
+                  &normalized_blob, &table_blob)
+                  .ok());
+  EXPECT_FALSE(table_blob.empty());
+  trie_only_spec.set_precompiled_charsmap(
+      Normalizer::EncodePrecompiledCharsMap(trie_blob, normalized_blob));
+
+  NormalizerSpec compiled_spec = builtin_spec;
+  ASSERT_TRUE(Builder::DecompileCharsMap(builtin_spec.precompiled_charsmap(),
+                                         &decompiled_chars_map)
+                  .ok());
+  ASSERT_TRUE(
+      Builder::CompileCharsMap(decompiled_chars_map,
+                               compiled_spec.mutable_precompiled_charsmap())
+          .ok());
+  ASSERT_TRUE(Normalizer::DecodePrecompiledCharsMap(
+                  compiled_spec.precompiled_charsmap(), &trie_blob,
+                  &normalized_blob, &table_blob)
+                  .ok());
+  EXPECT_FALSE(table_blob.empty());
+
+  const Normalizer builtin_normalizer(builtin_spec);
+  const Normalizer compiled_normalizer(compiled_spec);
+  const Normalizer builtin_trie_only_normalizer(trie_only_spec);
+  std::string all_bmp;
+  for (char32 c = 1; c < 0x10000; ++c) {
+    if (c >= 0xD800 && c < 0xE000) continue;
+    all_bmp += string_util::UnicodeCharToUTF8(c);
+    if (c % 64 == 0) {
+      expected = builtin_trie_only_normalizer.Normalize(all_bmp);
+      EXPECT_EQ(expected, builtin_normalizer.Normalize(all_bmp));
+      EXPECT_EQ(expected, compiled_normalizer.Normalize(all_bmp));
+      all_bmp.clear();
+    }
+  }
 }
 
 TEST(NormalizerTest, StatusTest) {
@@ -392,6 +601,7 @@ TEST(NormalizerTest, StatusTest) {
 
 TEST(NormalizerTest, PrefixMatcherTest) {
   const PrefixMatcher matcher({"abc", "ab", "xy", "京都"});
+  EXPECT_FALSE(matcher.empty());
   bool found;
   EXPECT_EQ(1, matcher.PrefixMatch("test", &found));
   EXPECT_FALSE(found);
@@ -415,6 +625,7 @@ TEST(NormalizerTest, PrefixMatcherTest) {
 
 TEST(NormalizerTest, PrefixMatcherWithEmptyTest) {
   const PrefixMatcher matcher({});
+  EXPECT_TRUE(matcher.empty());
   bool found;
   EXPECT_EQ(1, matcher.PrefixMatch("test", &found));
   EXPECT_FALSE(found);
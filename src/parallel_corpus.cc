@@ -0,0 +1,227 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "parallel_corpus.h"
+
+#include <algorithm>
+
+#include "normalizer.h"
+#include "third_party/absl/memory/memory.h"
+#include "trainer_interface.h"
+
+namespace sentencepiece {
+namespace {
+
+// Same seed as the sampler of TrainerInterface::LoadSentences().
+constexpr size_t kSeed = 12345678;
+
+// Removes the first line of |data| and stores it to |line|.
+bool ConsumeLine(absl::string_view *data, absl::string_view *line) {
+  if (data->empty()) return false;
+  const size_t pos = data->find('\n');
+  if (pos == absl::string_view::npos) {
+    *line = *data;
+    *data = absl::string_view();
+  } else {
+    *line = data->substr(0, pos);
+    data->remove_prefix(pos + 1);
+  }
+  return true;
+}
+
+class PairIterator : public SentenceIterator {
+ public:
+  PairIterator(const std::vector<ParallelCorpus::Pair> *pairs, bool is_src)
+      : pairs_(pairs), is_src_(is_src) {
+    Update();
+  }
+
+  bool done() const override { return index_ >= pairs_->size(); }
+  void Next() override {
+    ++index_;
+    Update();
+  }
+  const std::string &value() const override { return value_; }
+  util::Status status() const override { return util::OkStatus(); }
+
+ private:
+  void Update() {
+    if (done()) return;
+    const auto &pair = (*pairs_)[index_];
+    const absl::string_view s = is_src_ ? pair.first : pair.second;
+    value_.assign(s.data(), s.size());
+  }
+
+  const std::vector<ParallelCorpus::Pair> *pairs_ = nullptr;
+  const bool is_src_;
+  size_t index_ = 0;
+  std::string value_;
+};
+
+// Returns true if TrainerInterface::LoadSentences() skips |sentence|.
+bool IsSkipped(absl::string_view sentence, const TrainerSpec &trainer_spec) {
+  return sentence.empty() ||
+         sentence.size() >
+             static_cast<size_t>(trainer_spec.max_sentence_length()) ||
+         sentence.find(TrainerInterface::kUNKStr) != absl::string_view::npos;
+}
+}  // namespace
+
+ParallelCorpus::ParallelCorpus(const TrainerSpec &src_trainer_spec,
+                               const TrainerSpec &tgt_trainer_spec,
+                               const NormalizerSpec &normalizer_spec)
+    : src_trainer_spec_(src_trainer_spec),
+      tgt_trainer_spec_(tgt_trainer_spec),
+      normalizer_spec_(normalizer_spec) {
+  if (src_trainer_spec_.input_sentence_size() > 0 &&
+      src_trainer_spec_.shuffle_input_sentence()) {
+    sampler_ = absl::make_unique<random::ReservoirSampler<Pair>>(
+        &pairs_, src_trainer_spec_.input_sentence_size(), kSeed);
+  }
+}
+
+util::Status ParallelCorpus::CheckSpecs() const {
+  CHECK_OR_RETURN(pairs_.empty());
+  CHECK_EQ_OR_RETURN(src_trainer_spec_.input_sentence_size(),
+                     tgt_trainer_spec_.input_sentence_size())
+      << "Both sides must have the same input_sentence_size.";
+  CHECK_EQ_OR_RETURN(src_trainer_spec_.shuffle_input_sentence(),
+                     tgt_trainer_spec_.shuffle_input_sentence())
+      << "Both sides must have the same shuffle_input_sentence.";
+  return util::OkStatus();
+}
+
+util::Status ParallelCorpus::MapFile(absl::string_view filename,
+                                     absl::string_view *data) {
+  LOG(INFO) << "Loading corpus: " << filename;
+  files_.emplace_back(filesystem::NewMappedFile(filename));
+  RETURN_IF_ERROR(files_.back()->status());
+  *data = files_.back()->data();
+  return util::OkStatus();
+}
+
+bool ParallelCorpus::Add(absl::string_view src, absl::string_view tgt) {
+  if (IsSkipped(src, src_trainer_spec_) || IsSkipped(tgt, tgt_trainer_spec_)) {
+    ++skipped_size_;
+    return true;
+  }
+
+  if (sampler_) {
+    sampler_->Add(std::make_pair(src, tgt));
+    return true;
+  }
+
+  pairs_.emplace_back(src, tgt);
+  return src_trainer_spec_.input_sentence_size() <= 0 ||
+         pairs_.size() <
+             static_cast<size_t>(src_trainer_spec_.input_sentence_size());
+}
+
+util::Status ParallelCorpus::LoadTsv(const std::vector<std::string> &files) {
+  RETURN_IF_ERROR(CheckSpecs());
+  for (const auto &filename : files) {
+    absl::string_view data, line;
+    RETURN_IF_ERROR(MapFile(filename, &data));
+    while (ConsumeLine(&data, &line)) {
+      // An empty line is a pair with empty sides.
+      if (line.empty()) {
+        ++skipped_size_;
+        continue;
+      }
+      const size_t pos = line.find('\t');
+      CHECK_OR_RETURN(pos != absl::string_view::npos &&
+                      line.find('\t', pos + 1) == absl::string_view::npos)
+          << "Input format must be: src <tab> tgt. " << line;
+      if (!Add(line.substr(0, pos), line.substr(pos + 1))) {
+        return Finish();
+      }
+    }
+  }
+  return Finish();
+}
+
+util::Status ParallelCorpus::LoadAligned(
+    const std::vector<std::string> &src_files,
+    const std::vector<std::string> &tgt_files) {
+  RETURN_IF_ERROR(CheckSpecs());
+  CHECK_EQ_OR_RETURN(src_files.size(), tgt_files.size())
+      << "The numbers of source and target files must be the same.";
+  for (size_t i = 0; i < src_files.size(); ++i) {
+    absl::string_view src_data, tgt_data, src, tgt;
+    RETURN_IF_ERROR(MapFile(src_files[i], &src_data));
+    RETURN_IF_ERROR(MapFile(tgt_files[i], &tgt_data));
+    while (true) {
+      const bool has_src = ConsumeLine(&src_data, &src);
+      const bool has_tgt = ConsumeLine(&tgt_data, &tgt);
+      CHECK_EQ_OR_RETURN(has_src, has_tgt)
+          << src_files[i] << " and " << tgt_files[i]
+          << " have different numbers of lines.";
+      if (!has_src) break;
+      if (!Add(src, tgt)) return Finish();
+    }
+  }
+  return Finish();
+}
+
+void ParallelCorpus::RemoveEmptyNormalized() {
+  const normalizer::Normalizer src_normalizer(normalizer_spec_,
+                                              src_trainer_spec_);
+  const normalizer::Normalizer tgt_normalizer(normalizer_spec_,
+                                              tgt_trainer_spec_);
+  const int num_threads = std::max(1, src_trainer_spec_.num_threads());
+  std::vector<char> empty(pairs_.size(), 0);
+  {
+    auto pool = absl::make_unique<ThreadPool>(num_threads);
+    pool->StartWorkers();
+    for (int n = 0; n < num_threads; ++n) {
+      pool->Schedule([&, n]() {
+        for (size_t i = n; i < pairs_.size(); i += num_threads) {
+          empty[i] = src_normalizer.Normalize(pairs_[i].first).empty() ||
+                     tgt_normalizer.Normalize(pairs_[i].second).empty();
+        }
+      });
+    }
+  }
+
+  size_t size = 0;
+  for (size_t i = 0; i < pairs_.size(); ++i) {
+    if (!empty[i]) pairs_[size++] = pairs_[i];
+  }
+  skipped_size_ += pairs_.size() - size;
+  pairs_.resize(size);
+}
+
+util::Status ParallelCorpus::Finish() {
+  RemoveEmptyNormalized();
+  CHECK_OR_RETURN(!pairs_.empty()) << "No sentence pairs are loaded.";
+  if (skipped_size_ > 0) {
+    LOG(INFO) << "Skipped " << skipped_size_
+              << " pairs with an empty, too long or invalid side.";
+  }
+  if (sampler_) {
+    LOG(INFO) << "Sampled " << pairs_.size() << " pairs from "
+              << sampler_->total_size() << " pairs.";
+  } else {
+    LOG(INFO) << "Loaded " << pairs_.size() << " pairs.";
+  }
+  return util::OkStatus();
+}
+
+std::unique_ptr<SentenceIterator> ParallelCorpus::NewSrcIterator() const {
+  return absl::make_unique<PairIterator>(&pairs_, true);
+}
+
+std::unique_ptr<SentenceIterator> ParallelCorpus::NewTgtIterator() const {
+  return absl::make_unique<PairIterator>(&pairs_, false);
+}
+
+}  // namespace sentencepiece
@@ -0,0 +1,93 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#ifndef PARALLEL_CORPUS_H_
+#define PARALLEL_CORPUS_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "filesystem.h"
+#include "sentencepiece_model.pb.h"
+#include "sentencepiece_trainer.h"
+#include "third_party/absl/strings/string_view.h"
+#include "util.h"
+
+namespace sentencepiece {
+
+// Sentence pairs of a parallel corpus for SentencePieceAlignTrainer.
+// The corpus is read in a single pass, either from tab-separated files of
+// "<src>\t<tgt>" lines or from two lists of line-aligned files. The files
+// are memory-mapped and the pairs point into them.
+//
+// Pairs are filtered and sampled as a whole, so both sides keep the same
+// pairs in the same order. Each side is filtered with its own TrainerSpec
+// in the same way as TrainerInterface::LoadSentences(), including the
+// sentences normalized to empty, so that the trainers keep every pair they
+// are handed. The sampling follows input_sentence_size and
+// shuffle_input_sentence, which must be the same on both sides.
+class ParallelCorpus {
+ public:
+  using Pair = std::pair<absl::string_view, absl::string_view>;
+
+  // |normalizer_spec| must be the one passed to the trainers.
+  ParallelCorpus(const TrainerSpec &src_trainer_spec,
+                 const TrainerSpec &tgt_trainer_spec,
+                 const NormalizerSpec &normalizer_spec);
+
+  // Loads the pairs from tab-separated |files|.
+  util::Status LoadTsv(const std::vector<std::string> &files);
+
+  // Loads the pairs from |src_files| and |tgt_files|. The i-th files of
+  // both sides must have the same number of lines.
+  util::Status LoadAligned(const std::vector<std::string> &src_files,
+                           const std::vector<std::string> &tgt_files);
+
+  const std::vector<Pair> &pairs() const { return pairs_; }
+
+  // Returns iterators over the source and target sides of pairs(), which
+  // are passed to the trainers in place of TrainerSpec::input.
+  std::unique_ptr<SentenceIterator> NewSrcIterator() const;
+  std::unique_ptr<SentenceIterator> NewTgtIterator() const;
+
+ private:
+  // Returns an error if both sides cannot share the sampling.
+  util::Status CheckSpecs() const;
+
+  // Maps |filename| and returns its contents.
+  util::Status MapFile(absl::string_view filename, absl::string_view *data);
+
+  // Adds a pair unless either side is skipped by LoadSentences().
+  // Returns false when no more pairs are needed.
+  bool Add(absl::string_view src, absl::string_view tgt);
+
+  // Removes the pairs of which either side is normalized to empty, which
+  // LoadSentences() removes from each side separately.
+  void RemoveEmptyNormalized();
+
+  // Removes the pairs normalized to empty and logs the number of loaded
+  // pairs.
+  util::Status Finish();
+
+  TrainerSpec src_trainer_spec_;
+  TrainerSpec tgt_trainer_spec_;
+  NormalizerSpec normalizer_spec_;
+  std::vector<std::unique_ptr<filesystem::MappedFile>> files_;
+  std::vector<Pair> pairs_;
+  std::unique_ptr<random::ReservoirSampler<Pair>> sampler_;
+  size_t skipped_size_ = 0;
+};
+
+}  // namespace sentencepiece
+#endif  // PARALLEL_CORPUS_H_
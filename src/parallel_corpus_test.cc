@@ -0,0 +1,167 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "parallel_corpus.h"
+
+#include "filesystem.h"
+#include "testharness.h"
+#include "third_party/absl/memory/memory.h"
+#include "third_party/absl/strings/ascii.h"
+#include "third_party/absl/strings/str_cat.h"
+#include "trainer_interface.h"
+#include "util.h"
+
+namespace sentencepiece {
+namespace {
+
+std::string WriteTestFile(absl::string_view name, absl::string_view data) {
+  const std::string filename =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), name);
+  auto output = filesystem::NewWritableFile(filename);
+  EXPECT_TRUE(output->Write(data));
+  return filename;
+}
+
+std::vector<std::string> ReadAll(SentenceIterator *it) {
+  std::vector<std::string> result;
+  for (; !it->done(); it->Next()) result.push_back(it->value());
+  EXPECT_TRUE(it->status().ok());
+  return result;
+}
+
+TEST(ParallelCorpusTest, LoadTsvTest) {
+  const std::string filename =
+      WriteTestFile("parallel.tsv", "a b\tA B\nc\tC\n\tD\ne\t\n\nf\tF");
+  ParallelCorpus corpus(TrainerSpec{}, TrainerSpec{}, NormalizerSpec{});
+  EXPECT_TRUE(corpus.LoadTsv({filename}).ok());
+
+  // Empty lines and pairs with an empty side are skipped.
+  EXPECT_EQ(3, corpus.pairs().size());
+  EXPECT_EQ(std::vector<std::string>({"a b", "c", "f"}),
+            ReadAll(corpus.NewSrcIterator().get()));
+  EXPECT_EQ(std::vector<std::string>({"A B", "C", "F"}),
+            ReadAll(corpus.NewTgtIterator().get()));
+
+  const std::string invalid = WriteTestFile("invalid.tsv", "a\tA\tB\n");
+  ParallelCorpus corpus2(TrainerSpec{}, TrainerSpec{}, NormalizerSpec{});
+  EXPECT_FALSE(corpus2.LoadTsv({invalid}).ok());
+}
+
+TEST(ParallelCorpusTest, LoadAlignedTest) {
+  const std::string src = WriteTestFile("parallel.src", "a\nb\n\nd\n");
+  const std::string tgt = WriteTestFile("parallel.tgt", "A\nB\nC\nD\n");
+  ParallelCorpus corpus(TrainerSpec{}, TrainerSpec{}, NormalizerSpec{});
+  EXPECT_TRUE(corpus.LoadAligned({src}, {tgt}).ok());
+  EXPECT_EQ(std::vector<std::string>({"a", "b", "d"}),
+            ReadAll(corpus.NewSrcIterator().get()));
+  EXPECT_EQ(std::vector<std::string>({"A", "B", "D"}),
+            ReadAll(corpus.NewTgtIterator().get()));
+
+  const std::string short_tgt = WriteTestFile("short.tgt", "A\nB\n");
+  ParallelCorpus corpus2(TrainerSpec{}, TrainerSpec{}, NormalizerSpec{});
+  EXPECT_FALSE(corpus2.LoadAligned({src}, {short_tgt}).ok());
+
+  ParallelCorpus corpus3(TrainerSpec{}, TrainerSpec{}, NormalizerSpec{});
+  EXPECT_FALSE(corpus3.LoadAligned({src}, {}).ok());
+
+  ParallelCorpus corpus4(TrainerSpec{}, TrainerSpec{}, NormalizerSpec{});
+  EXPECT_FALSE(corpus4.LoadAligned({src}, {"__UNKNOWN_FILE__"}).ok());
+}
+
+TEST(ParallelCorpusTest, SamplingKeepsPairsTest) {
+  std::string src_data, tgt_data;
+  for (int i = 0; i < 1000; ++i) {
+    src_data += absl::StrCat(i) + "\n";
+    tgt_data += absl::StrCat("T", i) + "\n";
+  }
+  const std::string src = WriteTestFile("sample.src", src_data);
+  const std::string tgt = WriteTestFile("sample.tgt", tgt_data);
+
+  for (const bool shuffle : {true, false}) {
+    TrainerSpec trainer_spec;
+    trainer_spec.set_input_sentence_size(100);
+    trainer_spec.set_shuffle_input_sentence(shuffle);
+    ParallelCorpus corpus(trainer_spec, trainer_spec, NormalizerSpec{});
+    EXPECT_TRUE(corpus.LoadAligned({src}, {tgt}).ok());
+    EXPECT_EQ(100, corpus.pairs().size());
+
+    const auto srcs = ReadAll(corpus.NewSrcIterator().get());
+    const auto tgts = ReadAll(corpus.NewTgtIterator().get());
+    ASSERT_EQ(srcs.size(), tgts.size());
+    for (size_t i = 0; i < srcs.size(); ++i) {
+      EXPECT_EQ("T" + srcs[i], tgts[i]);
+    }
+    if (!shuffle) {
+      EXPECT_EQ("0", srcs.front());
+      EXPECT_EQ("99", srcs.back());
+    }
+  }
+}
+
+TEST(ParallelCorpusTest, PerSideMaxSentenceLengthTest) {
+  const std::string src =
+      WriteTestFile("length.src", "aaaaaaaaaaaa\nb\nccccccccccccccccccc\n");
+  const std::string tgt =
+      WriteTestFile("length.tgt", "A\nBBBBBBBBBBBB\nCCCCCCCCCCCCCCCCCCC\n");
+
+  // Each side is filtered with its own limit.
+  TrainerSpec src_spec, tgt_spec;
+  src_spec.set_max_sentence_length(15);
+  tgt_spec.set_max_sentence_length(10);
+  ParallelCorpus corpus(src_spec, tgt_spec, NormalizerSpec{});
+  EXPECT_TRUE(corpus.LoadAligned({src}, {tgt}).ok());
+  EXPECT_EQ(std::vector<std::string>({"aaaaaaaaaaaa"}),
+            ReadAll(corpus.NewSrcIterator().get()));
+  EXPECT_EQ(std::vector<std::string>({"A"}),
+            ReadAll(corpus.NewTgtIterator().get()));
+
+  // Both sides must sample in the same way.
+  tgt_spec.set_input_sentence_size(1000);
+  ParallelCorpus corpus2(src_spec, tgt_spec, NormalizerSpec{});
+  EXPECT_FALSE(corpus2.LoadAligned({src}, {tgt}).ok());
+}
+
+TEST(ParallelCorpusTest, NormalizedToEmptyTest) {
+  const std::string filename = WriteTestFile(
+      "normalized.tsv", "a\tA\n   \tB\nc\t \u3000 \nd\tD\ne\tE\n");
+  TrainerSpec trainer_spec;
+  trainer_spec.set_model_prefix("parallel");
+  trainer_spec.set_split_by_whitespace(false);
+  const NormalizerSpec normalizer_spec =
+      SentencePieceTrainer::GetNormalizerSpec("nmt_nfkc");
+  ParallelCorpus corpus(trainer_spec, trainer_spec, normalizer_spec);
+  EXPECT_TRUE(corpus.LoadTsv({filename}).ok());
+  EXPECT_EQ(std::vector<std::string>({"a", "d", "e"}),
+            ReadAll(corpus.NewSrcIterator().get()));
+
+  // Both trainers keep all the pairs in the same order.
+  std::vector<std::unique_ptr<SentenceIterator>> iterators;
+  iterators.emplace_back(corpus.NewSrcIterator());
+  iterators.emplace_back(corpus.NewTgtIterator());
+  std::vector<std::unique_ptr<TrainerInterface>> trainers;
+  for (const auto &iterator : iterators) {
+    trainers.emplace_back(absl::make_unique<TrainerInterface>(
+        trainer_spec, normalizer_spec, NormalizerSpec{}));
+    trainers.back()->sentence_iterator_ = iterator.get();
+    EXPECT_TRUE(trainers.back()->LoadSentences().ok());
+  }
+  EXPECT_EQ(3, trainers[0]->sentences_->size());
+  EXPECT_EQ(trainers[0]->sentences_->size(), trainers[1]->sentences_->size());
+  for (size_t i = 0; i < trainers[0]->sentences_->size(); ++i) {
+    const auto &src = (*trainers[0]->sentences_)[i].first;
+    const auto &tgt = (*trainers[1]->sentences_)[i].first;
+    EXPECT_EQ(absl::AsciiStrToUpper(src), tgt);
+  }
+}
+
+}  // namespace
+}  // namespace sentencepiece
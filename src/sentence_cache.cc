@@ -0,0 +1,64 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "sentence_cache.h"
+
+#include "metrics.h"
+
+namespace sentencepiece {
+
+constexpr uint32 SentenceCache::kHasPiece;
+constexpr uint32 SentenceCache::kHasSurface;
+constexpr uint32 SentenceCache::kHasOffsets;
+constexpr uint32 SentenceCache::kOffsetMask;
+
+SentenceCache::SentenceCache(size_t max_bytes) : cache_(max_bytes) {}
+
+SentenceCache::~SentenceCache() {}
+
+bool SentenceCache::Lookup(absl::string_view input, absl::string_view options,
+                           std::vector<int> *ids) {
+  const bool found = cache_.Lookup(input, [&](const Result &cached) {
+    if (cached.options != options) return false;
+    *ids = cached.ids;
+    return true;
+  });
+  SPM_METRICS_ADD(SENTENCE_CACHE_HITS, found);
+  SPM_METRICS_ADD(SENTENCE_CACHE_MISSES, !found);
+  return found;
+}
+
+bool SentenceCache::Lookup(absl::string_view input, absl::string_view options,
+                           Result *result) {
+  const bool found = cache_.Lookup(input, [&](const Result &cached) {
+    if (cached.options != options || !cached.has_offsets()) return false;
+    *result = cached;
+    return true;
+  });
+  SPM_METRICS_ADD(SENTENCE_CACHE_HITS, found);
+  SPM_METRICS_ADD(SENTENCE_CACHE_MISSES, !found);
+  return found;
+}
+
+void SentenceCache::Insert(absl::string_view input, absl::string_view options,
+                           Result result) {
+  result.options.assign(options.data(), options.size());
+  size_t bytes = result.ids.size() * sizeof(int) +
+                 result.offsets.size() * sizeof(uint32) + result.options.size();
+  for (const auto &piece : result.pieces) {
+    bytes += sizeof(piece) + piece.size();
+  }
+  const size_t evictions = cache_.Insert(input, std::move(result), bytes);
+  SPM_METRICS_ADD(SENTENCE_CACHE_EVICTIONS, evictions);
+}
+
+}  // namespace sentencepiece
@@ -0,0 +1,93 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#ifndef SENTENCE_CACHE_H_
+#define SENTENCE_CACHE_H_
+
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "lru_cache.h"
+#include "sentencepiece_processor.h"
+#include "third_party/absl/strings/string_view.h"
+
+namespace sentencepiece {
+
+// A bounded LRU cache from an input text to its final encoding, i.e., after
+// the extra options are applied, shared by the encoding threads. Each result
+// is keyed by the extra options it was made with as well as the input.
+class SentenceCache {
+ public:
+  // Flags in the begin offsets of Result::offsets.
+  static constexpr uint32 kHasPiece = 1U << 31;
+  // Flags in the end offsets of Result::offsets.
+  static constexpr uint32 kHasSurface = 1U << 31;
+  static constexpr uint32 kHasOffsets = 1U << 30;
+  static constexpr uint32 kOffsetMask = kHasOffsets - 1;
+
+  struct Result {
+    std::vector<int> ids;
+    // The begin and the end offsets of each piece in the input, or empty
+    // when only the ids are cached. kHasPiece is set if the piece differs
+    // from the piece of its id, e.g., merged unknown pieces. kHasSurface is
+    // set if the piece has a surface, i.e., input[begin, end). kHasOffsets
+    // is not set for the pieces without offsets, e.g., <s> and </s>.
+    std::vector<uint32> offsets;
+    // The pieces with kHasPiece in the order.
+    std::vector<std::string> pieces;
+    // The extra options the result was made with. Set by Insert().
+    std::string options;
+
+    bool has_offsets() const { return offsets.size() == 2 * ids.size(); }
+  };
+
+  // |max_bytes| bounds the memory used by the entries.
+  explicit SentenceCache(size_t max_bytes);
+  ~SentenceCache();
+
+  SentenceCache(const SentenceCache &) = delete;
+  SentenceCache &operator=(const SentenceCache &) = delete;
+
+  // Sets |ids| to the cached ids of |input| with the extra |options| and
+  // returns true. Returns false if not cached.
+  bool Lookup(absl::string_view input, absl::string_view options,
+              std::vector<int> *ids);
+
+  // Sets |result| to the cached result of |input| with the extra |options|
+  // and returns true. Returns false if not cached or only the ids are cached.
+  bool Lookup(absl::string_view input, absl::string_view options,
+              Result *result);
+
+  // Caches |result| of |input| with the extra |options|, replacing the old
+  // one, which may have other options.
+  void Insert(absl::string_view input, absl::string_view options,
+              Result result);
+
+  // Returns true if the offsets of |input| fit in Result::offsets.
+  static bool CanCacheOffsets(absl::string_view input) {
+    return input.size() <= kOffsetMask;
+  }
+
+  // Removes all the entries. The counters of the statistics are kept.
+  void Clear() { cache_.Clear(); }
+
+  CacheStats GetStats() const { return cache_.GetStats(); }
+
+  size_t max_bytes() const { return cache_.max_bytes(); }
+
+ private:
+  ShardedLruCache<Result> cache_;
+};
+
+}  // namespace sentencepiece
+#endif  // SENTENCE_CACHE_H_
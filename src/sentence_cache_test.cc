@@ -0,0 +1,182 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "sentence_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "sentencepiece_processor.h"
+#include "testharness.h"
+#include "third_party/absl/strings/str_cat.h"
+#include "util.h"
+
+namespace sentencepiece {
+namespace {
+
+// Returns the model trained on botchan.txt.
+std::string TrainModel() {
+  static const std::string model = test::TrainModel(
+      "botchan.txt", "sentence_cache",
+      "--vocab_size=1000 --byte_fallback=true --user_defined_symbols=<sep>");
+  return model;
+}
+}  // namespace
+
+TEST(SentenceCacheTest, LookupTest) {
+  SentenceCache cache(1 << 20);
+  std::vector<int> ids;
+  SentenceCache::Result result;
+  EXPECT_FALSE(cache.Lookup("hello", "", &ids));
+
+  SentenceCache::Result ids_only;
+  ids_only.ids = {1, 2, 3};
+  cache.Insert("hello", "", ids_only);
+  EXPECT_TRUE(cache.Lookup("hello", "", &ids));
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), ids);
+  // The offsets are not cached.
+  EXPECT_FALSE(cache.Lookup("hello", "", &result));
+
+  SentenceCache::Result full;
+  full.ids = {4, 5};
+  full.offsets = {0, 2 | SentenceCache::kHasSurface,
+                  2 | SentenceCache::kHasPiece, 5 | SentenceCache::kHasSurface};
+  full.pieces = {"llo"};
+  cache.Insert("hello", "", full);
+  EXPECT_TRUE(cache.Lookup("hello", "", &result));
+  EXPECT_EQ(full.ids, result.ids);
+  EXPECT_EQ(full.offsets, result.offsets);
+  EXPECT_EQ(full.pieces, result.pieces);
+  EXPECT_TRUE(cache.Lookup("hello", "", &ids));
+  EXPECT_EQ(std::vector<int>({4, 5}), ids);
+  // The result made with other extra options is not used.
+  EXPECT_FALSE(cache.Lookup("hello", "1", &ids));
+  EXPECT_FALSE(cache.Lookup("hello", "1", &result));
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(3, stats.hits);
+  EXPECT_EQ(4, stats.misses);
+  EXPECT_EQ(1, stats.entries);
+  EXPECT_LT(0, stats.bytes);
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Lookup("hello", "", &ids));
+  stats = cache.GetStats();
+  EXPECT_EQ(0, stats.entries);
+  EXPECT_EQ(0, stats.bytes);
+
+  // Evicts the least recently used ones.
+  SentenceCache small(64 * 1024);
+  for (int i = 0; i < 10000; ++i) small.Insert(absl::StrCat(i), "", ids_only);
+  stats = small.GetStats();
+  EXPECT_LE(stats.bytes, small.max_bytes());
+  EXPECT_EQ(10000, stats.entries + stats.evictions);
+  EXPECT_TRUE(small.Lookup("9999", "", &ids));
+  EXPECT_FALSE(small.Lookup("0", "", &ids));
+}
+
+TEST(SentenceCacheTest, ProcessorTest) {
+  const std::string model = TrainModel();
+  auto lines = test::ReadLines("botchan.txt", 500);
+  lines.push_back("");
+  lines.push_back("  ");
+  lines.push_back("ＡＢＣ　ｱｲｳ①<sep>");  // Normalized by NFKC.
+  lines.push_back("吾輩は猫である。");     // Unknown pieces.
+
+  SentencePieceProcessor sp;
+  EXPECT_FALSE(sp.SetSentenceCacheSize(1 << 20).ok());
+  EXPECT_EQ(0, sp.GetSentenceCacheStats().hits);
+  ASSERT_TRUE(sp.Load(model).ok());
+  ASSERT_TRUE(sp.SetSentenceCacheSize(1 << 20).ok());
+
+  SentencePieceProcessor expected;
+  ASSERT_TRUE(expected.Load(model).ok());
+
+  for (const char *options : {"", "bos:eos", "reverse:bos"}) {
+    ASSERT_TRUE(sp.SetEncodeExtraOptions(options).ok());
+    ASSERT_TRUE(expected.SetEncodeExtraOptions(options).ok());
+
+    // The second round hits the cache. The ids are cached first, and then
+    // the pieces and the offsets replace them.
+    for (int round = 0; round < 2; ++round) {
+      for (const auto &line : lines) {
+        EXPECT_EQ(expected.EncodeAsIds(line), sp.EncodeAsIds(line));
+        EXPECT_EQ(expected.EncodeAsSerializedProto(line),
+                  sp.EncodeAsSerializedProto(line));
+        EXPECT_EQ(expected.EncodeAsPieces(line), sp.EncodeAsPieces(line));
+      }
+    }
+
+    const std::vector<absl::string_view> inputs(lines.begin(), lines.end());
+    std::vector<std::vector<int>> expected_ids, ids;
+    ASSERT_TRUE(expected.EncodeBatch(inputs, &expected_ids, 2).ok());
+    ASSERT_TRUE(sp.EncodeBatch(inputs, &ids, 2).ok());
+    EXPECT_EQ(expected_ids, ids);
+  }
+
+  auto stats = sp.GetSentenceCacheStats();
+  EXPECT_LT(stats.misses, stats.hits);
+  EXPECT_LT(0, stats.entries);
+
+  // The vocabulary changes the encodings.
+  ASSERT_TRUE(sp.SetVocabulary({"▁the", "▁a"}).ok());
+  ASSERT_TRUE(expected.SetVocabulary({"▁the", "▁a"}).ok());
+  EXPECT_EQ(0, sp.GetSentenceCacheStats().entries);
+  for (const auto &line : lines) {
+    EXPECT_EQ(expected.EncodeAsIds(line), sp.EncodeAsIds(line));
+  }
+  ASSERT_TRUE(sp.ResetVocabulary().ok());
+  ASSERT_TRUE(expected.ResetVocabulary().ok());
+  EXPECT_EQ(0, sp.GetSentenceCacheStats().entries);
+  for (const auto &line : lines) {
+    EXPECT_EQ(expected.EncodeAsIds(line), sp.EncodeAsIds(line));
+  }
+
+  // Disabled.
+  ASSERT_TRUE(sp.SetSentenceCacheSize(0).ok());
+  EXPECT_EQ(0, sp.GetSentenceCacheStats().hits);
+  EXPECT_EQ(expected.EncodeAsIds(lines[0]), sp.EncodeAsIds(lines[0]));
+}
+
+TEST(SentenceCacheTest, ThreadTest) {
+  const std::string model = TrainModel();
+  SentencePieceProcessor sp;
+  ASSERT_TRUE(sp.Load(model).ok());
+  ASSERT_TRUE(sp.SetSentenceCacheSize(64 * 1024).ok());
+
+  const auto lines = test::ReadLines("botchan.txt", 200);
+  SentencePieceProcessor expected;
+  ASSERT_TRUE(expected.Load(model).ok());
+  std::vector<std::vector<std::string>> expected_pieces;
+  for (const auto &line : lines) {
+    expected_pieces.push_back(expected.EncodeAsPieces(line));
+  }
+
+  std::vector<int> num_errors(4, 0);
+  {
+    ThreadPool pool(4);
+    for (int n = 0; n < 4; ++n) {
+      pool.Schedule([&, n]() {
+        for (int i = 0; i < 2000; ++i) {
+          const size_t k = (i * (n + 1)) % lines.size();
+          if (sp.EncodeAsPieces(lines[k]) != expected_pieces[k]) {
+            ++num_errors[n];
+          }
+        }
+      });
+    }
+  }
+  for (const int n : num_errors) EXPECT_EQ(0, n);
+  EXPECT_LT(0, sp.GetSentenceCacheStats().hits);
+}
+
+}  // namespace sentencepiece
@@ -0,0 +1,167 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "sentencepiece_pair_processor.h"
+
+#include "model_factory.h"
+#include "model_interface.h"
+#include "normalizer.h"
+#include "sentencepiece_model.pb.h"
+#include "third_party/absl/memory/memory.h"
+#include "util.h"
+
+namespace sentencepiece {
+namespace {
+
+// Returns the user defined symbols, which are matched by the normalizer.
+std::vector<std::string> GetUserDefinedSymbols(const ModelProto &model_proto) {
+  std::vector<std::string> symbols;
+  for (const auto &piece : model_proto.pieces()) {
+    if (piece.type() == ModelProto::SentencePiece::USER_DEFINED) {
+      symbols.push_back(piece.piece());
+    }
+  }
+  return symbols;
+}
+
+// Returns true if both models normalize the input in the same way.
+bool IsSameNormalization(const ModelProto &a, const ModelProto &b) {
+  return a.normalizer_spec().SerializeAsString() ==
+             b.normalizer_spec().SerializeAsString() &&
+         a.trainer_spec().treat_whitespace_as_suffix() ==
+             b.trainer_spec().treat_whitespace_as_suffix() &&
+         GetUserDefinedSymbols(a) == GetUserDefinedSymbols(b);
+}
+}  // namespace
+
+SentencePiecePairProcessor::SentencePiecePairProcessor() {}
+SentencePiecePairProcessor::~SentencePiecePairProcessor() {}
+
+util::Status SentencePiecePairProcessor::Load(absl::string_view src_filename,
+                                              absl::string_view tgt_filename) {
+  auto src_model_proto = absl::make_unique<ModelProto>();
+  auto tgt_model_proto = absl::make_unique<ModelProto>();
+  RETURN_IF_ERROR(io::LoadModelProto(src_filename, src_model_proto.get()));
+  RETURN_IF_ERROR(io::LoadModelProto(tgt_filename, tgt_model_proto.get()));
+  RETURN_IF_ERROR(Load(std::move(src_model_proto), SRC));
+  return Load(std::move(tgt_model_proto), TGT);
+}
+
+util::Status SentencePiecePairProcessor::Load(
+    const ModelProto &src_model_proto, const ModelProto &tgt_model_proto) {
+  RETURN_IF_ERROR(Load(absl::make_unique<ModelProto>(src_model_proto), SRC));
+  return Load(absl::make_unique<ModelProto>(tgt_model_proto), TGT);
+}
+
+util::Status SentencePiecePairProcessor::Load(
+    std::unique_ptr<ModelProto> model_proto, Side side) {
+  model_proto_[side] = std::move(model_proto);
+  model_[side] = ModelFactory::Create(*model_proto_[side]);
+  RETURN_IF_ERROR(model_[side]->status());
+
+  normalizer_[side].reset();
+  if (side == TGT &&
+      IsSameNormalization(*model_proto_[SRC], *model_proto_[TGT])) {
+    return status();
+  }
+
+  normalizer_[side] = absl::make_unique<normalizer::Normalizer>(
+      model_proto_[side]->normalizer_spec(),
+      model_proto_[side]->trainer_spec());
+
+  // Escapes user-defined-symbols in normalizer.
+  normalizer_[side]->SetPrefixMatcher(model_[side]->prefix_matcher());
+  return normalizer_[side]->status();
+}
+
+util::Status SentencePiecePairProcessor::status() const {
+  for (const Side side : {SRC, TGT}) {
+    CHECK_OR_RETURN(model_[side]) << "Model is not initialized.";
+    RETURN_IF_ERROR(model_[side]->status());
+  }
+  CHECK_OR_RETURN(normalizer_[SRC]) << "Normalizer is not initialized.";
+  RETURN_IF_ERROR(normalizer_[SRC]->status());
+  return util::OkStatus();
+}
+
+bool SentencePiecePairProcessor::shares_normalizer() const {
+  return normalizer_[SRC] && !normalizer_[TGT];
+}
+
+util::Status SentencePiecePairProcessor::Encode(absl::string_view input,
+                                                Side side,
+                                                std::vector<int> *ids) const {
+  const auto &normalizer =
+      normalizer_[side] ? normalizer_[side] : normalizer_[SRC];
+  std::string normalized;
+  RETURN_IF_ERROR(normalizer->Normalize(input, &normalized, nullptr));
+  return EncodeResultToIds(*model_[side], model_[side]->Encode(normalized),
+                           ids);
+}
+
+util::Status SentencePiecePairProcessor::Encode(
+    absl::string_view src, absl::string_view tgt, std::vector<int> *src_ids,
+    std::vector<int> *tgt_ids) const {
+  RETURN_IF_ERROR(status());
+  CHECK_OR_RETURN(src_ids && tgt_ids) << "output container is null";
+  src_ids->clear();
+  tgt_ids->clear();
+  RETURN_IF_ERROR(Encode(src, SRC, src_ids));
+  return Encode(tgt, TGT, tgt_ids);
+}
+
+util::Status SentencePiecePairProcessor::EncodeBatch(
+    const std::vector<Pair> &pairs, int num_threads,
+    std::vector<IdsPair> *ids) const {
+  RETURN_IF_ERROR(status());
+  CHECK_OR_RETURN(ids) << "output container is null";
+  CHECK_GT_OR_RETURN(num_threads, 0);
+  ids->clear();
+  ids->resize(pairs.size());
+
+  // Each thread encodes a contiguous range of pairs.
+  num_threads = std::min<int>(num_threads, std::max<size_t>(pairs.size(), 1));
+  const size_t chunk_size = (pairs.size() + num_threads - 1) / num_threads;
+  std::vector<util::Status> statuses(num_threads);
+  {
+    auto pool = absl::make_unique<ThreadPool>(num_threads);
+    pool->StartWorkers();
+    for (int n = 0; n < num_threads; ++n) {
+      pool->Schedule([&, n]() {
+        const size_t end = std::min(pairs.size(), (n + 1) * chunk_size);
+        for (size_t i = n * chunk_size; i < end; ++i) {
+          auto &output = (*ids)[i];
+          statuses[n] = Encode(pairs[i].first, SRC, &output.first);
+          if (statuses[n].ok()) {
+            statuses[n] = Encode(pairs[i].second, TGT, &output.second);
+          }
+          if (!statuses[n].ok()) return;
+        }
+      });
+    }
+  }
+
+  for (const auto &status : statuses) {
+    RETURN_IF_ERROR(status);
+  }
+  return util::OkStatus();
+}
+
+const ModelProto &SentencePiecePairProcessor::src_model_proto() const {
+  return *model_proto_[SRC];
+}
+
+const ModelProto &SentencePiecePairProcessor::tgt_model_proto() const {
+  return *model_proto_[TGT];
+}
+
+}  // namespace sentencepiece
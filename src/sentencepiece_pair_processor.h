@@ -0,0 +1,97 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#ifndef SENTENCEPIECE_PAIR_PROCESSOR_H_
+#define SENTENCEPIECE_PAIR_PROCESSOR_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sentencepiece_processor.h"
+
+namespace sentencepiece {
+
+// SentencePiecePairProcessor encodes aligned (source, target) sentence pairs
+// with the two models made by spm_train_align.
+//
+// Usage:
+//   SentencePiecePairProcessor pp;
+//   const auto status = pp.Load("m.src.model", "m.tgt.model");
+//   if (!status.ok()) {
+//      std::cerr << status.ToString() << std::endl;
+//      // error
+//   }
+//
+//   std::vector<int> src_ids, tgt_ids;
+//   pp.Encode("hello world.", "hallo welt.", &src_ids, &tgt_ids);
+//
+// The ids are the same as SentencePieceProcessor::Encode() of each model
+// without extra options, but are made without building SentencePieceText.
+// Both sides share one normalizer when they normalize the input in the
+// same way. Use SentencePieceProcessor to decode the ids.
+class SentencePiecePairProcessor {
+ public:
+  using Pair = std::pair<std::string, std::string>;
+  using IdsPair = std::pair<std::vector<int>, std::vector<int>>;
+
+  SentencePiecePairProcessor();
+  virtual ~SentencePiecePairProcessor();
+
+  // Loads the source and target models from files.
+  virtual util::Status Load(absl::string_view src_filename,
+                            absl::string_view tgt_filename);
+
+  // Loads the source and target models from model protos, which are copied.
+  virtual util::Status Load(const ModelProto &src_model_proto,
+                            const ModelProto &tgt_model_proto);
+
+  // Returns the status. Encode methods are valid when status is OK.
+  virtual util::Status status() const;
+
+  // Returns true if both sides use the same normalizer.
+  bool shares_normalizer() const;
+
+  // Encodes |src| and |tgt| into the ids of each model.
+  virtual util::Status Encode(absl::string_view src, absl::string_view tgt,
+                              std::vector<int> *src_ids,
+                              std::vector<int> *tgt_ids) const;
+
+  // Encodes |pairs| on |num_threads| threads. ids[i] holds the ids of
+  // pairs[i].
+  virtual util::Status EncodeBatch(const std::vector<Pair> &pairs,
+                                   int num_threads,
+                                   std::vector<IdsPair> *ids) const;
+
+  // Returns immutable model protos of the source and target models.
+  const ModelProto &src_model_proto() const;
+  const ModelProto &tgt_model_proto() const;
+
+ private:
+  enum Side { SRC = 0, TGT = 1 };
+
+  util::Status Load(std::unique_ptr<ModelProto> model_proto, Side side);
+
+  // Encodes |input| with the model of |side|.
+  util::Status Encode(absl::string_view input, Side side,
+                      std::vector<int> *ids) const;
+
+  std::unique_ptr<ModelProto> model_proto_[2];
+  std::unique_ptr<ModelInterface> model_[2];
+
+  // normalizer_[TGT] is empty when the target side uses normalizer_[SRC].
+  std::unique_ptr<normalizer::Normalizer> normalizer_[2];
+};
+
+}  // namespace sentencepiece
+#endif  // SENTENCEPIECE_PAIR_PROCESSOR_H_
@@ -0,0 +1,102 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "sentencepiece_pair_processor.h"
+
+#include "sentencepiece_model.pb.h"
+#include "testharness.h"
+#include "util.h"
+
+namespace sentencepiece {
+namespace {
+
+TEST(SentencePiecePairProcessorTest, EncodeTest) {
+  const std::string src_model =
+      test::TrainModel("botchan.txt", "pair_src",
+                       "--vocab_size=1000 --byte_fallback=true");
+  const std::string tgt_model =
+      test::TrainModel("wagahaiwa_nekodearu.txt", "pair_tgt",
+                       "--vocab_size=2000 --character_coverage=0.98 "
+                       "--normalization_rule_name=identity "
+                       "--max_sentence_length=2048");
+
+  SentencePieceProcessor src_sp, tgt_sp;
+  ASSERT_TRUE(src_sp.Load(src_model).ok());
+  ASSERT_TRUE(tgt_sp.Load(tgt_model).ok());
+
+  SentencePiecePairProcessor pp;
+  EXPECT_FALSE(pp.status().ok());
+  ASSERT_TRUE(pp.Load(src_model, tgt_model).ok());
+  EXPECT_FALSE(pp.shares_normalizer());
+
+  // Each side is encoded in the other's script as well, so that runs of
+  // unknown pieces and byte fallback are covered.
+  const auto en = test::ReadLines("botchan.txt", 100);
+  const auto ja = test::ReadLines("wagahaiwa_nekodearu.txt", 100);
+  std::vector<SentencePiecePairProcessor::Pair> pairs;
+  for (size_t i = 0; i < std::min(en.size(), ja.size()); ++i) {
+    pairs.emplace_back(en[i], ja[i]);
+    pairs.emplace_back(ja[i], en[i]);
+  }
+
+  std::vector<SentencePiecePairProcessor::IdsPair> batch;
+  ASSERT_TRUE(pp.EncodeBatch(pairs, 3, &batch).ok());
+  ASSERT_EQ(pairs.size(), batch.size());
+
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    std::vector<int> src_ids, tgt_ids;
+    ASSERT_TRUE(pp.Encode(pairs[i].first, pairs[i].second, &src_ids, &tgt_ids)
+                    .ok());
+    EXPECT_EQ(src_sp.EncodeAsIds(pairs[i].first), src_ids);
+    EXPECT_EQ(tgt_sp.EncodeAsIds(pairs[i].second), tgt_ids);
+    EXPECT_EQ(src_ids, batch[i].first);
+    EXPECT_EQ(tgt_ids, batch[i].second);
+  }
+
+  // Empty batch.
+  ASSERT_TRUE(pp.EncodeBatch({}, 3, &batch).ok());
+  EXPECT_TRUE(batch.empty());
+  EXPECT_FALSE(pp.EncodeBatch(pairs, 0, &batch).ok());
+}
+
+TEST(SentencePiecePairProcessorTest, SharedNormalizerTest) {
+  const std::string src_model =
+      test::TrainModel("botchan.txt", "pair_src", "--vocab_size=1000");
+  const std::string tgt_model =
+      test::TrainModel("botchan.txt", "pair_tgt", "--vocab_size=2000");
+
+  SentencePiecePairProcessor pp;
+  ASSERT_TRUE(pp.Load(src_model, tgt_model).ok());
+  EXPECT_TRUE(pp.shares_normalizer());
+  EXPECT_EQ(1000, pp.src_model_proto().pieces_size());
+  EXPECT_EQ(2000, pp.tgt_model_proto().pieces_size());
+
+  SentencePieceProcessor tgt_sp;
+  ASSERT_TRUE(tgt_sp.Load(tgt_model).ok());
+  std::vector<int> src_ids, tgt_ids;
+  ASSERT_TRUE(pp.Encode("Hello world.", "I saw a girl with a telescope.",
+                        &src_ids, &tgt_ids)
+                  .ok());
+  EXPECT_EQ(tgt_sp.EncodeAsIds("I saw a girl with a telescope."), tgt_ids);
+
+  // User defined symbols are matched by the normalizer.
+  const std::string tgt_model_with_symbols =
+      test::TrainModel("botchan.txt", "pair_tgt",
+                       "--vocab_size=2000 --user_defined_symbols=<x>");
+  ASSERT_TRUE(pp.Load(src_model, tgt_model_with_symbols).ok());
+  EXPECT_FALSE(pp.shares_normalizer());
+
+  EXPECT_FALSE(pp.Load(src_model, "__UNKNOWN_FILE__").ok());
+}
+
+}  // namespace
+}  // namespace sentencepiece
@@ -12,16 +12,22 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.!
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <set>
+#include <thread>
 #include <utility>
 
 #include "common.h"
 #include "filesystem.h"
+#include "metrics.h"
 #include "model_factory.h"
 #include "model_interface.h"
 #include "normalizer.h"
 #include "sentencepiece.pb.h"
+#include "sentence_cache.h"
 #include "sentencepiece_processor.h"
 #include "third_party/absl/memory/memory.h"
 #include "third_party/absl/strings/numbers.h"
@@ -44,8 +50,107 @@ const char kSpaceSymbol[] = "\xe2\x96\x81";
 // since this character can be useful both for user and
 // developer. We can easily figure out that <unk> is emitted.
 const char kDefaultUnknownSymbol[] = " \xE2\x81\x87 ";
+
+// Returns the byte piece of |c|, e.g., "<0x3A>", which is never freed.
+absl::string_view GetBytePiece(unsigned char c) {
+  static const auto *const kPieces = []() {
+    auto *pieces = new std::vector<std::string>(256);
+    for (int i = 0; i < 256; ++i) (*pieces)[i] = ByteToPiece(i);
+    return pieces;
+  }();
+  return (*kPieces)[c];
+}
+
+// Returns the number of the batch workers for |size| inputs.
+int GetNumWorkers(size_t size, int num_threads, size_t chunk_size) {
+  if (num_threads <= 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  return std::max<int>(
+      1, std::min<size_t>(num_threads, (size + chunk_size - 1) / chunk_size));
+}
+
+constexpr size_t kBatchChunkSize = 16;
+
+// The thread local buffer of the normalized text is released when it grows
+// larger than this.
+constexpr size_t kMaxNormalizedBufferSize = 1 << 20;
+
+// Runs |func|(worker, begin, end) for the chunks [begin, end) of [0, size)
+// on |num_workers| threads. Each worker takes chunks of consecutive indices,
+// so that the workers neither write to the same cache lines nor wait on a
+// lock. Returns the error of the first failed chunk.
+util::Status RunBatchChunks(
+    size_t size, int num_workers,
+    const std::function<util::Status(int worker, size_t begin, size_t end)>
+        &func) {
+  std::atomic<size_t> next(0);
+  std::vector<size_t> error_index(num_workers, size);
+  std::vector<util::Status> errors(num_workers);
+  auto run = [&](int worker) {
+    while (true) {
+      const size_t begin = next.fetch_add(kBatchChunkSize);
+      if (begin >= size) break;
+      const size_t end = std::min(size, begin + kBatchChunkSize);
+      auto status = func(worker, begin, end);
+      if (!status.ok() && begin < error_index[worker]) {
+        error_index[worker] = begin;
+        errors[worker] = std::move(status);
+      }
+    }
+  };
+
+  {
+    // The calling thread runs the worker 0.
+    ThreadPool pool(num_workers - 1);
+    for (int n = 1; n < num_workers; ++n) {
+      pool.Schedule([&run, n]() { run(n); });
+    }
+    run(0);
+  }
+
+  int first = 0;
+  for (int n = 1; n < num_workers; ++n) {
+    if (error_index[n] < error_index[first]) first = n;
+  }
+  return std::move(errors[first]);
+}
+
+// Runs |func|(worker, i) for all i in [0, size) on |num_workers| threads.
+// Returns the error of the smallest failed index.
+util::Status RunBatch(
+    size_t size, int num_workers,
+    const std::function<util::Status(int worker, size_t i)> &func) {
+  return RunBatchChunks(size, num_workers,
+                        [&func](int worker, size_t begin, size_t end) {
+                          for (size_t i = begin; i < end; ++i) {
+                            RETURN_IF_ERROR(func(worker, i));
+                          }
+                          return util::OkStatus();
+                        });
+}
 }  // namespace
 
+SentencePieceSpans::SentencePieceSpans() {}
+SentencePieceSpans::~SentencePieceSpans() {}
+
+void SentencePieceSpans::Clear() {
+  normalized_.clear();
+  norm_to_orig_.clear();
+  pieces_.clear();
+  ids_.clear();
+  begins_.clear();
+  ends_.clear();
+}
+
+void SentencePieceSpans::Add(absl::string_view piece, int id, size_t begin,
+                             size_t end) {
+  pieces_.push_back(piece);
+  ids_.push_back(id);
+  begins_.push_back(begin);
+  ends_.push_back(end);
+}
+
 SentencePieceProcessor::SentencePieceProcessor() {}
 SentencePieceProcessor::~SentencePieceProcessor() {}
 
@@ -75,6 +180,7 @@ util::Status SentencePieceProcessor::LoadFromSerializedProto(
 
 util::Status SentencePieceProcessor::Load(
     std::unique_ptr<ModelProto> model_proto) {
+  if (sentence_cache_ != nullptr) sentence_cache_->Clear();
   model_proto_ = std::move(model_proto);
   model_ = ModelFactory::Create(*model_proto_);
   normalizer_ = absl::make_unique<normalizer::Normalizer>(
@@ -116,6 +222,7 @@ util::Status SentencePieceProcessor::Load(
 
 util::Status SentencePieceProcessor::SetEncoderVersion(
     EncoderVersion encoder_version) {
+  if (sentence_cache_ != nullptr) sentence_cache_->Clear();
   return model_->SetEncoderVersion(encoder_version);
 }
 
@@ -123,9 +230,19 @@ EncoderVersion SentencePieceProcessor::GetEncoderVersion() const {
   return model_->GetEncoderVersion();
 }
 
+std::string SentencePieceProcessor::GetEncoderVariant() const {
+  if (model_ == nullptr) return "";
+  return model_->GetEncoderVariant();
+}
+
 util::Status SentencePieceProcessor::SetEncodeExtraOptions(
     absl::string_view extra_options) {
-  return ParseExtraOptions(extra_options, &encode_extra_options_);
+  encode_extra_options_key_.clear();
+  RETURN_IF_ERROR(ParseExtraOptions(extra_options, &encode_extra_options_));
+  for (const auto option : encode_extra_options_) {
+    encode_extra_options_key_.push_back('0' + option);
+  }
+  return util::OkStatus();
 }
 
 util::Status SentencePieceProcessor::SetDecodeExtraOptions(
@@ -167,6 +284,8 @@ util::Status SentencePieceProcessor::SetVocabulary(
       piece->set_type(ModelProto::SentencePiece::UNUSED);
     }
   }
+  model_->InitializePieceTable();
+  if (sentence_cache_ != nullptr) sentence_cache_->Clear();
 
   return util::OkStatus();
 }
@@ -177,6 +296,8 @@ util::Status SentencePieceProcessor::ResetVocabulary() {
     if (piece.type() == ModelProto::SentencePiece::UNUSED)
       piece.set_type(ModelProto::SentencePiece::NORMAL);
   }
+  model_->InitializePieceTable();
+  if (sentence_cache_ != nullptr) sentence_cache_->Clear();
 
   return util::OkStatus();
 }
@@ -233,12 +354,62 @@ util::Status SentencePieceProcessor::Encode(
 
 util::Status SentencePieceProcessor::Encode(absl::string_view input,
                                             std::vector<int> *ids) const {
+  // Only the ids are returned, so the normalized text is written into a
+  // buffer reused across the calls in the thread.
+  thread_local static std::string normalized;
+  const auto status = EncodeToIds(&input, 1, &normalized, ids);
+  if (normalized.capacity() > kMaxNormalizedBufferSize) {
+    std::string().swap(normalized);
+  }
+  return status;
+}
+
+util::Status SentencePieceProcessor::EncodeToIds(
+    const absl::string_view *inputs, size_t size, std::string *normalized,
+    std::vector<int> *ids) const {
   CHECK_OR_RETURN_STATUS_STL(ids);
 
-  SentencePieceText spt;
-  RETURN_IF_ERROR(Encode(input, &spt));
-  for (const auto &sp : spt.pieces()) {
-    ids->emplace_back(sp.id());
+  // Makes the ids without SentencePieceText, as neither the alignment nor
+  // the surfaces are needed.
+  std::vector<absl::string_view> chunk;
+  std::vector<size_t> chunk_indices;
+  for (size_t i = 0; i < size; ++i) {
+    SPM_METRICS_ADD(ENCODE_CALLS, 1);
+    SPM_METRICS_ADD(INPUT_BYTES, inputs[i].size());
+    if (sentence_cache_ != nullptr &&
+        sentence_cache_->Lookup(inputs[i], encode_extra_options_key_,
+                                &ids[i])) {
+      SPM_METRICS_ADD(OUTPUT_PIECES, ids[i].size());
+      continue;
+    }
+    RETURN_IF_ERROR(Normalize(inputs[i], &normalized[i], nullptr));
+    chunk.push_back(normalized[i]);
+    chunk_indices.push_back(i);
+  }
+
+  std::vector<EncodeResult> results;
+  {
+    SPM_METRICS_TIMER(ENCODE);
+    if (chunk.size() == 1) {
+      results.push_back(model_->Encode(chunk[0]));
+    } else if (!chunk.empty()) {
+      results = model_->EncodeBatch(chunk);
+    }
+  }
+
+  SPM_METRICS_TIMER(POPULATE);
+  for (size_t k = 0; k < chunk_indices.size(); ++k) {
+    const size_t i = chunk_indices[k];
+    ids[i].clear();
+    RETURN_IF_ERROR(EncodeResultToIds(*model_, results[k], &ids[i]));
+    RETURN_IF_ERROR(ApplyExtraOptions(encode_extra_options_, &ids[i]));
+    SPM_METRICS_ADD(OUTPUT_PIECES, ids[i].size());
+    if (sentence_cache_ != nullptr) {
+      SentenceCache::Result cached;
+      cached.ids = ids[i];
+      sentence_cache_->Insert(inputs[i], encode_extra_options_key_,
+                              std::move(cached));
+    }
   }
 
   return util::OkStatus();
@@ -266,6 +437,120 @@ util::Status SentencePieceProcessor::Decode(const std::vector<int> &ids,
   return util::OkStatus();
 }
 
+util::Status SentencePieceProcessor::EncodeBatch(
+    const std::vector<absl::string_view> &inputs,
+    std::vector<std::vector<std::string>> *pieces, int num_threads) const {
+  RETURN_IF_ERROR(status());
+  CHECK_OR_RETURN(pieces) << "output container is null";
+  pieces->resize(inputs.size());
+
+  // Each worker encodes into its own spans, which keep their buffers
+  // across the inputs.
+  const int num_workers =
+      GetNumWorkers(inputs.size(), num_threads, kBatchChunkSize);
+  std::vector<SentencePieceSpans> spans(num_workers);
+  return RunBatch(
+      inputs.size(), num_workers, [&](int worker, size_t i) -> util::Status {
+        auto *output = &(*pieces)[i];
+        output->clear();
+        RETURN_IF_ERROR(Encode(inputs[i], &spans[worker]));
+        output->reserve(spans[worker].size());
+        for (const auto &piece : spans[worker].pieces()) {
+          output->emplace_back(piece.data(), piece.size());
+        }
+        return util::OkStatus();
+      });
+}
+
+util::Status SentencePieceProcessor::EncodeBatch(
+    const std::vector<absl::string_view> &inputs,
+    std::vector<std::vector<int>> *ids, int num_threads) const {
+  RETURN_IF_ERROR(status());
+  CHECK_OR_RETURN(ids) << "output container is null";
+  ids->resize(inputs.size());
+
+  // The model encodes each chunk at once, which lets it overlap the trie
+  // lookups of the sentences.
+  const int num_workers =
+      GetNumWorkers(inputs.size(), num_threads, kBatchChunkSize);
+  std::vector<std::vector<std::string>> normalized(
+      num_workers, std::vector<std::string>(kBatchChunkSize));
+  return RunBatchChunks(
+      inputs.size(), num_workers,
+      [&](int worker, size_t begin, size_t end) {
+        return EncodeToIds(&inputs[begin], end - begin,
+                           normalized[worker].data(), &(*ids)[begin]);
+      });
+}
+
+util::Status SentencePieceProcessor::DecodeBatch(
+    const std::vector<std::vector<std::string>> &pieces,
+    std::vector<std::string> *detokenized, int num_threads) const {
+  RETURN_IF_ERROR(status());
+  CHECK_OR_RETURN(detokenized) << "output container is null";
+  detokenized->resize(pieces.size());
+  return RunBatch(pieces.size(),
+                  GetNumWorkers(pieces.size(), num_threads, kBatchChunkSize),
+                  [&](int, size_t i) {
+                    return Decode(pieces[i], &(*detokenized)[i]);
+                  });
+}
+
+util::Status SentencePieceProcessor::DecodeBatch(
+    const std::vector<std::vector<int>> &ids,
+    std::vector<std::string> *detokenized, int num_threads) const {
+  RETURN_IF_ERROR(status());
+  CHECK_OR_RETURN(detokenized) << "output container is null";
+  detokenized->resize(ids.size());
+  return RunBatch(ids.size(),
+                  GetNumWorkers(ids.size(), num_threads, kBatchChunkSize),
+                  [&](int, size_t i) {
+                    return Decode(ids[i], &(*detokenized)[i]);
+                  });
+}
+
+util::Status SentencePieceProcessor::OptimizeTrieLayout(
+    const std::vector<absl::string_view> &sample, bool use_huge_pages) {
+  RETURN_IF_ERROR(status());
+
+  // The model searches the normalized text, while the normalizer searches
+  // the input text.
+  std::vector<std::string> normalized(sample.size());
+  std::vector<absl::string_view> normalized_sample;
+  normalized_sample.reserve(sample.size());
+  for (size_t i = 0; i < sample.size(); ++i) {
+    RETURN_IF_ERROR(Normalize(sample[i], &normalized[i], nullptr));
+    normalized_sample.push_back(normalized[i]);
+  }
+
+  RETURN_IF_ERROR(normalizer_->RelayoutTrie(sample, use_huge_pages));
+  return model_->RelayoutTrie(normalized_sample, use_huge_pages);
+}
+
+util::Status SentencePieceProcessor::SetWordCacheSize(size_t max_bytes) {
+  RETURN_IF_ERROR(status());
+  return model_->SetWordCacheSize(max_bytes);
+}
+
+CacheStats SentencePieceProcessor::GetWordCacheStats() const {
+  if (model_ == nullptr || model_->word_cache() == nullptr) return {};
+  return model_->word_cache()->GetStats();
+}
+
+util::Status SentencePieceProcessor::SetSentenceCacheSize(size_t max_bytes) {
+  RETURN_IF_ERROR(status());
+  sentence_cache_.reset();
+  if (max_bytes > 0) {
+    sentence_cache_ = absl::make_unique<SentenceCache>(max_bytes);
+  }
+  return util::OkStatus();
+}
+
+CacheStats SentencePieceProcessor::GetSentenceCacheStats() const {
+  if (sentence_cache_ == nullptr) return {};
+  return sentence_cache_->GetStats();
+}
+
 util::Status SentencePieceProcessor::NBestEncode(
     absl::string_view input, int nbest_size,
     std::vector<std::vector<std::string>> *pieces) const {
@@ -330,10 +615,18 @@ util::Status SentencePieceProcessor::SampleEncode(absl::string_view input,
   return util::OkStatus();
 }
 
+util::Status SentencePieceProcessor::Normalize(
+    absl::string_view input, std::string *normalized,
+    std::vector<uint32> *norm_to_orig) const {
+  SPM_METRICS_TIMER(NORMALIZE);
+  return normalizer_->Normalize(input, normalized, norm_to_orig);
+}
+
 util::Status SentencePieceProcessor::PopulateSentencePieceText(
     absl::string_view input, absl::string_view normalized,
-    const std::vector<size_t> &norm_to_orig, const EncodeResult &result,
+    const std::vector<uint32> &norm_to_orig, const EncodeResult &result,
     SentencePieceText *spt) const {
+  SPM_METRICS_TIMER(POPULATE);
   size_t consumed = 0;
   bool is_prev_unk = false;
   for (const auto &p : result) {
@@ -343,6 +636,7 @@ util::Status SentencePieceProcessor::PopulateSentencePieceText(
     CHECK_OR_RETURN(!w.empty()) << "Empty piece is not allowed.";
 
     const bool is_unk = IsUnknown(id);
+    SPM_METRICS_ADD(UNKNOWN_PIECES, is_unk);
 
     if (IsControl(id)) {
       // Control symbol has no corresponding source surface, so begin == end.
@@ -417,22 +711,184 @@ util::Status SentencePieceProcessor::PopulateSentencePieceText(
   RETURN_IF_ERROR(ApplyExtraOptions(encode_extra_options_, spt));
 
   spt->set_text(input.data(), input.size());
+  SPM_METRICS_ADD(OUTPUT_PIECES, spt->pieces_size());
 
   return util::OkStatus();
 }  // namespace sentencepiece
 
+util::Status SentencePieceProcessor::PopulateSentencePieceSpans(
+    absl::string_view input, const EncodeResult &result,
+    SentencePieceSpans *spans) const {
+  SPM_METRICS_TIMER(POPULATE);
+  const auto &norm_to_orig = spans->norm_to_orig_;
+  size_t consumed = 0;
+  bool is_prev_unk = false;
+  for (const auto &p : result) {
+    const absl::string_view w = p.first;  // piece
+    const int id = p.second;              // id
+
+    CHECK_OR_RETURN(!w.empty()) << "Empty piece is not allowed.";
+
+    const bool is_unk = IsUnknown(id);
+    SPM_METRICS_ADD(UNKNOWN_PIECES, is_unk);
+
+    if (IsControl(id)) {
+      // Control symbol has no corresponding source surface, so begin == end.
+      spans->Add(w, id, norm_to_orig[consumed], norm_to_orig[consumed]);
+    } else {
+      const size_t begin = consumed;
+      const size_t end = consumed + w.size();
+      CHECK_LT_OR_RETURN(begin, norm_to_orig.size());
+      CHECK_LT_OR_RETURN(end, norm_to_orig.size());
+      const size_t orig_begin = norm_to_orig[begin];
+      const size_t orig_end = norm_to_orig[end];
+      CHECK_LE_OR_RETURN(orig_begin, input.size());
+      CHECK_LE_OR_RETURN(orig_end, input.size());
+      CHECK_LE_OR_RETURN(orig_begin, orig_end);
+
+      if (is_unk && model_->ByteFallbackEnabled()) {
+        // Decomposes an unknown piece into byte pieces. Only the last one
+        // has the surface.
+        for (size_t i = 0; i < w.size(); ++i) {
+          const auto piece = GetBytePiece(w[i]);
+          spans->Add(piece, model_->PieceToId(piece), orig_begin,
+                     i == w.size() - 1 ? orig_end : orig_begin);
+        }
+      } else if (is_prev_unk && is_unk) {
+        // Merges continuous run of unknown pieces, which are adjacent in
+        // the normalized string.
+        auto &piece = spans->pieces_.back();
+        piece = absl::string_view(piece.data(), piece.size() + w.size());
+        spans->ends_.back() = orig_end;
+      } else {
+        spans->Add(absl::string_view(spans->normalized_.data() + begin,
+                                     w.size()),
+                   id, orig_begin, orig_end);
+      }
+      consumed += w.size();
+    }
+    is_prev_unk = is_unk;
+  }
+
+  CHECK_EQ_OR_RETURN(consumed, spans->normalized_.size())
+      << "all normalized characters are not consumed.";
+
+  RETURN_IF_ERROR(ApplyExtraOptions(encode_extra_options_, spans));
+  SPM_METRICS_ADD(OUTPUT_PIECES, spans->size());
+
+  return util::OkStatus();
+}
+
+util::Status SentencePieceProcessor::Encode(absl::string_view input,
+                                            SentencePieceSpans *spans) const {
+  RETURN_IF_ERROR(status());
+  CHECK_OR_RETURN(spans) << "output container is null";
+  spans->Clear();
+  SPM_METRICS_ADD(ENCODE_CALLS, 1);
+  SPM_METRICS_ADD(INPUT_BYTES, input.size());
+
+  RETURN_IF_ERROR(
+      Normalize(input, &spans->normalized_, &spans->norm_to_orig_));
+
+  EncodeResult result;
+  {
+    SPM_METRICS_TIMER(ENCODE);
+    result = model_->Encode(spans->normalized_);
+  }
+
+  return PopulateSentencePieceSpans(input, result, spans);
+}
+
+namespace {
+// Converts |spt| to the compact form of the sentence cache.
+SentenceCache::Result SentencePieceTextToCachedResult(
+    const SentencePieceProcessor &processor, const SentencePieceText &spt) {
+  SentenceCache::Result cached;
+  cached.ids.reserve(spt.pieces_size());
+  cached.offsets.reserve(2 * spt.pieces_size());
+  for (const auto &sp : spt.pieces()) {
+    uint32 begin = sp.begin();
+    uint32 end = sp.end();
+    if (sp.piece() != processor.IdToPiece(sp.id())) {
+      begin |= SentenceCache::kHasPiece;
+      cached.pieces.push_back(sp.piece());
+    }
+    if (sp.has_begin()) end |= SentenceCache::kHasOffsets;
+    if (sp.has_surface()) end |= SentenceCache::kHasSurface;
+    cached.ids.push_back(sp.id());
+    cached.offsets.push_back(begin);
+    cached.offsets.push_back(end);
+  }
+  return cached;
+}
+
+util::Status CachedResultToSentencePieceText(
+    const SentencePieceProcessor &processor, absl::string_view input,
+    const SentenceCache::Result &cached, SentencePieceText *spt) {
+  SPM_METRICS_TIMER(POPULATE);
+  size_t num_pieces = 0;
+  for (size_t i = 0; i < cached.ids.size(); ++i) {
+    const int id = cached.ids[i];
+    const uint32 begin = cached.offsets[2 * i];
+    const uint32 end = cached.offsets[2 * i + 1];
+    auto *sp = spt->add_pieces();
+    if (begin & SentenceCache::kHasPiece) {
+      CHECK_LT_OR_RETURN(num_pieces, cached.pieces.size());
+      sp->set_piece(cached.pieces[num_pieces++]);
+    } else {
+      sp->set_piece(processor.IdToPiece(id));
+    }
+    sp->set_id(id);
+    const uint32 orig_begin = begin & SentenceCache::kOffsetMask;
+    const uint32 orig_end = end & SentenceCache::kOffsetMask;
+    CHECK_LE_OR_RETURN(orig_begin, orig_end);
+    CHECK_LE_OR_RETURN(orig_end, input.size());
+    if (end & SentenceCache::kHasSurface) {
+      sp->set_surface(input.data() + orig_begin, orig_end - orig_begin);
+    }
+    if (end & SentenceCache::kHasOffsets) {
+      sp->set_begin(orig_begin);
+      sp->set_end(orig_end);
+    }
+  }
+  spt->set_text(input.data(), input.size());
+  SPM_METRICS_ADD(OUTPUT_PIECES, spt->pieces_size());
+  return util::OkStatus();
+}
+}  // namespace
+
 util::Status SentencePieceProcessor::Encode(absl::string_view input,
                                             SentencePieceText *spt) const {
   CHECK_OR_RETURN_STATUS_PROTO(spt);
+  SPM_METRICS_ADD(ENCODE_CALLS, 1);
+  SPM_METRICS_ADD(INPUT_BYTES, input.size());
+
+  const bool use_cache = sentence_cache_ != nullptr &&
+                         SentenceCache::CanCacheOffsets(input);
+  if (use_cache) {
+    SentenceCache::Result cached;
+    if (sentence_cache_->Lookup(input, encode_extra_options_key_, &cached)) {
+      return CachedResultToSentencePieceText(*this, input, cached, spt);
+    }
+  }
 
   std::string normalized;
-  std::vector<size_t> norm_to_orig;
-  RETURN_IF_ERROR(normalizer_->Normalize(input, &normalized, &norm_to_orig));
+  std::vector<uint32> norm_to_orig;
+  RETURN_IF_ERROR(Normalize(input, &normalized, &norm_to_orig));
 
-  const auto result = model_->Encode(normalized);
+  EncodeResult result;
+  {
+    SPM_METRICS_TIMER(ENCODE);
+    result = model_->Encode(normalized);
+  }
   RETURN_IF_ERROR(
       PopulateSentencePieceText(input, normalized, norm_to_orig, result, spt));
 
+  if (use_cache) {
+    sentence_cache_->Insert(input, encode_extra_options_key_,
+                            SentencePieceTextToCachedResult(*this, *spt));
+  }
+
   return util::OkStatus();
 }
 
@@ -440,15 +896,21 @@ util::Status SentencePieceProcessor::NBestEncode(
     absl::string_view input, int nbest_size,
     NBestSentencePieceText *nbest_spt) const {
   CHECK_OR_RETURN_STATUS_PROTO(nbest_spt);
+  SPM_METRICS_ADD(ENCODE_CALLS, 1);
+  SPM_METRICS_ADD(INPUT_BYTES, input.size());
 
   std::string normalized;
-  std::vector<size_t> norm_to_orig;
-  RETURN_IF_ERROR(normalizer_->Normalize(input, &normalized, &norm_to_orig));
+  std::vector<uint32> norm_to_orig;
+  RETURN_IF_ERROR(Normalize(input, &normalized, &norm_to_orig));
 
   CHECK_OR_RETURN(model_->IsNBestEncodeAvailable())
       << "NBestEncode is not available for the current model.";
 
-  const auto nbests = model_->NBestEncode(normalized, nbest_size);
+  NBestEncodeResult nbests;
+  {
+    SPM_METRICS_TIMER(ENCODE);
+    nbests = model_->NBestEncode(normalized, nbest_size);
+  }
   CHECK_OR_RETURN(!nbests.empty()) << "NBestEncode returns empty result.";
 
   for (const auto &result : nbests) {
@@ -467,10 +929,12 @@ util::Status SentencePieceProcessor::SampleEncode(
   CHECK_OR_RETURN_STATUS_PROTO(spt);
 
   CHECK_LE_OR_RETURN(nbest_size, 512) << "nbest_size must be nbest_size <= 512";
+  SPM_METRICS_ADD(ENCODE_CALLS, 1);
+  SPM_METRICS_ADD(INPUT_BYTES, input.size());
 
   std::string normalized;
-  std::vector<size_t> norm_to_orig;
-  RETURN_IF_ERROR(normalizer_->Normalize(input, &normalized, &norm_to_orig));
+  std::vector<uint32> norm_to_orig;
+  RETURN_IF_ERROR(Normalize(input, &normalized, &norm_to_orig));
 
   if (!model_->IsNBestEncodeAvailable() || nbest_size < 0) {
     CHECK_OR_RETURN(model_->IsSampleEncodeAvailable())
@@ -503,6 +967,8 @@ util::Status SentencePieceProcessor::SampleEncode(
 util::Status SentencePieceProcessor::Decode(
     const std::vector<std::string> &pieces, SentencePieceText *spt) const {
   CHECK_OR_RETURN_STATUS_PROTO(spt);
+  SPM_METRICS_ADD(DECODE_CALLS, 1);
+  SPM_METRICS_TIMER(DECODE);
 
   const char *unk_surface = kDefaultUnknownSymbol;
   if (model_proto_ && model_proto_->trainer_spec().has_unk_surface())
@@ -750,6 +1216,61 @@ util::Status SentencePieceProcessor::ApplyExtraOptions(
   return util::OkStatus();
 }
 
+util::Status SentencePieceProcessor::ApplyExtraOptions(
+    const std::vector<ExtraOption> &extra_options,
+    std::vector<int> *ids) const {
+  for (const auto &extra_option : extra_options) {
+    switch (extra_option) {
+      case REVERSE:
+        std::reverse(ids->begin(), ids->end());
+        break;
+      case EOS:
+        ids->push_back(
+            PieceToId(absl::string_view(model_->eos_piece().data())));
+        break;
+      case BOS:
+        ids->insert(ids->begin(),
+                    PieceToId(absl::string_view(model_->bos_piece().data())));
+        break;
+      default:
+        return util::InternalError("unknown extra_option type.");
+    }
+  }
+
+  return util::OkStatus();
+}
+
+util::Status SentencePieceProcessor::ApplyExtraOptions(
+    const std::vector<ExtraOption> &extra_options,
+    SentencePieceSpans *spans) const {
+  // The offsets of <s> and </s> are 0 as in SentencePieceText.
+  for (const auto &extra_option : extra_options) {
+    switch (extra_option) {
+      case REVERSE:
+        std::reverse(spans->pieces_.begin(), spans->pieces_.end());
+        std::reverse(spans->ids_.begin(), spans->ids_.end());
+        std::reverse(spans->begins_.begin(), spans->begins_.end());
+        std::reverse(spans->ends_.begin(), spans->ends_.end());
+        break;
+      case EOS: {
+        const int id = PieceToId(absl::string_view(model_->eos_piece().data()));
+        spans->Add(model_->eos_piece(), id, 0, 0);
+      } break;
+      case BOS: {
+        const int id = PieceToId(absl::string_view(model_->bos_piece().data()));
+        spans->pieces_.insert(spans->pieces_.begin(), model_->bos_piece());
+        spans->ids_.insert(spans->ids_.begin(), id);
+        spans->begins_.insert(spans->begins_.begin(), 0);
+        spans->ends_.insert(spans->ends_.begin(), 0);
+      } break;
+      default:
+        return util::InternalError("unknown extra_option type.");
+    }
+  }
+
+  return util::OkStatus();
+}
+
 // static
 util::Status SentencePieceProcessor::ParseExtraOptions(
     absl::string_view _extra_option,
@@ -15,6 +15,7 @@
 #ifndef SENTENCEPIECE_PROCESSOR_H_
 #define SENTENCEPIECE_PROCESSOR_H_
 
+#include <cstdint>
 #include <cstring>
 #include <memory>
 #include <string>
@@ -158,6 +159,7 @@ class NBestSentencePieceText;
 class ModelInterface;
 class SentencePieceText;
 class ModelProto;
+class SentenceCache;
 
 namespace normalizer {
 class Normalizer;
@@ -171,6 +173,80 @@ enum class EncoderVersion {
                // just in case).
 };
 
+#ifndef SWIG
+// Encoded pieces, ids and byte offsets in flat arrays, made by
+// SentencePieceProcessor::Encode() without building SentencePieceText.
+// A piece is a view into normalized() or into the model, so that no piece
+// is copied. Pass the same object to Encode() again to reuse its buffers;
+// the views are valid until then.
+//
+//   SentencePieceSpans spans;
+//   for (const auto &line : lines) {
+//     sp.Encode(line, &spans);
+//     for (size_t i = 0; i < spans.size(); ++i) {
+//       // line.substr(spans.begin(i), spans.end(i) - spans.begin(i)) is
+//       // the surface of spans.piece(i).
+//     }
+//   }
+class SentencePieceSpans {
+ public:
+  SentencePieceSpans();
+  ~SentencePieceSpans();
+
+  SentencePieceSpans(const SentencePieceSpans &) = delete;
+  SentencePieceSpans &operator=(const SentencePieceSpans &) = delete;
+
+  // Returns the number of pieces.
+  size_t size() const { return ids_.size(); }
+  bool empty() const { return ids_.empty(); }
+
+  absl::string_view piece(size_t i) const { return pieces_[i]; }
+  int id(size_t i) const { return ids_[i]; }
+
+  // Returns the byte range of the i-th piece in the input, i.e., the same
+  // as SentencePieceText::SentencePiece::begin() and end().
+  size_t begin(size_t i) const { return begins_[i]; }
+  size_t end(size_t i) const { return ends_[i]; }
+
+  const std::vector<absl::string_view> &pieces() const { return pieces_; }
+  const std::vector<int> &ids() const { return ids_; }
+  const std::vector<size_t> &begins() const { return begins_; }
+  const std::vector<size_t> &ends() const { return ends_; }
+
+  // Returns the normalized input.
+  const std::string &normalized() const { return normalized_; }
+
+  // Clears the contents. The buffers are kept.
+  void Clear();
+
+ private:
+  friend class SentencePieceProcessor;
+
+  void Add(absl::string_view piece, int id, size_t begin, size_t end);
+
+  std::string normalized_;
+  std::vector<uint32_t> norm_to_orig_;
+  std::vector<absl::string_view> pieces_;
+  std::vector<int> ids_;
+  std::vector<size_t> begins_;
+  std::vector<size_t> ends_;
+};
+
+// Statistics of a cache of the encoding results.
+struct CacheStats {
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t evictions = 0;
+  size_t entries = 0;  // The entries in the cache now.
+  size_t bytes = 0;    // The memory used by the entries now.
+
+  double hit_rate() const {
+    return hits + misses == 0 ? 0.0
+                              : static_cast<double>(hits) / (hits + misses);
+  }
+};
+#endif  // SWIG
+
 namespace util {
 // Redefine std::string for serialized_proto interface as Python's string is
 // a Unicode string. We can enforce the return value to be raw byte sequence
@@ -239,6 +315,9 @@ class SentencePieceProcessor {
                               std::vector<std::string> *pieces) const;
 
   // Given a UTF8 input, encodes it into a sequence of ids.
+  // The ids are made directly from the model output without building
+  // SentencePieceText. The capacity of `ids` is reused, so that passing the
+  // same vector across calls avoids reallocations.
   virtual util::Status Encode(absl::string_view input,
                               std::vector<int> *ids) const;
 
@@ -258,6 +337,14 @@ class SentencePieceProcessor {
   // Returns the current encoder version in use.
   virtual EncoderVersion GetEncoderVersion() const;
 
+#ifndef SWIG
+  // Returns the name of the encoder selected for the pieces of the model at
+  // load time, e.g., "optimized" in unigram when the model has neither
+  // unused pieces nor user defined symbols. Empty for the models with a
+  // single encoder.
+  virtual std::string GetEncoderVariant() const;
+#endif  // SWIG
+
   //////////////////////////////////////////////////////////////
   // NBest API.
   // Same as Encode, but returns nbest results.
@@ -314,6 +401,13 @@ class SentencePieceProcessor {
   virtual util::Status SampleEncode(absl::string_view input, int nbest_size,
                                     float alpha, SentencePieceText *spt) const;
 
+#ifndef SWIG
+  // Same as above, but returns the pieces, ids and offsets in flat arrays
+  // without copying the pieces. The buffers of `spans` are reused.
+  virtual util::Status Encode(absl::string_view input,
+                              SentencePieceSpans *spans) const;
+#endif  // SWIG
+
   // Given a sequence of pieces, decodes it into SentencePieceText.
   virtual util::Status Decode(const std::vector<std::string> &pieces,
                               SentencePieceText *spt) const;
@@ -322,6 +416,62 @@ class SentencePieceProcessor {
   virtual util::Status Decode(const std::vector<int> &ids,
                               SentencePieceText *spt) const;
 
+#ifndef SWIG
+  //////////////////////////////////////////////////////////////
+  // Batch API.
+  //
+  // Same as Encode and Decode, but processes all the inputs on up to
+  // `num_threads` threads. The outputs are in the input order. When
+  // `num_threads` <= 0, the number of the hardware threads is used.
+  // Returns the error of the first failed input.
+  virtual util::Status EncodeBatch(const std::vector<absl::string_view> &inputs,
+                                   std::vector<std::vector<std::string>> *pieces,
+                                   int num_threads = 0) const;
+
+  virtual util::Status EncodeBatch(const std::vector<absl::string_view> &inputs,
+                                   std::vector<std::vector<int>> *ids,
+                                   int num_threads = 0) const;
+
+  virtual util::Status DecodeBatch(
+      const std::vector<std::vector<std::string>> &pieces,
+      std::vector<std::string> *detokenized, int num_threads = 0) const;
+
+  virtual util::Status DecodeBatch(const std::vector<std::vector<int>> &ids,
+                                   std::vector<std::string> *detokenized,
+                                   int num_threads = 0) const;
+
+  // Rebuilds the tries of the normalizer and the model in a cache friendly
+  // layout for the inputs like `sample`, e.g., some lines of the corpus to
+  // be encoded. The outputs do not change. When `use_huge_pages` is true,
+  // the tries are placed on transparent huge pages if available.
+  // Must not be called while other threads are encoding.
+  virtual util::Status OptimizeTrieLayout(
+      const std::vector<absl::string_view> &sample,
+      bool use_huge_pages = false);
+
+  // Caches the encodings of the whitespace-delimited words in up to
+  // `max_bytes` of memory, so that frequent words are not encoded again.
+  // 0 disables the cache. Only BPE models use the cache, and not when their
+  // pieces may contain a whitespace in the middle, so that it never changes
+  // the encodings. Must not be called while other threads are encoding.
+  virtual util::Status SetWordCacheSize(size_t max_bytes);
+
+  // Returns the statistics of the word cache. All zero when disabled.
+  virtual CacheStats GetWordCacheStats() const;
+
+  // Caches the final encodings of whole inputs in up to `max_bytes` of
+  // memory, so that repeated inputs skip the normalization and the model.
+  // Used by Encode() to ids, pieces and SentencePieceText, and by
+  // EncodeBatch() to ids. The results are keyed by the encode extra options.
+  // SetVocabulary(), ResetVocabulary() and SetEncoderVersion() clear the cache.
+  // 0 disables the cache. Must not be called while other threads are
+  // encoding.
+  virtual util::Status SetSentenceCacheSize(size_t max_bytes);
+
+  // Returns the statistics of the sentence cache. All zero when disabled.
+  virtual CacheStats GetSentenceCacheStats() const;
+#endif  // SWIG
+
   //////////////////////////////////////////////////////////////
   // Handy methods that return the result directly.
   // These functions ignore internal errors.
@@ -475,12 +625,39 @@ class SentencePieceProcessor {
   util::Status ApplyExtraOptions(const std::vector<ExtraOption> &extra_options,
                                  SentencePieceText *spt) const;
 
+  // Same as above, but applies |extra_options| to |ids|.
+  util::Status ApplyExtraOptions(const std::vector<ExtraOption> &extra_options,
+                                 std::vector<int> *ids) const;
+
+  // Same as above, but applies |extra_options| to |spans|.
+  util::Status ApplyExtraOptions(const std::vector<ExtraOption> &extra_options,
+                                 SentencePieceSpans *spans) const;
+
+  // Normalizes |input| with normalizer_.
+  util::Status Normalize(absl::string_view input, std::string *normalized,
+                         std::vector<uint32_t> *norm_to_orig) const;
+
+  // Same as Encode(inputs[i], &ids[i]) for all i in [0, size), but uses
+  // |normalized|[i] as the buffer of the normalized text, so that the batch
+  // workers can reuse them. More than one input are encoded with
+  // ModelInterface::EncodeBatch().
+  util::Status EncodeToIds(const absl::string_view *inputs, size_t size,
+                           std::string *normalized,
+                           std::vector<int> *ids) const;
+
   util::Status PopulateSentencePieceText(
       absl::string_view input, absl::string_view normalized,
-      const std::vector<size_t> &norm_to_orig,
+      const std::vector<uint32_t> &norm_to_orig,
       const std::vector<std::pair<absl::string_view, int>> &result,
       SentencePieceText *spt) const;
 
+  // Same as above, but populates |spans|, whose normalized_ and
+  // norm_to_orig_ are already made.
+  util::Status PopulateSentencePieceSpans(
+      absl::string_view input,
+      const std::vector<std::pair<absl::string_view, int>> &result,
+      SentencePieceSpans *spans) const;
+
   std::unique_ptr<ModelInterface> model_;
   std::unique_ptr<normalizer::Normalizer> normalizer_;
   std::unique_ptr<normalizer::Normalizer> denormalizer_;
@@ -489,7 +666,12 @@ class SentencePieceProcessor {
   std::unique_ptr<ModelProto> model_proto_;
 
   std::vector<ExtraOption> encode_extra_options_;
+  // encode_extra_options_ as the key of sentence_cache_.
+  std::string encode_extra_options_key_;
   std::vector<ExtraOption> decode_extra_options_;
+
+  // Cache of the final encodings. nullptr when disabled.
+  std::unique_ptr<SentenceCache> sentence_cache_;
 };
 
 #ifndef SWIG
@@ -507,6 +689,20 @@ util::Status LoadModelProto(absl::string_view, ModelProto *model_proto);
 // Saves `model_proto` as `filename`.
 util::Status SaveModelProto(absl::string_view, const ModelProto &model_proto);
 }  // namespace io
+
+// Hot-path counters and stage latency histograms of all processors in the
+// process, e.g., the number of encoded pieces and the time spent on
+// normalization. They are recorded only when the library is built with
+// -DSPM_ENABLE_METRICS=ON.
+namespace metrics {
+// Returns true if the library records the metrics.
+bool IsEnabled();
+
+// Returns the metrics in the text format of Prometheus or in JSON.
+// Returns an empty string when the metrics are not enabled.
+std::string ToPrometheus();
+std::string ToJson();
+}  // namespace metrics
 #endif  // SWIG
 }  // namespace sentencepiece
 #endif  // SENTENCEPIECE_PROCESSOR_H_
@@ -115,6 +115,27 @@ std::vector<std::string> GetSpVec(const SentencePieceText &spt) {
   return sps;
 }
 
+// Checks that SentencePieceSpans of |input| has the same pieces, ids and
+// offsets as SentencePieceText.
+void ExpectSameSpans(const SentencePieceProcessor &sp,
+                     absl::string_view input) {
+  SentencePieceText spt;
+  EXPECT_TRUE(sp.Encode(input, &spt).ok());
+
+  // The buffers are reused.
+  SentencePieceSpans spans;
+  for (int n = 0; n < 2; ++n) {
+    EXPECT_TRUE(sp.Encode(input, &spans).ok());
+    ASSERT_EQ(spt.pieces_size(), spans.size());
+    for (int i = 0; i < spt.pieces_size(); ++i) {
+      EXPECT_EQ(spt.pieces(i).piece(), std::string(spans.piece(i)));
+      EXPECT_EQ(spt.pieces(i).id(), spans.id(i));
+      EXPECT_EQ(spt.pieces(i).begin(), spans.begin(i));
+      EXPECT_EQ(spt.pieces(i).end(), spans.end(i));
+    }
+  }
+}
+
 NormalizerSpec MakeDefaultNormalizerSpec() {
   return SentencePieceTrainer::GetNormalizerSpec("nmt_nfkc");
 }
@@ -151,6 +172,7 @@ TEST(SentencepieceProcessorTest, EncodeTest) {
     std::vector<int> ids;
     EXPECT_TRUE(sp.Encode("ABC DEF", &ids).ok());
     EXPECT_EQ(GetIdVec(result), ids);
+    ExpectSameSpans(sp, "ABC DEF");
 
     SentencePieceText spt;
     EXPECT_TRUE(sp.Encode("ABC DEF", &spt).ok());
@@ -204,6 +226,7 @@ TEST(SentencepieceProcessorTest, EncodeTest) {
     std::vector<int> ids;
     EXPECT_TRUE(sp.Encode("ABC DEF", &ids).ok());
     EXPECT_EQ(GetIdVec(expected), ids);
+    ExpectSameSpans(sp, "ABC DEF");
 
     SentencePieceText spt;
     EXPECT_TRUE(sp.Encode("ABC DEF", &spt).ok());
@@ -258,6 +281,7 @@ TEST(SentencepieceProcessorTest, EncodeTest) {
     std::vector<int> ids;
     EXPECT_TRUE(sp.Encode("ABC DEFあ", &ids).ok());
     EXPECT_EQ(GetIdVec(expected), ids);
+    ExpectSameSpans(sp, "ABC DEFあ");
 
     SentencePieceText spt;
     EXPECT_TRUE(sp.Encode("ABC DEFあ", &spt).ok());
@@ -931,10 +955,12 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
   {
     // Verify the default encoder version.
     EXPECT_EQ(EncoderVersion::kOptimized, sp.GetEncoderVersion());
+    EXPECT_FALSE(sp.GetEncoderVariant().empty());
 
     // Set the encoder version to original and verify.
     EXPECT_TRUE(sp.SetEncoderVersion(EncoderVersion::kOriginal).ok());
     EXPECT_EQ(EncoderVersion::kOriginal, sp.GetEncoderVersion());
+    EXPECT_EQ("original", sp.GetEncoderVariant());
 
     // Set back to the default encoder version.
     EXPECT_TRUE(sp.SetEncoderVersion(EncoderVersion::kOptimized).ok());
@@ -950,6 +976,7 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
     const std::vector<int> expected_id = {7, 6, 5};
     EXPECT_TRUE(sp.Encode("abc", &ids).ok());
     EXPECT_EQ(expected_id, ids);
+    ExpectSameSpans(sp, "abc");
   }
 
   {
@@ -964,6 +991,7 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
     const std::vector<int> expected_id = {1, 7, 6, 5};
     EXPECT_TRUE(sp.Encode("abc", &ids).ok());
     EXPECT_EQ(expected_id, ids);
+    ExpectSameSpans(sp, "abc");
   }
 
   {
@@ -978,6 +1006,7 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
     const std::vector<int> expected_id = {7, 6, 5, 2};
     EXPECT_TRUE(sp.Encode("abc", &ids).ok());
     EXPECT_EQ(expected_id, ids);
+    ExpectSameSpans(sp, "abc");
   }
 
   {
@@ -992,6 +1021,7 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
     const std::vector<int> expected_id = {5, 6, 7};
     EXPECT_TRUE(sp.Encode("abc", &ids).ok());
     EXPECT_EQ(expected_id, ids);
+    ExpectSameSpans(sp, "abc");
   }
 
   {
@@ -1007,6 +1037,7 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
     const std::vector<int> expected_id = {1, 7, 6, 5, 2};
     EXPECT_TRUE(sp.Encode("abc", &ids).ok());
     EXPECT_EQ(expected_id, ids);
+    ExpectSameSpans(sp, "abc");
   }
 
   {
@@ -1022,6 +1053,7 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
     const std::vector<int> expected_id = {1, 5, 6, 7, 2};
     EXPECT_TRUE(sp.Encode("abc", &ids).ok());
     EXPECT_EQ(expected_id, ids);
+    ExpectSameSpans(sp, "abc");
   }
 
   {
@@ -1037,6 +1069,7 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
     const std::vector<int> expected_id = {2, 5, 6, 7, 1};
     EXPECT_TRUE(sp.Encode("abc", &ids).ok());
     EXPECT_EQ(expected_id, ids);
+    ExpectSameSpans(sp, "abc");
   }
 
   {
@@ -1198,6 +1231,7 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
       const std::vector<int> expected_id = {7, 6, 5};
       EXPECT_TRUE(sp.Encode("abc", &ids).ok());
       EXPECT_EQ(expected_id, ids);
+      ExpectSameSpans(sp, "abc");
     }
 
     {
@@ -1246,6 +1280,7 @@ TEST(SentencePieceProcessorTest, EndToEndTest) {
     const std::vector<int> expected_id = {7, 3, 4, 5};
     EXPECT_TRUE(sp.Encode("abc", &ids).ok());
     EXPECT_EQ(expected_id, ids);
+    ExpectSameSpans(sp, "abc");
   }
 }
 
@@ -1281,6 +1316,60 @@ TEST(SentencePieceProcessorTest, SkipNormalizationTest) {
             pieces);
 }
 
+TEST(SentencePieceProcessorTest, BatchTest) {
+  ModelProto model_proto;
+  auto *sp1 = model_proto.add_pieces();
+  sp1->set_type(ModelProto::SentencePiece::UNKNOWN);
+  sp1->set_piece("<unk>");
+
+  AddPiece(&model_proto, "a", 0.0);
+  AddPiece(&model_proto, "b", 0.3);
+  AddPiece(&model_proto, "c", 0.2);
+  AddPiece(&model_proto, "ab", 1.0);
+  AddPiece(&model_proto, WS, 3.0);
+
+  SentencePieceProcessor sp;
+  std::vector<std::vector<int>> ids;
+  std::vector<std::string> detok;
+  EXPECT_FALSE(sp.EncodeBatch({"abc"}, &ids).ok());
+  EXPECT_FALSE(sp.DecodeBatch(ids, &detok).ok());
+
+  ASSERT_TRUE(sp.Load(model_proto).ok());
+  EXPECT_TRUE(sp.SetEncodeExtraOptions("reverse").ok());
+
+  std::vector<std::string> sentences;
+  for (int i = 0; i < 100; ++i) {
+    sentences.emplace_back(std::string(i % 7, 'a') + " b" +
+                           std::string(i % 5, 'c') + "x");
+  }
+  const std::vector<absl::string_view> inputs(sentences.begin(),
+                                              sentences.end());
+
+  for (const int num_threads : {0, 1, 3, 200}) {
+    std::vector<std::vector<std::string>> pieces;
+    EXPECT_TRUE(sp.EncodeBatch(inputs, &pieces, num_threads).ok());
+    EXPECT_TRUE(sp.EncodeBatch(inputs, &ids, num_threads).ok());
+    ASSERT_EQ(inputs.size(), pieces.size());
+    ASSERT_EQ(inputs.size(), ids.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      EXPECT_EQ(sp.EncodeAsPieces(inputs[i]), pieces[i]);
+      EXPECT_EQ(sp.EncodeAsIds(inputs[i]), ids[i]);
+    }
+
+    std::vector<std::string> detok_pieces;
+    EXPECT_TRUE(sp.DecodeBatch(pieces, &detok_pieces, num_threads).ok());
+    EXPECT_TRUE(sp.DecodeBatch(ids, &detok, num_threads).ok());
+    ASSERT_EQ(inputs.size(), detok.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      EXPECT_EQ(sp.DecodePieces(pieces[i]), detok_pieces[i]);
+      EXPECT_EQ(sp.DecodeIds(ids[i]), detok[i]);
+    }
+  }
+
+  EXPECT_TRUE(sp.EncodeBatch({}, &ids).ok());
+  EXPECT_TRUE(ids.empty());
+}
+
 TEST(SentencePieceProcessorTest, ExtraOptionsUndefinedTest) {
   ModelProto model_proto;
   auto *sp1 = model_proto.add_pieces();
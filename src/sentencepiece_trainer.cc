@@ -10,6 +10,7 @@
 // distributed under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the License for the specific language governing permissions and
 // limitations under the License.!
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -21,6 +22,7 @@
 #include "sentencepiece_trainer.h"
 #include "spec_parser.h"
 #include "third_party/absl/flags/flag.h"
+#include "third_party/absl/memory/memory.h"
 #include "third_party/absl/strings/numbers.h"
 #include "third_party/absl/strings/str_cat.h"
 #include "third_party/absl/strings/str_split.h"
@@ -88,6 +90,55 @@ util::Status SentencePieceTrainer::Train(
   return util::OkStatus();
 }
 
+// static
+util::Status SentencePieceTrainer::TrainMultiple(
+    const std::vector<TrainerSpec> &trainer_specs,
+    const NormalizerSpec &normalizer_spec,
+    const NormalizerSpec &denormalizer_spec) {
+  CHECK_OR_RETURN(!trainer_specs.empty());
+  auto copied_normalizer_spec = normalizer_spec;
+  RETURN_IF_ERROR(PopulateNormalizerSpec(&copied_normalizer_spec, false));
+  auto copied_denormalizer_spec = denormalizer_spec;
+  RETURN_IF_ERROR(PopulateNormalizerSpec(&copied_denormalizer_spec, true));
+
+  const int num_trainers = trainer_specs.size();
+  const int num_threads = trainer_specs[0].num_threads();
+
+  // The corpus is loaded with all the threads and shared by the trainers.
+  std::vector<std::unique_ptr<TrainerInterface>> trainers;
+  {
+    auto loader = TrainerFactory::Create(
+        trainer_specs[0], copied_normalizer_spec, copied_denormalizer_spec);
+    RETURN_IF_ERROR(loader->LoadSentences());
+
+    for (int i = 0; i < num_trainers; ++i) {
+      auto trainer_spec = trainer_specs[i];
+      trainer_spec.set_num_threads(std::max(
+          1, num_threads / num_trainers + (i < num_threads % num_trainers)));
+      LOG(INFO) << "Starts training with : \n"
+                << PrintProto(trainer_spec, "trainer_spec");
+      trainers.emplace_back(TrainerFactory::Create(
+          trainer_spec, copied_normalizer_spec, copied_denormalizer_spec));
+      RETURN_IF_ERROR(trainers.back()->ShareCorpus(*loader));
+    }
+  }
+
+  std::vector<util::Status> status(num_trainers);
+  {
+    auto pool = absl::make_unique<ThreadPool>(num_trainers);
+    pool->StartWorkers();
+    for (int i = 0; i < num_trainers; ++i) {
+      pool->Schedule([&, i]() { status[i] = trainers[i]->Train(); });
+    }
+  }
+
+  for (const auto &s : status) {
+    RETURN_IF_ERROR(s);
+  }
+
+  return util::OkStatus();
+}
+
 // static
 NormalizerSpec SentencePieceTrainer::GetNormalizerSpec(absl::string_view name) {
   NormalizerSpec spec;
@@ -17,6 +17,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "sentencepiece_processor.h"
 
@@ -74,6 +75,18 @@ class SentencePieceTrainer {
                             const NormalizerSpec &denormalizer_spec,
                             SentenceIterator *sentence_iterator = nullptr,
                             std::string *serialized_model_proto = nullptr);
+
+  // Trains one SentencePiece model per spec in `trainer_specs`, e.g., unigram
+  // and bpe models of the same corpus. The corpus is loaded and preprocessed
+  // only once and the trainers run concurrently, sharing the num_threads of
+  // the first spec. The specs may only differ in the fields which do not
+  // affect the corpus loading, such as model_type, model_prefix or
+  // vocab_size. Each model is saved to the model_prefix of its spec.
+  static util::Status TrainMultiple(
+      const std::vector<TrainerSpec> &trainer_specs,
+      const NormalizerSpec &normalizer_spec,
+      const NormalizerSpec &denormalizer_spec);
+
   // Trains SentencePiece model with command-line string in `args`,
   // e.g.,
   // '--input=data --model_prefix=m --vocab_size=8192 model_type=unigram'
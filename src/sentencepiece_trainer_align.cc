@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -44,7 +45,9 @@ util::Status SentencePieceAlignTrainer::Train(
         const TrainerSpec &trainer_spec_src,
         const TrainerSpec &trainer_spec_tgt,
         const NormalizerSpec &normalizer_spec,
-        const NormalizerSpec &denormalizer_spec) {
+        const NormalizerSpec &denormalizer_spec,
+        SentenceIterator *src_iterator,
+        SentenceIterator *tgt_iterator) {
 
     //SentencePieceTrainer::Train(trainer_spec_src,normalizer_spec,denormalizer_spec);
     //SentencePieceTrainer::Train(trainer_spec_tgt,normalizer_spec,denormalizer_spec);
@@ -62,9 +65,12 @@ util::Status SentencePieceAlignTrainer::Train(
 
     LOG(INFO)<<"Starts training with :\n" << info;
 
-    TrainAlign(trainer_spec_src, trainer_spec_tgt, normalizer_spec,trainer_src,trainer_tgt);
-                                        
-  return util::OkStatus();
+    CHECK_OR_RETURN((src_iterator == nullptr) == (tgt_iterator == nullptr))
+        << "Both src_iterator and tgt_iterator must be given.";
+    trainer_src->sentence_iterator_ = src_iterator;
+    trainer_tgt->sentence_iterator_ = tgt_iterator;
+
+    return TrainAlign(trainer_spec_src, trainer_spec_tgt, normalizer_spec,trainer_src,trainer_tgt);
 }
 
 util::Status SentencePieceAlignTrainer::TrainAlign(
@@ -84,95 +90,125 @@ util::Status SentencePieceAlignTrainer::TrainAlign(
     CHECK_OR_RETURN(normalizer_spec.escape_whitespaces());
 
     unigram::TrainerModel model_src(trainer_spec_src, normalizer_spec);
-    unigram::TrainerModel model_tgt(trainer_spec_src, normalizer_spec);
+    unigram::TrainerModel model_tgt(trainer_spec_tgt, normalizer_spec);
 
     RETURN_IF_ERROR(model_src.status());
     RETURN_IF_ERROR(model_tgt.status());
 
-    RETURN_IF_ERROR(trainer_src->LoadSentences());
-    RETURN_IF_ERROR(trainer_tgt->LoadSentences());
-
-
-    if(trainer_spec_src.train_extremely_large_corpus() || trainer_spec_tgt.train_extremely_large_corpus()){
-      model_src.SetSentencePieces(trainer_src->MakeSeedSentencePieces<int64>());
-      model_tgt.SetSentencePieces(trainer_tgt->MakeSeedSentencePieces<int64>());
-     } else{
-      model_src.SetSentencePieces(trainer_src->MakeSeedSentencePieces<int32>());
-      model_tgt.SetSentencePieces(trainer_tgt->MakeSeedSentencePieces<int32>());
-     }
+    CHECK_NE_OR_RETURN(trainer_spec_src.model_prefix(), trainer_spec_tgt.model_prefix())
+        << "The source and target models must have different model prefixes.";
+
+    // Checkpoints of both sides are saved next to their models.
+    const std::string &prefix_src = trainer_spec_src.model_prefix();
+    const std::string &prefix_tgt = trainer_spec_tgt.model_prefix();
+
+    // Per-round stats of both sides, written as JSON lines.
+    std::unique_ptr<filesystem::WritableFile> stats_output;
+    RETURN_IF_ERROR(trainer_src->NewStatsOutput(&stats_output));
+    unigram::RoundStats stats_src, stats_tgt;
+    util::Timer load_timer;
+
+    // The number of finished EM rounds.
+    int round = 0;
+
+    if(trainer_spec_src.resume_from_checkpoint()){
+      int round_tgt = 0;
+      RETURN_IF_ERROR(trainer_src->LoadCheckpoint(prefix_src, &round, &model_src));
+      RETURN_IF_ERROR(trainer_tgt->LoadCheckpoint(prefix_tgt, &round_tgt, &model_tgt));
+      CHECK_EQ_OR_RETURN(round, round_tgt)
+          << "The checkpoints of both sides must be saved at the same round.";
+    } else {
+      RETURN_IF_ERROR(trainer_src->LoadSentences());
+      RETURN_IF_ERROR(trainer_tgt->LoadSentences());
+
+
+      const bool large = trainer_spec_src.train_extremely_large_corpus() || trainer_spec_tgt.train_extremely_large_corpus();
+      if(trainer_spec_src.joint_seed_sentencepieces()){
+        // One suffix array over both corpora.
+        const std::vector<const unigram::Trainer *> trainers = {trainer_src.get(), trainer_tgt.get()};
+        auto seeds = large ? unigram::Trainer::MakeJointSeedSentencePieces<int64>(trainers)
+                           : unigram::Trainer::MakeJointSeedSentencePieces<int32>(trainers);
+        model_src.SetSentencePieces(std::move(seeds[0]));
+        model_tgt.SetSentencePieces(std::move(seeds[1]));
+      } else if(large){
+        model_src.SetSentencePieces(trainer_src->MakeSeedSentencePieces<int64>());
+        model_tgt.SetSentencePieces(trainer_tgt->MakeSeedSentencePieces<int64>());
+       } else{
+        model_src.SetSentencePieces(trainer_src->MakeSeedSentencePieces<int32>());
+        model_tgt.SetSentencePieces(trainer_tgt->MakeSeedSentencePieces<int32>());
+       }
+
+
+       if (trainer_spec_src.split_by_whitespace()){
+          trainer_src->SplitSentencesByWhitespace();
+       }
+       if (trainer_spec_tgt.split_by_whitespace()){
+           trainer_tgt->SplitSentencesByWhitespace();
+       }
+
+       trainer_src->desired_vocab_size_ = static_cast<size_t>(trainer_spec_src.vocab_size()*1.1);
+       trainer_tgt->desired_vocab_size_ = static_cast<size_t>(trainer_spec_tgt.vocab_size()*1.1);
+    }
 
+     stats_src.load_sec = stats_tgt.load_sec = load_timer.Get();
 
-     if (trainer_spec_src.split_by_whitespace()){
-        trainer_src->SplitSentencesByWhitespace();
-     }
-     if (trainer_spec_tgt.split_by_whitespace()){
-         trainer_tgt->SplitSentencesByWhitespace();
-     }
-
-     LOG(INFO)<<"SRC:::Using "<< trainer_src->sentences_.size() << "sentences for EM Training";
-     LOG(INFO)<<"TGT:::Using "<< trainer_tgt->sentences_.size() << "sentences for EM Training";
+     LOG(INFO)<<"SRC:::Using "<< trainer_src->sentences_->size() << "sentences for EM Training";
+     LOG(INFO)<<"TGT:::Using "<< trainer_tgt->sentences_->size() << "sentences for EM Training";
      //LOG(INFO)<<"type"<<typeid(model_src).name();
      //std::cout<<"type::trainer"<<typeid(trainer_src).name()<<std::endl;
      //std::cout<<"type::model_src"<<typeid(model_src).name()<<std::endl;
      //std::cout<<"type::&model_src"<<typeid(&model_src).name()<<std::endl;
 
-     trainer_src->desired_vocab_size_ = static_cast<size_t>(trainer_spec_src.vocab_size()*1.1);
-     trainer_tgt->desired_vocab_size_ = static_cast<size_t>(trainer_spec_tgt.vocab_size()*1.1);
+     // Writes the snapshot models of both sides while the training continues.
+     auto snapshot_pool = absl::make_unique<ThreadPool>(1);
+     snapshot_pool->StartWorkers();
 
      while(true){
-         LOG(INFO)<<"while";
-         for(int iter=0;iter<trainer_spec_src.num_sub_iterations();++iter){
-             LOG(INFO)<<"inside src EM";
-             //EM
-             float objective_src  = 0.0;
-             int64 num_tokens_src=0;
-             const auto expected_src = trainer_src->RunEStep(model_src,&objective_src,&num_tokens_src);
-             auto new_sentencepieces = trainer_src->RunMStep(model_src,expected_src);
-             model_src.SetSentencePieces(std::move(new_sentencepieces));
-             LOG(INFO) << "EM sub_iter=" << iter << " size=" << model_src.GetPieceSize()
-                    << " obj=" << objective_src << " num_tokens=" << num_tokens_src
-                    << " num_tokens/piece="
-                    << 1.0 * num_tokens_src / model_src.GetPieceSize();
-         }
-         LOG(INFO)<<trainer_spec_src.num_sub_iterations();
-         for(int iter=0;iter<trainer_spec_tgt.num_sub_iterations();++iter){
-             //EM
-             float objective_tgt  = 0.0;
-             int64 num_tokens_tgt=0;
-             const auto expected_tgt = trainer_tgt->RunEStep(model_tgt,&objective_tgt,&num_tokens_tgt);
-             auto new_sentencepieces = trainer_tgt->RunMStep(model_tgt,expected_tgt);
-             model_tgt.SetSentencePieces(std::move(new_sentencepieces));
-             LOG(INFO) << "EM sub_iter=" << iter << " size=" << model_tgt.GetPieceSize()
-                    << " obj=" << objective_tgt << " num_tokens=" << num_tokens_tgt
-                    << " num_tokens/piece="
-                    << 1.0 * num_tokens_tgt / model_tgt.GetPieceSize();
+         stats_src.round = stats_tgt.round = round;
+         trainer_src->RunEMSubIterations(&model_src, &stats_src);
+         trainer_tgt->RunEMSubIterations(&model_tgt, &stats_tgt);
+
+         trainer_src->SaveSnapshots(model_src, snapshot_pool.get());
+         trainer_tgt->SaveSnapshots(model_tgt, snapshot_pool.get());
+
+         const bool done = model_src.GetPieceSize()<=trainer_src->desired_vocab_size_ \
+                 && model_tgt.GetPieceSize()<=trainer_tgt->desired_vocab_size_;
+         if(!done){
+             RETURN_IF_ERROR(PruneSentencePiecesJoint(trainer_src, trainer_tgt, &model_src, &model_tgt,
+                                                      &stats_src, &stats_tgt));
          }
-         //break;
-
-         if(model_src.GetPieceSize()<=trainer_src->desired_vocab_size_ \
-                 && model_tgt.GetPieceSize()<=trainer_tgt->desired_vocab_size_)
-             break;
-
-         LOG(INFO)<<"prune called";
-
-         PruneSentencePiecesJoint(trainer_src, trainer_tgt, model_src,model_tgt);
-         PruneSentencePiecesJoint(trainer_src, trainer_tgt);
-         auto ret = PruneSentencePiecesJoint();
-         
 
-         auto new_sentencepieces_src= trainer_src->PruneSentencePieces(model_src);
-         auto new_sentencepieces_tgt= trainer_tgt->PruneSentencePieces(model_tgt);
-
-         model_src.SetSentencePieces(std::move(new_sentencepieces_src));
-         model_tgt.SetSentencePieces(std::move(new_sentencepieces_tgt));
+         stats_src.num_pieces = model_src.GetPieceSize();
+         stats_tgt.num_pieces = model_tgt.GetPieceSize();
+         if(stats_output){
+             CHECK_OR_RETURN(stats_output->WriteLine(stats_src.ToJson("src")));
+             CHECK_OR_RETURN(stats_output->WriteLine(stats_tgt.ToJson("tgt")));
+         }
+         stats_src = stats_tgt = unigram::RoundStats();
+         if(done) break;
+
+         ++round;
+         if(trainer_spec_src.checkpoint_interval()>0 \
+                 && round%trainer_spec_src.checkpoint_interval()==0){
+             // The checkpoints record the snapshots as saved, so waits for them.
+             snapshot_pool.reset();
+             RETURN_IF_ERROR(trainer_src->SnapshotStatus());
+             RETURN_IF_ERROR(trainer_tgt->SnapshotStatus());
+             snapshot_pool = absl::make_unique<ThreadPool>(1);
+             snapshot_pool->StartWorkers();
+             RETURN_IF_ERROR(trainer_src->SaveCheckpoint(prefix_src, round, model_src));
+             RETURN_IF_ERROR(trainer_tgt->SaveCheckpoint(prefix_tgt, round, model_tgt));
+         }
      }
-    LOG(INFO)<<"while break";
-
     trainer_src->final_pieces_ = trainer_src->FinalizeSentencePieces(model_src);
     trainer_tgt->final_pieces_ = trainer_tgt->FinalizeSentencePieces(model_tgt);
 
-    trainer_src->Save();
-    trainer_tgt->Save();
+    RETURN_IF_ERROR(trainer_src->Save());
+    RETURN_IF_ERROR(trainer_tgt->Save());
+
+    snapshot_pool.reset();
+    RETURN_IF_ERROR(trainer_src->SnapshotStatus());
+    RETURN_IF_ERROR(trainer_tgt->SnapshotStatus());
 
 
     //trainer_src->Train();
@@ -189,25 +225,71 @@ util::Status SentencePieceAlignTrainer::TrainAlign(
 util::Status SentencePieceAlignTrainer::PruneSentencePiecesJoint(
             const std::unique_ptr<unigram::Trainer> &trainer_src,
             const std::unique_ptr<unigram::Trainer> &trainer_tgt,
-            const unigram::TrainerModel &model_src,
-            const unigram::TrainerModel &model_tgt){
-
-    LOG(INFO)<<"Align Trainer full called";
-    auto new_sentencepieces_src = trainer_src->PruneSentencePieces(model_src);
-     LOG(INFO)<<"sentencepieces_"<<typeid(new_sentencepieces_src).name();
-    model_src.SetSentencePieces(std::move(new_sentencepieces_src));
+            unigram::TrainerModel *model_src,
+            unigram::TrainerModel *model_tgt,
+            unigram::RoundStats *stats_src,
+            unigram::RoundStats *stats_tgt){
+    util::Timer prune_timer;
+    const auto &sentences_src = *trainer_src->sentences_;
+    const auto &sentences_tgt = *trainer_tgt->sentences_;
+    const size_t num_sentences = std::max(sentences_src.size(), sentences_tgt.size());
+    const int num_threads = std::max(trainer_src->trainer_spec_.num_threads(),
+                                     trainer_tgt->trainer_spec_.num_threads());
+
+    std::vector<bool> always_keep_src, always_keep_tgt;
+    std::vector<std::vector<int>> alternatives_src, alternatives_tgt;
+    std::vector<unigram::Trainer::ViterbiFreq> freqs_src(num_threads);
+    std::vector<unigram::Trainer::ViterbiFreq> freqs_tgt(num_threads);
+    {
+      auto pool = absl::make_unique<ThreadPool>(num_threads + 2);
+      pool->StartWorkers();
+
+      // The alternatives only depend on the pieces of each side.
+      pool->Schedule([&]() {
+        trainer_src->GetAlternatives(*model_src, &always_keep_src, &alternatives_src);
+      });
+      pool->Schedule([&]() {
+        trainer_tgt->GetAlternatives(*model_tgt, &always_keep_tgt, &alternatives_tgt);
+      });
+
+      // Segments the i-th sentences of both sides in the same task, so that
+      // each aligned pair is visited once by one sweep over the corpus.
+      for (int n = 0; n < num_threads; ++n) {
+        freqs_src[n].freq.resize(model_src->GetPieceSize(), 0.0);
+        freqs_tgt[n].freq.resize(model_tgt->GetPieceSize(), 0.0);
+        pool->Schedule([&, n]() {
+          unigram::Lattice lattice_src, lattice_tgt;
+          for (size_t i = n; i < num_sentences; i += num_threads) {
+            if (i < sentences_src.size())
+              trainer_src->AddViterbiFreq(*model_src, i, &lattice_src, &freqs_src[n]);
+            if (i < sentences_tgt.size())
+              trainer_tgt->AddViterbiFreq(*model_tgt, i, &lattice_tgt, &freqs_tgt[n]);
+          }
+        });
+      }
+    }
 
-    //auto new_sentencepieces_tgt = trainer_tgt->PruneSentencePieces(model_tgt);
-    //model_tgt.SetSentencePieces(std::move(new_sentencepieces_tgt));
-    return util::OkStatus();
+    for (int n = 1; n < num_threads; ++n) {
+      freqs_src[0].Merge(freqs_src[n]);
+      freqs_tgt[0].Merge(freqs_tgt[n]);
     }
 
-util::Status SentencePieceAlignTrainer::PruneSentencePiecesJoint(){
-    return util::OkStatus();
-}
-util::Status SentencePieceAlignTrainer::PruneSentencePiecesJoint(
-            const std::unique_ptr<unigram::Trainer> &trainer_src,
-            const std::unique_ptr<unigram::Trainer> &trainer_tgt){
+    auto new_sentencepieces_src = trainer_src->PruneSentencePieces(
+        *model_src, always_keep_src, alternatives_src, freqs_src[0]);
+    auto new_sentencepieces_tgt = trainer_tgt->PruneSentencePieces(
+        *model_tgt, always_keep_tgt, alternatives_tgt, freqs_tgt[0]);
+
+    // Both sides share the sweep, so they report the same prune time.
+    const double prune_sec = prune_timer.Get();
+    if (stats_src) stats_src->prune_sec += prune_sec;
+    if (stats_tgt) stats_tgt->prune_sec += prune_sec;
+
+    util::Timer trie_timer;
+    model_src->SetSentencePieces(std::move(new_sentencepieces_src));
+    if (stats_src) stats_src->trie_sec += trie_timer.Get();
+    util::Timer trie_timer_tgt;
+    model_tgt->SetSentencePieces(std::move(new_sentencepieces_tgt));
+    if (stats_tgt) stats_tgt->trie_sec += trie_timer_tgt.Get();
     return util::OkStatus();
 }
 }// namespace sentencepiece
@@ -5,6 +5,7 @@
 #include <unordered_map>
 
 #include "sentencepiece_processor.h"
+#include "sentencepiece_trainer.h"
 #include "unigram_model_trainer.h"
 #include "unigram_model.h"
 
@@ -12,7 +13,11 @@ namespace sentencepiece {
 class SentencePieceAlignTrainer {
  public:
   static util::Status Train();
-  static util::Status Train(const TrainerSpec &trainer_spec_src, const TrainerSpec &trainer_spec_tgt,const NormalizerSpec &normalizer_speck, const NormalizerSpec &denormalizer_spec);
+  // When `src_iterator` and `tgt_iterator` are passed, loads sentences from
+  // them instead of trainer_spec.input(), e.g., both sides of ParallelCorpus.
+  static util::Status Train(const TrainerSpec &trainer_spec_src, const TrainerSpec &trainer_spec_tgt,const NormalizerSpec &normalizer_speck, const NormalizerSpec &denormalizer_spec,
+                            SentenceIterator *src_iterator = nullptr,
+                            SentenceIterator *tgt_iterator = nullptr);
 
   //joint train
   static util::Status TrainAlign(
@@ -24,17 +29,21 @@ class SentencePieceAlignTrainer {
         );
 
 
-    static util::Status PruneSentencePiecesJoint();
-    static util::Status PruneSentencePiecesJoint(
-            const std::unique_ptr<unigram::Trainer> &trainer_src,
-            const std::unique_ptr<unigram::Trainer> &trainer_tgt
-            );
-
+    // Prunes the pieces of both models with one sweep over the corpora.
+    // The i-th sentences of both sides are segmented by the same task, and
+    // the Viterbi frequencies of each side are kept per task and merged
+    // once, so both pruning decisions come from a single pass. The i-th
+    // sentences are an aligned pair when the corpora are loaded from
+    // ParallelCorpus with the same normalizer_spec and without
+    // split_by_whitespace. The prune and trie
+    // rebuild times are added to |stats_src| and |stats_tgt| if given.
     static util::Status PruneSentencePiecesJoint(
             const std::unique_ptr<unigram::Trainer> &trainer_src,
             const std::unique_ptr<unigram::Trainer> &trainer_tgt,
-            const unigram::TrainerModel &model_src,
-            const unigram::TrainerModel &model_tgt
+            unigram::TrainerModel *model_src,
+            unigram::TrainerModel *model_tgt,
+            unigram::RoundStats *stats_src = nullptr,
+            unigram::RoundStats *stats_tgt = nullptr
             );
  private:
   SentencePieceAlignTrainer() {}
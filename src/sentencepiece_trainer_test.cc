@@ -100,6 +100,43 @@ TEST(SentencePieceTrainerTest, TrainFromArgsTest) {
   CheckVocab(model + ".model", 9186);
 }
 
+TEST(SentencePieceTrainerTest, TrainMultipleTest) {
+  const std::string input =
+      util::JoinPath(absl::GetFlag(FLAGS_test_srcdir), kTestData);
+  const std::string model =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "m");
+
+  TrainerSpec trainer_spec;
+  trainer_spec.add_input(input);
+  trainer_spec.set_vocab_size(1000);
+  trainer_spec.set_num_threads(4);
+
+  std::vector<TrainerSpec> trainer_specs;
+  for (const auto type : {TrainerSpec::UNIGRAM, TrainerSpec::BPE,
+                          TrainerSpec::CHAR, TrainerSpec::WORD}) {
+    trainer_specs.push_back(trainer_spec);
+    trainer_specs.back().set_model_type(type);
+    trainer_specs.back().set_model_prefix(absl::StrCat(model, "_", type));
+  }
+  trainer_specs[1].set_vocab_size(2000);
+
+  NormalizerSpec normalizer_spec;
+  NormalizerSpec denormalizer_spec;
+  ASSERT_TRUE(SentencePieceTrainer::TrainMultiple(
+                  trainer_specs, normalizer_spec, denormalizer_spec)
+                  .ok());
+  CheckVocab(trainer_specs[0].model_prefix() + ".model", 1000);
+  CheckVocab(trainer_specs[1].model_prefix() + ".model", 2000);
+  CheckVocab(trainer_specs[2].model_prefix() + ".model", 72);
+  CheckVocab(trainer_specs[3].model_prefix() + ".model", 1000);
+
+  // The corpus cannot be shared when it is loaded differently.
+  trainer_specs[1].set_character_coverage(0.99);
+  EXPECT_FALSE(SentencePieceTrainer::TrainMultiple(
+                   trainer_specs, normalizer_spec, denormalizer_spec)
+                   .ok());
+}
+
 TEST(SentencePieceTrainerTest, TrainFromIterator) {
   class VectorIterator : public SentenceIterator {
    public:
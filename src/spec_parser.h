@@ -39,6 +39,19 @@ namespace sentencepiece {
     return util::OkStatus();                                    \
   }
 
+#define PARSE_REPEATED_INT32(param_name)                                \
+  if (name == #param_name) {                                            \
+    for (const std::string &val : util::StrSplitAsCSV(value)) {         \
+      int32 v;                                                          \
+      if (!string_util::lexical_cast(val, &v))                          \
+        return util::StatusBuilder(util::StatusCode::kInvalidArgument,  \
+                                   GTL_LOC)                             \
+               << "cannot parse \"" << val << "\" as int.";             \
+      message->add_##param_name(v);                                     \
+    }                                                                   \
+    return util::OkStatus();                                            \
+  }
+
 #define PARSE_BYTE(param_name)                             \
   if (name == #param_name) {                               \
     message->set_##param_name(value.data(), value.size()); \
@@ -93,6 +106,10 @@ namespace sentencepiece {
   for (const auto &v : message.param_name()) \
     os << "  " << #param_name << ": " << v << "\n";
 
+#define PRINT_REPEATED_INT32(param_name)     \
+  for (const auto &v : message.param_name()) \
+    os << "  " << #param_name << ": " << v << "\n";
+
 #define PRINT_ENUM(param_name, map_name)               \
   const auto it = map_name.find(message.param_name()); \
   if (it == map_name.end())                            \
@@ -141,6 +158,15 @@ inline std::string PrintProto(const TrainerSpec &message,
   PRINT_PARAM(byte_fallback);
   PRINT_PARAM(vocabulary_output_piece_score);
   PRINT_PARAM(train_extremely_large_corpus);
+  PRINT_PARAM(em_convergence_threshold);
+  PRINT_PARAM(adaptive_shrinking);
+  PRINT_PARAM(min_shrinking_factor);
+  PRINT_REPEATED_INT32(snapshot_vocab_sizes);
+  PRINT_PARAM(checkpoint_interval);
+  PRINT_PARAM(save_corpus_cache);
+  PRINT_PARAM(resume_from_checkpoint);
+  PRINT_PARAM(training_stats_file);
+  PRINT_PARAM(joint_seed_sentencepieces);
   PRINT_PARAM(hard_vocab_limit);
   PRINT_PARAM(use_all_vocab);
   PRINT_PARAM(unk_id);
@@ -216,6 +242,15 @@ util::Status SentencePieceTrainer::SetProtoField(const std::string &name,
   PARSE_BOOL(hard_vocab_limit);
   PARSE_BOOL(vocabulary_output_piece_score);
   PARSE_BOOL(train_extremely_large_corpus);
+  PARSE_DOUBLE(em_convergence_threshold);
+  PARSE_BOOL(adaptive_shrinking);
+  PARSE_DOUBLE(min_shrinking_factor);
+  PARSE_REPEATED_INT32(snapshot_vocab_sizes);
+  PARSE_INT32(checkpoint_interval);
+  PARSE_BOOL(save_corpus_cache);
+  PARSE_BOOL(resume_from_checkpoint);
+  PARSE_STRING(training_stats_file);
+  PARSE_BOOL(joint_seed_sentencepieces);
   PARSE_BOOL(use_all_vocab);
   PARSE_INT32(unk_id);
   PARSE_INT32(bos_id);
@@ -249,6 +284,7 @@ util::Status SentencePieceTrainer::SetProtoField(const std::string &name,
 
 #undef PARSE_STRING
 #undef PARSE_REPEATED_STRING
+#undef PARSE_REPEATED_INT32
 #undef PARSE_BOOL
 #undef PARSE_BYTE
 #undef PARSE_INT32
@@ -256,6 +292,7 @@ util::Status SentencePieceTrainer::SetProtoField(const std::string &name,
 #undef PARSE_ENUM
 #undef PRINT_MAP
 #undef PRINT_REPEATED_STRING
+#undef PRINT_REPEATED_INT32
 #undef PRINT_ENUM
 }  // namespace sentencepiece
 
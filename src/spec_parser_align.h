@@ -79,6 +79,10 @@ namespace sentencepiece {
   for (const auto &v : message.param_name()) \
     os << "  " << #param_name << ": " << v << "\n";
 
+#define PRINT_REPEATED_INT32(param_name)     \
+  for (const auto &v : message.param_name()) \
+    os << "  " << #param_name << ": " << v << "\n";
+
 #define PRINT_ENUM(param_name, map_name)               \
   const auto it = map_name.find(message.param_name()); \
   if (it == map_name.end())                            \
@@ -127,6 +131,15 @@ inline std::string PrintProto(const TrainerSpec &message,
   PRINT_PARAM(byte_fallback);
   PRINT_PARAM(vocabulary_output_piece_score);
   PRINT_PARAM(train_extremely_large_corpus);
+  PRINT_PARAM(em_convergence_threshold);
+  PRINT_PARAM(adaptive_shrinking);
+  PRINT_PARAM(min_shrinking_factor);
+  PRINT_REPEATED_INT32(snapshot_vocab_sizes);
+  PRINT_PARAM(checkpoint_interval);
+  PRINT_PARAM(save_corpus_cache);
+  PRINT_PARAM(resume_from_checkpoint);
+  PRINT_PARAM(training_stats_file);
+  PRINT_PARAM(joint_seed_sentencepieces);
   PRINT_PARAM(hard_vocab_limit);
   PRINT_PARAM(use_all_vocab);
   PRINT_PARAM(unk_id);
@@ -242,6 +255,7 @@ inline std::string PrintProto(const NormalizerSpec &message,
 #undef PARSE_ENUM
 #undef PRINT_MAP
 #undef PRINT_REPEATED_STRING
+#undef PRINT_REPEATED_INT32
 #undef PRINT_ENUM
 }  // namespace sentencepiece
 
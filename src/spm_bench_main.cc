@@ -0,0 +1,394 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+// Benchmarks the hot paths of the encoder, decoder, normalizer and trainers
+// on the corpora in data/. The results are printed as a table and written
+// as JSON lines to --output, one line per (benchmark, corpus).
+//
+// Usage:
+//   spm_bench --data_dir=data --output=bench.jsonl --min_time_sec=2
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "filesystem.h"
+#include "init.h"
+#include "model_factory.h"
+#include "model_interface.h"
+#include "normalizer.h"
+#include "sentencepiece.pb.h"
+#include "sentencepiece_model.pb.h"
+#include "sentencepiece_processor.h"
+#include "sentencepiece_trainer.h"
+#include "third_party/absl/flags/flag.h"
+#include "third_party/absl/strings/str_cat.h"
+#include "util.h"
+
+ABSL_FLAG(std::string, data_dir, "../data",
+          "directory of botchan.txt and wagahaiwa_nekodearu.txt");
+ABSL_FLAG(std::string, model_dir, ".",
+          "directory to save the models trained by the benchmark");
+ABSL_FLAG(std::string, output, "",
+          "writes the results as JSON lines to this file");
+ABSL_FLAG(std::string, benchmark_filter, "",
+          "runs only the benchmarks whose name contains this string");
+ABSL_FLAG(double, min_time_sec, 1.0,
+          "minimum seconds to run each benchmark. Every sentence is "
+          "processed at least once");
+ABSL_FLAG(int32, max_sentences, 2000,
+          "number of sentences of each corpus to benchmark on");
+ABSL_FLAG(int32, vocab_size, 4000, "vocabulary size of the trained models");
+ABSL_FLAG(int32, nbest_size, 10, "NBest size");
+ABSL_FLAG(double, alpha, 0.1, "smoothing parameter for sampling");
+
+// Counts the allocations of the whole process, so that the allocations per
+// call of a benchmark can be reported.
+namespace {
+std::atomic<int64> g_num_allocations(0);
+}  // namespace
+
+void *operator new(size_t size) {
+  g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace sentencepiece {
+namespace {
+
+struct Corpus {
+  std::string name;
+  std::string filename;
+  std::string train_args;  // extra arguments of the trainers.
+};
+
+struct BenchmarkResult {
+  std::string name;
+  std::string corpus;
+  int64 calls = 0;
+  int64 bytes = 0;  // input bytes processed by all calls.
+  double total_sec = 0.0;
+  double p50_usec = 0.0;
+  double p90_usec = 0.0;
+  double p99_usec = 0.0;
+  double allocations_per_call = 0.0;
+
+  std::string ToJson() const {
+    std::ostringstream os;
+    os << "{\"benchmark\": \"" << name << "\", \"corpus\": \"" << corpus
+       << "\", \"calls\": " << calls << ", \"bytes\": " << bytes
+       << ", \"total_sec\": " << total_sec
+       << ", \"calls_per_sec\": " << calls / total_sec
+       << ", \"mb_per_sec\": " << bytes / total_sec / 1e6
+       << ", \"p50_usec\": " << p50_usec << ", \"p90_usec\": " << p90_usec
+       << ", \"p99_usec\": " << p99_usec
+       << ", \"allocations_per_call\": " << allocations_per_call << "}";
+    return os.str();
+  }
+};
+
+bool IsSelected(absl::string_view name) {
+  const std::string filter = absl::GetFlag(FLAGS_benchmark_filter);
+  return filter.empty() || name.find(filter) != absl::string_view::npos;
+}
+
+double Percentile(std::vector<double> *latencies, double p) {
+  if (latencies->empty()) return 0.0;
+  const size_t n = std::min(latencies->size() - 1,
+                            static_cast<size_t>(p * latencies->size()));
+  std::nth_element(latencies->begin(), latencies->begin() + n,
+                   latencies->end());
+  return (*latencies)[n];
+}
+
+// Calls |func| on the inputs 0 .. |size| - 1 in turn until min_time_sec
+// passes and every input is processed at least once. |func| returns the
+// number of bytes it processed.
+BenchmarkResult RunBenchmark(absl::string_view name, absl::string_view corpus,
+                             size_t size,
+                             const std::function<size_t(size_t)> &func) {
+  BenchmarkResult result;
+  result.name = std::string(name);
+  result.corpus = std::string(corpus);
+
+  const double min_time_sec = absl::GetFlag(FLAGS_min_time_sec);
+  std::vector<double> latencies;
+  const int64 num_allocations = g_num_allocations.load();
+  const util::Timer total;
+  for (size_t i = 0; size > 0; i = (i + 1) % size) {
+    const util::Timer timer;
+    result.bytes += func(i);
+    latencies.push_back(timer.Get() * 1e6);
+    if (i + 1 == size && total.Get() >= min_time_sec) break;
+  }
+  result.total_sec = std::max(total.Get(), 1e-9);
+  result.calls = latencies.size();
+  result.allocations_per_call =
+      static_cast<double>(g_num_allocations.load() - num_allocations) /
+      std::max<int64>(result.calls, 1);
+  result.p50_usec = Percentile(&latencies, 0.50);
+  result.p90_usec = Percentile(&latencies, 0.90);
+  result.p99_usec = Percentile(&latencies, 0.99);
+  return result;
+}
+
+std::vector<std::string> ReadSentences(absl::string_view filename,
+                                       size_t size) {
+  auto input = filesystem::NewReadableFile(filename);
+  CHECK_OK(input->status());
+  std::vector<std::string> sentences;
+  std::string line;
+  while (sentences.size() < size && input->ReadLine(&line)) {
+    if (!line.empty()) sentences.push_back(line);
+  }
+  return sentences;
+}
+
+// Trains a model of |model_type| on |corpus| and returns its filename.
+// The training is recorded as a benchmark of a single call, whatever
+// min_time_sec is.
+std::string TrainModel(const Corpus &corpus, absl::string_view model_type,
+                       std::vector<BenchmarkResult> *results) {
+  const std::string model_prefix =
+      util::JoinPath(absl::GetFlag(FLAGS_model_dir),
+                     absl::StrCat("spm_bench.", corpus.name, ".", model_type));
+  const std::string args = absl::StrCat(
+      "--input=", util::JoinPath(absl::GetFlag(FLAGS_data_dir), corpus.filename),
+      " --model_prefix=", model_prefix, " --model_type=", model_type,
+      " --vocab_size=", absl::StrCat(absl::GetFlag(FLAGS_vocab_size)),
+      " --minloglevel=1 ", corpus.train_args);
+  const int64 num_allocations = g_num_allocations.load();
+  const util::Timer timer;
+  CHECK_OK(SentencePieceTrainer::Train(args));
+
+  BenchmarkResult result;
+  result.name = absl::StrCat(model_type, "_train");
+  result.corpus = corpus.name;
+  result.calls = 1;
+  result.total_sec = timer.Get();
+  result.p50_usec = result.p90_usec = result.p99_usec = result.total_sec * 1e6;
+  result.allocations_per_call = g_num_allocations.load() - num_allocations;
+  if (IsSelected(result.name)) results->push_back(result);
+  return model_prefix + ".model";
+}
+
+void RunCorpus(const Corpus &corpus, std::vector<BenchmarkResult> *results) {
+  const std::vector<std::string> sentences = ReadSentences(
+      util::JoinPath(absl::GetFlag(FLAGS_data_dir), corpus.filename),
+      absl::GetFlag(FLAGS_max_sentences));
+  const size_t size = sentences.size();
+
+  std::vector<std::pair<std::string, std::string>> models;
+  for (const char *model_type : {"unigram", "bpe"}) {
+    models.emplace_back(model_type, TrainModel(corpus, model_type, results));
+  }
+
+  for (const auto &model : models) {
+    const std::string &model_type = model.first;
+    ModelProto model_proto;
+    CHECK_OK(io::LoadModelProto(model.second, &model_proto));
+    auto model_impl = ModelFactory::Create(model_proto);
+    CHECK_OK(model_impl->status());
+
+    // Normalizes the sentences first, so that the encoders are measured
+    // on their own.
+    normalizer::Normalizer normalizer(model_proto.normalizer_spec(),
+                                      model_proto.trainer_spec());
+    normalizer.SetPrefixMatcher(model_impl->prefix_matcher());
+    std::vector<std::string> normalized(size);
+    for (size_t i = 0; i < size; ++i) {
+      CHECK_OK(normalizer.Normalize(sentences[i], &normalized[i], nullptr));
+    }
+
+    auto run = [&](absl::string_view suffix,
+                   const std::function<size_t(size_t)> &func) {
+      const std::string name = absl::StrCat(model_type, "_", suffix);
+      if (IsSelected(name)) {
+        results->push_back(RunBenchmark(name, corpus.name, size, func));
+      }
+    };
+
+    run("normalize", [&](size_t i) {
+      std::string output;
+      std::vector<uint32> alignment;
+      normalizer.Normalize(sentences[i], &output, &alignment);
+      return sentences[i].size();
+    });
+
+    std::string buffer;
+    run("normalize_without_alignment", [&](size_t i) {
+      normalizer.Normalize(sentences[i], &buffer, nullptr);
+      return sentences[i].size();
+    });
+
+    if (model_type == "unigram") {
+      CHECK_OK(model_impl->SetEncoderVersion(EncoderVersion::kOriginal));
+      run("encode", [&](size_t i) {
+        model_impl->Encode(normalized[i]);
+        return normalized[i].size();
+      });
+      CHECK_OK(model_impl->SetEncoderVersion(EncoderVersion::kOptimized));
+      run("encode_optimized", [&](size_t i) {
+        model_impl->Encode(normalized[i]);
+        return normalized[i].size();
+      });
+      // The batches of 16 sentences, as the processor passes to the model.
+      // Compare the MB/s with encode_optimized.
+      std::vector<absl::string_view> batch;
+      run("encode_batch", [&](size_t i) {
+        batch.clear();
+        size_t bytes = 0;
+        for (size_t j = i; j < std::min(size, i + 16); ++j) {
+          batch.push_back(normalized[j]);
+          bytes += normalized[j].size();
+        }
+        model_impl->EncodeBatch(batch);
+        return bytes;
+      });
+      run("nbest_encode", [&](size_t i) {
+        model_impl->NBestEncode(normalized[i],
+                                absl::GetFlag(FLAGS_nbest_size));
+        return normalized[i].size();
+      });
+    } else {
+      run("encode", [&](size_t i) {
+        model_impl->Encode(normalized[i]);
+        return normalized[i].size();
+      });
+    }
+
+    const float alpha = absl::GetFlag(FLAGS_alpha);
+    run("sample_encode", [&](size_t i) {
+      model_impl->SampleEncode(normalized[i], alpha);
+      return normalized[i].size();
+    });
+
+    // Decodes the ids of the sentences, as the processor emits them.
+    SentencePieceProcessor sp;
+    CHECK_OK(sp.Load(model.second));
+    std::vector<std::vector<int>> ids(size);
+    for (size_t i = 0; i < size; ++i) {
+      CHECK_OK(sp.Encode(sentences[i], &ids[i]));
+    }
+    // The processor API, i.e., normalization and encoding.
+    run("processor_encode_proto", [&](size_t i) {
+      SentencePieceText spt;
+      sp.Encode(sentences[i], &spt);
+      return sentences[i].size();
+    });
+    std::vector<int> output_ids;
+    run("processor_encode_ids", [&](size_t i) {
+      sp.Encode(sentences[i], &output_ids);
+      return sentences[i].size();
+    });
+    SentencePieceSpans spans;
+    run("processor_encode_spans", [&](size_t i) {
+      sp.Encode(sentences[i], &spans);
+      return sentences[i].size();
+    });
+
+    // The tries are relayouted for the whole corpus. A separate processor
+    // keeps the following benchmarks on the original layout.
+    {
+      SentencePieceProcessor relayouted_sp;
+      CHECK_OK(relayouted_sp.Load(model.second));
+      CHECK_OK(relayouted_sp.OptimizeTrieLayout(
+          std::vector<absl::string_view>(sentences.begin(), sentences.end())));
+      run("encode_ids_relayout", [&](size_t i) {
+        relayouted_sp.Encode(sentences[i], &output_ids);
+        return sentences[i].size();
+      });
+    }
+
+    CHECK_OK(sp.SetWordCacheSize(16 << 20));
+    run("encode_ids_word_cache", [&](size_t i) {
+      sp.Encode(sentences[i], &output_ids);
+      return sentences[i].size();
+    });
+    CHECK_OK(sp.SetWordCacheSize(0));
+
+    CHECK_OK(sp.SetSentenceCacheSize(64 << 20));
+    run("encode_ids_sentence_cache", [&](size_t i) {
+      sp.Encode(sentences[i], &output_ids);
+      return sentences[i].size();
+    });
+    CHECK_OK(sp.SetSentenceCacheSize(0));
+
+    run("decode", [&](size_t i) {
+      std::string detok;
+      sp.Decode(ids[i], &detok);
+      return detok.size();
+    });
+  }
+}
+
+void PrintResults(const std::vector<BenchmarkResult> &results) {
+  std::cout << std::left << std::setw(36) << "benchmark" << std::setw(10)
+            << "corpus" << std::right << std::setw(10) << "calls"
+            << std::setw(12) << "calls/s" << std::setw(10) << "MB/s"
+            << std::setw(10) << "p50(us)" << std::setw(10) << "p90(us)"
+            << std::setw(12) << "p99(us)" << std::setw(12) << "allocs/call"
+            << std::endl;
+  std::cout << std::fixed;
+  for (const auto &r : results) {
+    std::cout << std::left << std::setw(36) << r.name << std::setw(10)
+              << r.corpus << std::right << std::setw(10) << r.calls
+              << std::setw(12) << std::setprecision(1)
+              << r.calls / r.total_sec << std::setw(10)
+              << std::setprecision(2) << r.bytes / r.total_sec / 1e6
+              << std::setw(10) << std::setprecision(1) << r.p50_usec
+              << std::setw(10) << r.p90_usec << std::setw(12) << r.p99_usec
+              << std::setw(12) << r.allocations_per_call << std::endl;
+  }
+}
+
+}  // namespace
+}  // namespace sentencepiece
+
+int main(int argc, char *argv[]) {
+  sentencepiece::ParseCommandLineFlags(argv[0], &argc, &argv, true);
+
+  const std::vector<sentencepiece::Corpus> corpora = {
+      {"botchan", "botchan.txt", ""},
+      {"wagahai", "wagahaiwa_nekodearu.txt", "--character_coverage=0.98"}};
+
+  std::vector<sentencepiece::BenchmarkResult> results;
+  for (const auto &corpus : corpora) {
+    sentencepiece::RunCorpus(corpus, &results);
+  }
+
+  sentencepiece::PrintResults(results);
+
+  if (!absl::GetFlag(FLAGS_output).empty()) {
+    auto output =
+        sentencepiece::filesystem::NewWritableFile(absl::GetFlag(FLAGS_output));
+    CHECK_OK(output->status());
+    for (const auto &r : results) {
+      output->WriteLine(r.ToJson());
+    }
+  }
+
+  return 0;
+}
@@ -1,6 +1,7 @@
 #include <map>
 
 #include "init.h"
+#include "parallel_corpus.h"
 #include "sentencepiece_model.pb.h"
 #include "sentencepiece_trainer_align.h"
 #include "third_party/absl/flags/flag.h"
@@ -19,14 +20,30 @@ namespace {
 
 //ABSL_FLAG(std::string, input, "", "comma separated list of input sentences");
 ABSL_FLAG(std::string, input, "", "comma separated list of input sentences");
+ABSL_FLAG(std::string, src_input, "",
+          "comma separated list of source files, line-aligned with "
+          "--tgt_input");
+ABSL_FLAG(std::string, tgt_input, "",
+          "comma separated list of target files, line-aligned with "
+          "--src_input");
+ABSL_FLAG(std::string, parallel_input, "",
+          "comma separated list of parallel files of <src>\\t<tgt> lines");
 ABSL_FLAG(std::string, input_format, kDefaultTrainerSpec.input_format(),
           "Input format. Supported format is `text` or `tsv`.");
 ABSL_FLAG(std::string, model_prefix, "", "output model prefix");
+ABSL_FLAG(std::string, src_model_prefix, "",
+          "output model prefix of the source side. <model_prefix>.src if empty");
+ABSL_FLAG(std::string, tgt_model_prefix, "",
+          "output model prefix of the target side. <model_prefix>.tgt if empty");
 //ABSL_FLAG(std::string, model_prefix, "", "output model prefix");
 ABSL_FLAG(std::string, model_type, "unigram",
           "model algorithm: unigram, bpe, word or char");
 ABSL_FLAG(int32, vocab_size, kDefaultTrainerSpec.vocab_size(),
           "vocabulary size");
+ABSL_FLAG(int32, src_vocab_size, 0,
+          "vocabulary size of the source side. --vocab_size if 0");
+ABSL_FLAG(int32, tgt_vocab_size, 0,
+          "vocabulary size of the target side. --vocab_size if 0");
 ABSL_FLAG(std::string, accept_language, "",
           "comma-separated list of languages this model can accept");
 ABSL_FLAG(int32, self_test_sample_size,
@@ -49,6 +66,32 @@ ABSL_FLAG(int32, num_threads, kDefaultTrainerSpec.num_threads(),
           "number of threads for training");
 ABSL_FLAG(int32, num_sub_iterations, kDefaultTrainerSpec.num_sub_iterations(),
           "number of EM sub-iterations");
+ABSL_FLAG(double, em_convergence_threshold,
+          kDefaultTrainerSpec.em_convergence_threshold(),
+          "Stops EM sub-iterations when the relative change of the objective "
+          "falls below this value. 0 disables the early exit.");
+ABSL_FLAG(bool, adaptive_shrinking, kDefaultTrainerSpec.adaptive_shrinking(),
+          "Chooses the shrink ratio of each pruning round from the "
+          "distribution of pruning losses.");
+ABSL_FLAG(double, min_shrinking_factor,
+          kDefaultTrainerSpec.min_shrinking_factor(),
+          "Lower bound of the shrink ratio when --adaptive_shrinking is set");
+ABSL_FLAG(std::string, snapshot_vocab_sizes, "",
+          "comma separated list of vocab sizes larger than --vocab_size. "
+          "A model is also saved to <model_prefix>.<size> for each of them");
+ABSL_FLAG(int32, checkpoint_interval,
+          kDefaultTrainerSpec.checkpoint_interval(),
+          "Saves a checkpoint after every N EM rounds. 0 disables it.");
+ABSL_FLAG(bool, save_corpus_cache, kDefaultTrainerSpec.save_corpus_cache(),
+          "Saves the preprocessed corpus along with the checkpoint.");
+ABSL_FLAG(bool, resume_from_checkpoint,
+          kDefaultTrainerSpec.resume_from_checkpoint(),
+          "Resumes the training from the last checkpoint.");
+ABSL_FLAG(std::string, training_stats_file, "",
+          "Writes the time and memory usage of each EM round as JSON lines.");
+ABSL_FLAG(bool, joint_seed_sentencepieces,
+          kDefaultTrainerSpec.joint_seed_sentencepieces(),
+          "Makes the seed pieces of both sides from one suffix array.");
 ABSL_FLAG(int32, max_sentencepiece_length,
           kDefaultTrainerSpec.max_sentencepiece_length(),
           "maximum length of sentence piece");
@@ -123,8 +166,15 @@ int main(int argc, char *argv[]) {
   sentencepiece::ParseCommandLineFlags(argv[0], &argc, &argv, true);
 
   LOG(INFO)<<"train_align::main() called";
-  CHECK(!absl::GetFlag(FLAGS_input).empty());
-  CHECK(!absl::GetFlag(FLAGS_model_prefix).empty());
+  CHECK_EQ(1, !absl::GetFlag(FLAGS_input).empty() +
+                  !absl::GetFlag(FLAGS_parallel_input).empty() +
+                  !absl::GetFlag(FLAGS_src_input).empty())
+      << "Specify one of --input, --parallel_input or --src_input.";
+  CHECK_EQ(absl::GetFlag(FLAGS_src_input).empty(),
+           absl::GetFlag(FLAGS_tgt_input).empty());
+  CHECK(!absl::GetFlag(FLAGS_model_prefix).empty() ||
+        (!absl::GetFlag(FLAGS_src_model_prefix).empty() &&
+         !absl::GetFlag(FLAGS_tgt_model_prefix).empty()));
 
   sentencepiece::TrainerSpec trainer_spec_src, trainer_spec_tgt;
   sentencepiece::NormalizerSpec normalizer_spec;
@@ -165,6 +215,14 @@ int main(int argc, char *argv[]) {
   SetTrainerSpecFromFlagSrc(shrinking_factor);
   SetTrainerSpecFromFlagSrc(num_threads);
   SetTrainerSpecFromFlagSrc(num_sub_iterations);
+  SetTrainerSpecFromFlagSrc(em_convergence_threshold);
+  SetTrainerSpecFromFlagSrc(adaptive_shrinking);
+  SetTrainerSpecFromFlagSrc(min_shrinking_factor);
+  SetTrainerSpecFromFlagSrc(checkpoint_interval);
+  SetTrainerSpecFromFlagSrc(save_corpus_cache);
+  SetTrainerSpecFromFlagSrc(resume_from_checkpoint);
+  SetTrainerSpecFromFlagSrc(training_stats_file);
+  SetTrainerSpecFromFlagSrc(joint_seed_sentencepieces);
   SetTrainerSpecFromFlagSrc(max_sentencepiece_length);
   SetTrainerSpecFromFlagSrc(max_sentence_length);
   SetTrainerSpecFromFlagSrc(split_by_unicode_script);
@@ -203,6 +261,14 @@ int main(int argc, char *argv[]) {
   SetTrainerSpecFromFlagTgt(shrinking_factor);
   SetTrainerSpecFromFlagTgt(num_threads);
   SetTrainerSpecFromFlagTgt(num_sub_iterations);
+  SetTrainerSpecFromFlagTgt(em_convergence_threshold);
+  SetTrainerSpecFromFlagTgt(adaptive_shrinking);
+  SetTrainerSpecFromFlagTgt(min_shrinking_factor);
+  SetTrainerSpecFromFlagTgt(checkpoint_interval);
+  SetTrainerSpecFromFlagTgt(save_corpus_cache);
+  SetTrainerSpecFromFlagTgt(resume_from_checkpoint);
+  SetTrainerSpecFromFlagTgt(training_stats_file);
+  SetTrainerSpecFromFlagTgt(joint_seed_sentencepieces);
   SetTrainerSpecFromFlagTgt(max_sentencepiece_length);
   SetTrainerSpecFromFlagTgt(max_sentence_length);
   SetTrainerSpecFromFlagTgt(split_by_unicode_script);
@@ -229,14 +295,57 @@ int main(int argc, char *argv[]) {
   SetRepeatedTrainerSpecFromFlagTgt(user_defined_symbols);
   SetTrainerSpecFromFlagTgt(train_extremely_large_corpus);
 
+  if (!absl::GetFlag(FLAGS_snapshot_vocab_sizes).empty()) {
+    for (const auto &v : sentencepiece::util::StrSplitAsCSV(
+             absl::GetFlag(FLAGS_snapshot_vocab_sizes))) {
+      int32 size = 0;
+      CHECK(sentencepiece::string_util::lexical_cast(v, &size))
+          << "cannot parse \"" << v << "\" as int.";
+      trainer_spec_src.add_snapshot_vocab_sizes(size);
+      trainer_spec_tgt.add_snapshot_vocab_sizes(size);
+    }
+  }
+
+  // Each side is saved to its own model prefix.
+  const std::string model_prefix = absl::GetFlag(FLAGS_model_prefix);
+  trainer_spec_src.set_model_prefix(
+      absl::GetFlag(FLAGS_src_model_prefix).empty()
+          ? model_prefix + ".src"
+          : absl::GetFlag(FLAGS_src_model_prefix));
+  trainer_spec_tgt.set_model_prefix(
+      absl::GetFlag(FLAGS_tgt_model_prefix).empty()
+          ? model_prefix + ".tgt"
+          : absl::GetFlag(FLAGS_tgt_model_prefix));
+  if (absl::GetFlag(FLAGS_src_vocab_size) > 0)
+    trainer_spec_src.set_vocab_size(absl::GetFlag(FLAGS_src_vocab_size));
+  if (absl::GetFlag(FLAGS_tgt_vocab_size) > 0)
+    trainer_spec_tgt.set_vocab_size(absl::GetFlag(FLAGS_tgt_vocab_size));
+
   normalizer_spec.set_name(absl::GetFlag(FLAGS_normalization_rule_name));
   SetNormalizerSpecFromFlag(normalization_rule_tsv);
   SetNormalizerSpecFromFlag(add_dummy_prefix);
   SetNormalizerSpecFromFlag(remove_extra_whitespaces);
 
+  // A parallel corpus is read once and both sides get the same pairs.
+  sentencepiece::ParallelCorpus corpus(trainer_spec_src, trainer_spec_tgt,
+                                       normalizer_spec);
+  std::unique_ptr<sentencepiece::SentenceIterator> src_iterator, tgt_iterator;
+  if (absl::GetFlag(FLAGS_input).empty()) {
+    if (!absl::GetFlag(FLAGS_parallel_input).empty()) {
+      CHECK_OK(corpus.LoadTsv(sentencepiece::util::StrSplitAsCSV(
+          absl::GetFlag(FLAGS_parallel_input))));
+    } else {
+      CHECK_OK(corpus.LoadAligned(
+          sentencepiece::util::StrSplitAsCSV(absl::GetFlag(FLAGS_src_input)),
+          sentencepiece::util::StrSplitAsCSV(absl::GetFlag(FLAGS_tgt_input))));
+    }
+    src_iterator = corpus.NewSrcIterator();
+    tgt_iterator = corpus.NewTgtIterator();
+  }
 
   CHECK_OK(sentencepiece::SentencePieceAlignTrainer::Train());
-  CHECK_OK(sentencepiece::SentencePieceAlignTrainer::Train(trainer_spec_src,trainer_spec_tgt,normalizer_spec, denormalizer_spec));
+  CHECK_OK(sentencepiece::SentencePieceAlignTrainer::Train(trainer_spec_src,trainer_spec_tgt,normalizer_spec, denormalizer_spec,
+                                                           src_iterator.get(), tgt_iterator.get()));
 
   return 0;
 }
@@ -13,12 +13,15 @@
 // limitations under the License.!
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include "init.h"
 #include "sentencepiece_model.pb.h"
 #include "sentencepiece_trainer.h"
 #include "third_party/absl/flags/flag.h"
 #include "third_party/absl/strings/ascii.h"
+#include "third_party/absl/strings/str_cat.h"
 #include "third_party/absl/strings/str_split.h"
 #include "util.h"
 
@@ -35,7 +38,9 @@ ABSL_FLAG(std::string, input_format, kDefaultTrainerSpec.input_format(),
           "Input format. Supported format is `text` or `tsv`.");
 ABSL_FLAG(std::string, model_prefix, "", "output model prefix");
 ABSL_FLAG(std::string, model_type, "unigram",
-          "model algorithm: unigram, bpe, word or char");
+          "model algorithm: unigram, bpe, word or char. A comma separated "
+          "list trains one model per type from a single load of the corpus, "
+          "each saved to <model_prefix>.<type>");
 ABSL_FLAG(int32, vocab_size, kDefaultTrainerSpec.vocab_size(),
           "vocabulary size");
 ABSL_FLAG(std::string, accept_language, "",
@@ -60,6 +65,29 @@ ABSL_FLAG(int32, num_threads, kDefaultTrainerSpec.num_threads(),
           "number of threads for training");
 ABSL_FLAG(int32, num_sub_iterations, kDefaultTrainerSpec.num_sub_iterations(),
           "number of EM sub-iterations");
+ABSL_FLAG(double, em_convergence_threshold,
+          kDefaultTrainerSpec.em_convergence_threshold(),
+          "Stops EM sub-iterations when the relative change of the objective "
+          "falls below this value. 0 disables the early exit.");
+ABSL_FLAG(bool, adaptive_shrinking, kDefaultTrainerSpec.adaptive_shrinking(),
+          "Chooses the shrink ratio of each pruning round from the "
+          "distribution of pruning losses.");
+ABSL_FLAG(double, min_shrinking_factor,
+          kDefaultTrainerSpec.min_shrinking_factor(),
+          "Lower bound of the shrink ratio when --adaptive_shrinking is set");
+ABSL_FLAG(std::string, snapshot_vocab_sizes, "",
+          "comma separated list of vocab sizes larger than --vocab_size. "
+          "A model is also saved to <model_prefix>.<size> for each of them");
+ABSL_FLAG(int32, checkpoint_interval,
+          kDefaultTrainerSpec.checkpoint_interval(),
+          "Saves a checkpoint after every N EM rounds. 0 disables it.");
+ABSL_FLAG(bool, save_corpus_cache, kDefaultTrainerSpec.save_corpus_cache(),
+          "Saves the preprocessed corpus along with the checkpoint.");
+ABSL_FLAG(bool, resume_from_checkpoint,
+          kDefaultTrainerSpec.resume_from_checkpoint(),
+          "Resumes the training from the last checkpoint.");
+ABSL_FLAG(std::string, training_stats_file, "",
+          "Writes the time and memory usage of each EM round as JSON lines.");
 ABSL_FLAG(int32, max_sentencepiece_length,
           kDefaultTrainerSpec.max_sentencepiece_length(),
           "maximum length of sentence piece");
@@ -168,6 +196,13 @@ int main(int argc, char *argv[]) {
   SetTrainerSpecFromFlag(shrinking_factor);
   SetTrainerSpecFromFlag(num_threads);
   SetTrainerSpecFromFlag(num_sub_iterations);
+  SetTrainerSpecFromFlag(em_convergence_threshold);
+  SetTrainerSpecFromFlag(adaptive_shrinking);
+  SetTrainerSpecFromFlag(min_shrinking_factor);
+  SetTrainerSpecFromFlag(checkpoint_interval);
+  SetTrainerSpecFromFlag(save_corpus_cache);
+  SetTrainerSpecFromFlag(resume_from_checkpoint);
+  SetTrainerSpecFromFlag(training_stats_file);
   SetTrainerSpecFromFlag(max_sentencepiece_length);
   SetTrainerSpecFromFlag(max_sentence_length);
   SetTrainerSpecFromFlag(split_by_unicode_script);
@@ -194,6 +229,16 @@ int main(int argc, char *argv[]) {
   SetRepeatedTrainerSpecFromFlag(user_defined_symbols);
   SetTrainerSpecFromFlag(train_extremely_large_corpus);
 
+  if (!absl::GetFlag(FLAGS_snapshot_vocab_sizes).empty()) {
+    for (const auto &v : sentencepiece::util::StrSplitAsCSV(
+             absl::GetFlag(FLAGS_snapshot_vocab_sizes))) {
+      int32 size = 0;
+      CHECK(sentencepiece::string_util::lexical_cast(v, &size))
+          << "cannot parse \"" << v << "\" as int.";
+      trainer_spec.add_snapshot_vocab_sizes(size);
+    }
+  }
+
   normalizer_spec.set_name(absl::GetFlag(FLAGS_normalization_rule_name));
   SetNormalizerSpecFromFlag(normalization_rule_tsv);
   SetNormalizerSpecFromFlag(add_dummy_prefix);
@@ -207,6 +252,26 @@ int main(int argc, char *argv[]) {
     denormalizer_spec.set_escape_whitespaces(false);
   }
 
+  const std::vector<std::string> model_types =
+      sentencepiece::util::StrSplitAsCSV(absl::GetFlag(FLAGS_model_type));
+  if (model_types.size() > 1) {
+    std::vector<TrainerSpec> trainer_specs;
+    for (const auto &model_type : model_types) {
+      trainer_specs.push_back(trainer_spec);
+      CHECK_OK(sentencepiece::SentencePieceTrainer::PopulateModelTypeFromString(
+          model_type, &trainer_specs.back()));
+      trainer_specs.back().set_model_prefix(
+          absl::StrCat(trainer_spec.model_prefix(), ".", model_type));
+      // Only the unigram model writes the training stats.
+      if (trainer_specs.back().model_type() != TrainerSpec::UNIGRAM) {
+        trainer_specs.back().clear_training_stats_file();
+      }
+    }
+    CHECK_OK(sentencepiece::SentencePieceTrainer::TrainMultiple(
+        trainer_specs, normalizer_spec, denormalizer_spec));
+    return 0;
+  }
+
   CHECK_OK(sentencepiece::SentencePieceTrainer::PopulateModelTypeFromString(
       absl::GetFlag(FLAGS_model_type), &trainer_spec));
 
@@ -26,7 +26,9 @@
 #include <vector>
 
 #include "common.h"
+#include "filesystem.h"
 #include "init.h"
+#include "sentencepiece_trainer.h"
 #include "third_party/absl/flags/flag.h"
 #include "third_party/absl/strings/str_cat.h"
 #include "util.h"
@@ -78,5 +80,28 @@ int RunAllTests() {
 
   return 0;
 }
+
+std::vector<std::string> ReadLines(absl::string_view filename,
+                                   size_t max_lines) {
+  auto input = filesystem::NewReadableFile(
+      util::JoinPath(absl::GetFlag(FLAGS_test_srcdir), filename));
+  CHECK_OK(input->status());
+  std::vector<std::string> lines;
+  std::string line;
+  while (lines.size() < max_lines && input->ReadLine(&line)) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+std::string TrainModel(absl::string_view input, absl::string_view name,
+                       absl::string_view args) {
+  const std::string model_prefix =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), name);
+  CHECK_OK(SentencePieceTrainer::Train(absl::StrCat(
+      "--input=", util::JoinPath(absl::GetFlag(FLAGS_test_srcdir), input),
+      " --model_prefix=", model_prefix, " ", args)));
+  return model_prefix + ".model";
+}
 }  // namespace test
 }  // namespace sentencepiece
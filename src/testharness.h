@@ -17,8 +17,10 @@
 
 #include <cmath>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "common.h"
 #include "init.h"
@@ -38,6 +40,16 @@ namespace test {
 // Dies or returns a non-zero value if some test fails.
 int RunAllTests();
 
+// Returns the first |max_lines| lines of |filename| in --test_srcdir.
+std::vector<std::string> ReadLines(
+    absl::string_view filename,
+    size_t max_lines = std::numeric_limits<size_t>::max());
+
+// Trains a model on |input| in --test_srcdir with the extra |args| and
+// returns the filename of the model saved as |name| in --test_tmpdir.
+std::string TrainModel(absl::string_view input, absl::string_view name,
+                       absl::string_view args);
+
 // An instance of Tester is allocated to hold temporary state during
 // the execution of an assertion.
 class Tester {
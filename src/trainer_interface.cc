@@ -49,6 +49,8 @@ const char32 TrainerInterface::kUPPBoundaryChar = L'\u0009';
 const char TrainerInterface::kUPPBoundaryStr[] = "\t";
 
 namespace {
+constexpr char kCorpusCacheMagic[] = "sentencepiece.corpus.v1";
+
 util::Status VerifySpec(const TrainerSpec &trainer_spec) {
   CHECK_GT_OR_RETURN(trainer_spec.vocab_size(), 0);
 
@@ -68,8 +70,35 @@ util::Status VerifySpec(const TrainerSpec &trainer_spec) {
   CHECK_RANGE(trainer_spec.self_test_sample_size(), 0, 1000);
   CHECK_RANGE(trainer_spec.shrinking_factor(), 0.5, 0.95);
   CHECK_RANGE(trainer_spec.max_sentence_length(), 10, 1073741824);
+  CHECK_RANGE(trainer_spec.em_convergence_threshold(), 0.0, 1.0);
+  CHECK_RANGE(trainer_spec.min_shrinking_factor(), 0.1, 0.95);
 #undef CHECK_RANGE
 
+  if (trainer_spec.adaptive_shrinking()) {
+    CHECK_LE_OR_RETURN(trainer_spec.min_shrinking_factor(),
+                       trainer_spec.shrinking_factor())
+        << "--min_shrinking_factor must not exceed --shrinking_factor.";
+  }
+
+  for (const int size : trainer_spec.snapshot_vocab_sizes()) {
+    CHECK_EQ_OR_RETURN(TrainerSpec::UNIGRAM, trainer_spec.model_type())
+        << "--snapshot_vocab_sizes is only supported in UNIGRAM mode.";
+    CHECK_GT_OR_RETURN(size, trainer_spec.vocab_size())
+        << "--snapshot_vocab_sizes must be larger than --vocab_size.";
+  }
+
+  CHECK_GE_OR_RETURN(trainer_spec.checkpoint_interval(), 0);
+  if (trainer_spec.checkpoint_interval() > 0 ||
+      trainer_spec.resume_from_checkpoint()) {
+    CHECK_EQ_OR_RETURN(TrainerSpec::UNIGRAM, trainer_spec.model_type())
+        << "Checkpoints are only supported in UNIGRAM mode.";
+  }
+
+  if (!trainer_spec.training_stats_file().empty()) {
+    CHECK_EQ_OR_RETURN(TrainerSpec::UNIGRAM, trainer_spec.model_type())
+        << "--training_stats_file is only supported in UNIGRAM mode.";
+  }
+
   CHECK_OR_RETURN(trainer_spec.input_sentence_size() <= 0 ||
                   trainer_spec.input_sentence_size() > 100);
 
@@ -86,6 +115,37 @@ util::Status VerifySpec(const TrainerSpec &trainer_spec) {
   return util::OkStatus();
 }
 
+// Returns |trainer_spec| without the fields which are not used to load and
+// preprocess the corpus. Trainers can share a corpus when these are equal.
+TrainerSpec GetCorpusSpec(const TrainerSpec &trainer_spec) {
+  TrainerSpec spec = trainer_spec;
+  spec.clear_model_prefix();
+  spec.clear_model_type();
+  spec.clear_vocab_size();
+  spec.clear_num_threads();
+  spec.clear_seed_sentencepiece_size();
+  spec.clear_shrinking_factor();
+  spec.clear_num_sub_iterations();
+  spec.clear_em_convergence_threshold();
+  spec.clear_adaptive_shrinking();
+  spec.clear_min_shrinking_factor();
+  spec.clear_snapshot_vocab_sizes();
+  spec.clear_checkpoint_interval();
+  spec.clear_save_corpus_cache();
+  spec.clear_resume_from_checkpoint();
+  spec.clear_training_stats_file();
+  spec.clear_joint_seed_sentencepieces();
+  spec.clear_max_sentencepiece_length();
+  spec.clear_split_by_unicode_script();
+  spec.clear_split_by_number();
+  spec.clear_split_by_whitespace();
+  spec.clear_split_digits();
+  spec.clear_hard_vocab_limit();
+  spec.clear_vocabulary_output_piece_score();
+  spec.clear_train_extremely_large_corpus();
+  return spec;
+}
+
 class SentenceSelector {
  public:
   using Sampler = random::ReservoirSampler<TrainerInterface::Sentence>;
@@ -290,7 +350,14 @@ bool TrainerInterface::IsValidSentencePiece(
 
 util::Status TrainerInterface::LoadSentences() {
   RETURN_IF_ERROR(status());
-  CHECK_OR_RETURN(sentences_.empty());
+
+  if (corpus_shared_) {
+    LOG(INFO) << "Using " << sentences_->size()
+              << " sentences of the shared corpus.";
+    return VerifyVocabSize();
+  }
+
+  CHECK_OR_RETURN(sentences_->empty());
   CHECK_OR_RETURN(required_chars_.empty());
   CHECK_OR_RETURN(trainer_spec_.input_format().empty() ||
                   trainer_spec_.input_format() == "text" ||
@@ -310,7 +377,8 @@ util::Status TrainerInterface::LoadSentences() {
 
   const bool is_tsv = trainer_spec_.input_format() == "tsv";
 
-  SentenceSelector selector(&sentences_, trainer_spec_);
+  Sentences sentences;
+  SentenceSelector selector(&sentences, trainer_spec_);
   random::ReservoirSampler<std::string> test_sentence_sampler(
       &self_test_samples_, trainer_spec_.self_test_sample_size());
 
@@ -373,10 +441,10 @@ END:
   // Emits error message if any.
   selector.Finish();
 
-  if (sentences_.size() == selector.total_size()) {
-    LOG(INFO) << "Loaded all " << sentences_.size() << " sentences";
+  if (sentences.size() == selector.total_size()) {
+    LOG(INFO) << "Loaded all " << sentences.size() << " sentences";
   } else {
-    LOG(INFO) << "Sampled " << sentences_.size() << " sentences from "
+    LOG(INFO) << "Sampled " << sentences.size() << " sentences from "
               << selector.total_size() << " sentences.";
   }
   if (too_long_lines > 0)
@@ -395,15 +463,15 @@ END:
     const normalizer::PrefixMatcher meta_pieces_matcher(meta_pieces_set);
 
     LOG(INFO) << "Normalizing sentences...";
-    CHECK_OR_RETURN(!sentences_.empty());
+    CHECK_OR_RETURN(!sentences.empty());
     {
       auto pool = absl::make_unique<ThreadPool>(trainer_spec_.num_threads());
       pool->StartWorkers();
       for (int n = 0; n < trainer_spec_.num_threads(); ++n) {
         pool->Schedule([&, n]() {
-          for (size_t i = n; i < sentences_.size();
+          for (size_t i = n; i < sentences.size();
                i += trainer_spec_.num_threads()) {
-            auto *s = &sentences_[i].first;
+            auto *s = &sentences[i].first;
             *s = meta_pieces_matcher.GlobalReplace(normalizer.Normalize(*s),
                                                    kUPPBoundaryStr);
           }
@@ -411,13 +479,13 @@ END:
       }
     }
 
-    for (size_t i = 0; i < sentences_.size(); ++i) {
-      auto *s = &sentences_[i].first;
+    for (size_t i = 0; i < sentences.size(); ++i) {
+      auto *s = &sentences[i].first;
       CHECK_OR_RETURN(s->find(" ") == std::string::npos)
           << "Normalized string must not include spaces";
       if (s->empty()) {
-        std::swap(sentences_[i], sentences_[sentences_.size() - 1]);
-        sentences_.resize(sentences_.size() - 1);
+        std::swap(sentences[i], sentences[sentences.size() - 1]);
+        sentences.resize(sentences.size() - 1);
       }
     }
   }
@@ -436,7 +504,7 @@ END:
     }
     chars_count[c].first = true;  // is_required_character.
   }
-  for (const auto &w : sentences_) {
+  for (const auto &w : sentences) {
     for (const char32 c : string_util::UTF8ToUnicodeText(w.first)) {
       if (!string_util::IsValidCodepoint(c)) continue;
       if (c == 0x0000) {
@@ -484,7 +552,7 @@ END:
 
   // Replaces rare characters (characters not included in required_chars_)
   // with kUNKChar.
-  for (auto &w : sentences_) {
+  for (auto &w : sentences) {
     string_util::UnicodeText uw2;
     for (const char32 c : string_util::UTF8ToUnicodeText(w.first)) {
       if (port::ContainsKey(required_chars_, c)) {
@@ -496,6 +564,15 @@ END:
     w.first = string_util::UnicodeTextToUTF8(uw2);
   }
 
+  sentences_ = std::make_shared<Sentences>(std::move(sentences));
+  RETURN_IF_ERROR(VerifyVocabSize());
+
+  LOG(INFO) << "Done! preprocessed " << sentences_->size() << " sentences.";
+
+  return util::OkStatus();
+}
+
+util::Status TrainerInterface::VerifyVocabSize() const {
   // +3 for meta pieces.
   if (trainer_spec_.model_type() != TrainerSpec::WORD &&
       trainer_spec_.model_type() != TrainerSpec::CHAR) {
@@ -508,27 +585,145 @@ END:
         << "Increase vocab_size or decrease character_coverage with "
         << "--character_coverage option.";
   }
+  return util::OkStatus();
+}
 
-  LOG(INFO) << "Done! preprocessed " << sentences_.size() << " sentences.";
+util::Status TrainerInterface::ShareCorpus(const TrainerInterface &other) {
+  RETURN_IF_ERROR(status());
+  RETURN_IF_ERROR(other.status());
+  CHECK_OR_RETURN(sentences_->empty());
+  CHECK_OR_RETURN(required_chars_.empty());
+  CHECK_OR_RETURN(!other.sentences_->empty()) << "The corpus is not loaded.";
+  CHECK_OR_RETURN(GetCorpusSpec(trainer_spec_).SerializeAsString() ==
+                  GetCorpusSpec(other.trainer_spec_).SerializeAsString())
+      << "The corpus must be loaded with the same trainer_spec.";
+  CHECK_OR_RETURN(normalizer_spec_.SerializeAsString() ==
+                  other.normalizer_spec_.SerializeAsString())
+      << "The corpus must be loaded with the same normalizer_spec.";
+
+  sentences_ = other.sentences_;
+  required_chars_ = other.required_chars_;
+  self_test_samples_ = other.self_test_samples_;
+  corpus_shared_ = true;
 
   return util::OkStatus();
 }
 
 void TrainerInterface::SplitSentencesByWhitespace() {
   LOG(INFO) << "Tokenizing input sentences with whitespace: "
-            << sentences_.size();
+            << sentences_->size();
   absl::flat_hash_map<std::string, int64> tokens;
-  for (const auto &s : sentences_) {
+  for (const auto &s : *sentences_) {
     for (const auto &w :
          SplitIntoWords(s.first, trainer_spec_.treat_whitespace_as_suffix())) {
       tokens[std::string(w)] += s.second;
     }
   }
-  sentences_ = Sorted(tokens);
-  LOG(INFO) << "Done! " << sentences_.size();
+  sentences_ = std::make_shared<Sentences>(Sorted(tokens));
+  LOG(INFO) << "Done! " << sentences_->size();
+}
+
+std::string TrainerInterface::GetResumeKey() const {
+  TrainerSpec spec = trainer_spec_;
+  spec.clear_model_prefix();
+  spec.clear_num_threads();
+  spec.clear_checkpoint_interval();
+  spec.clear_save_corpus_cache();
+  spec.clear_resume_from_checkpoint();
+  spec.clear_training_stats_file();
+  return string_util::EncodeString(spec.SerializeAsString()) +
+         string_util::EncodeString(normalizer_spec_.SerializeAsString()) +
+         string_util::EncodeString(denormalizer_spec_.SerializeAsString());
+}
+
+util::Status TrainerInterface::SaveCorpusCache(
+    absl::string_view filename) const {
+  LOG(INFO) << "Saving corpus cache: " << filename;
+  std::string data = string_util::EncodeString(kCorpusCacheMagic);
+  data += string_util::EncodeString(GetResumeKey());
+  data += string_util::EncodePOD<uint32>(sentences_->size());
+  for (const auto &w : *sentences_) {
+    data += string_util::EncodeString(w.first);
+    data += string_util::EncodePOD<int64>(w.second);
+  }
+  data += string_util::EncodePOD<uint32>(required_chars_.size());
+  for (const auto &c : required_chars_) {
+    data += string_util::EncodePOD<char32>(c.first);
+    data += string_util::EncodePOD<int64>(c.second);
+  }
+  data += string_util::EncodePOD<uint32>(self_test_samples_.size());
+  for (const auto &s : self_test_samples_) {
+    data += string_util::EncodeString(s);
+  }
+  return filesystem::WriteFileAtomically(filename, data);
+}
+
+util::Status TrainerInterface::LoadCorpusCache(absl::string_view filename) {
+  RETURN_IF_ERROR(status());
+  CHECK_OR_RETURN(sentences_->empty());
+  CHECK_OR_RETURN(required_chars_.empty());
+
+  LOG(INFO) << "Loading corpus cache: " << filename;
+  std::string data;
+  {
+    auto input = filesystem::NewReadableFile(filename, true);
+    RETURN_IF_ERROR(input->status());
+    CHECK_OR_RETURN(input->ReadAll(&data));
+  }
+
+  absl::string_view input(data);
+  std::string magic;
+  CHECK_OR_RETURN(string_util::ConsumeString(&input, &magic) &&
+                  magic == kCorpusCacheMagic)
+      << filename << " is not a corpus cache.";
+
+#define CONSUME_OR_RETURN(expr) \
+  CHECK_OR_RETURN(expr) << filename << " is broken."
+
+  // The cache holds the sentences after the trainer's own preprocessing,
+  // e.g., split_by_whitespace, so all the specs must be unchanged.
+  std::string key;
+  CONSUME_OR_RETURN(string_util::ConsumeString(&input, &key));
+  CHECK_OR_RETURN(key == GetResumeKey())
+      << filename << " was made with a different trainer_spec or "
+      << "normalizer_spec.";
+
+  uint32 size = 0;
+  CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &size));
+  Sentences sentences(size);
+  for (auto &w : sentences) {
+    CONSUME_OR_RETURN(string_util::ConsumeString(&input, &w.first));
+    CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &w.second));
+  }
+  CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &size));
+  for (uint32 i = 0; i < size; ++i) {
+    char32 c = 0;
+    int64 freq = 0;
+    CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &c));
+    CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &freq));
+    required_chars_.emplace(c, freq);
+  }
+  CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &size));
+  self_test_samples_.resize(size);
+  for (auto &s : self_test_samples_) {
+    CONSUME_OR_RETURN(string_util::ConsumeString(&input, &s));
+  }
+  CONSUME_OR_RETURN(input.empty());
+#undef CONSUME_OR_RETURN
+
+  sentences_ = std::make_shared<Sentences>(std::move(sentences));
+  LOG(INFO) << "Loaded " << sentences_->size() << " sentences from the cache.";
+  return VerifyVocabSize();
 }
 
 util::Status TrainerInterface::Serialize(ModelProto *model_proto) const {
+  return Serialize(trainer_spec_, final_pieces_, model_proto);
+}
+
+util::Status TrainerInterface::Serialize(
+    const TrainerSpec &trainer_spec,
+    const std::vector<std::pair<std::string, float>> &pieces,
+    ModelProto *model_proto) const {
   RETURN_IF_ERROR(status());
 
   // Duplicated sentencepiece is not allowed.
@@ -542,7 +737,7 @@ util::Status TrainerInterface::Serialize(ModelProto *model_proto) const {
   CHECK_OR_RETURN(dup.insert(piece).second) << piece << " is already defined";
 
   size_t fid = 0;
-  for (int id = 0; id < trainer_spec_.vocab_size(); ++id) {
+  for (int id = 0; id < trainer_spec.vocab_size(); ++id) {
     const auto it = meta_pieces_.find(id);
     if (it != meta_pieces_.end()) {
       auto *sp = model_proto->add_pieces();
@@ -552,8 +747,8 @@ util::Status TrainerInterface::Serialize(ModelProto *model_proto) const {
       CHECK_EQ_OR_RETURN(model_proto->pieces_size() - 1, it->first);
       CHECK_NE_OR_RETURN(ModelProto::SentencePiece::NORMAL, sp->type());
       CHECK_PIECE(sp->piece());
-    } else if (fid < final_pieces_.size()) {
-      const auto &w = final_pieces_[fid++];
+    } else if (fid < pieces.size()) {
+      const auto &w = pieces[fid++];
       auto *sp = model_proto->add_pieces();
       sp->set_piece(w.first);
       sp->set_score(w.second);
@@ -561,28 +756,28 @@ util::Status TrainerInterface::Serialize(ModelProto *model_proto) const {
     }
   }
 
-  CHECK_EQ_OR_RETURN(fid, final_pieces_.size());
+  CHECK_EQ_OR_RETURN(fid, pieces.size());
 
-  *(model_proto->mutable_trainer_spec()) = trainer_spec_;
+  *(model_proto->mutable_trainer_spec()) = trainer_spec;
   *(model_proto->mutable_normalizer_spec()) = normalizer_spec_;
 
   if (!denormalizer_spec_.normalization_rule_tsv().empty()) {
     *(model_proto->mutable_denormalizer_spec()) = denormalizer_spec_;
   }
 
-  if (!trainer_spec_.hard_vocab_limit() ||
-      trainer_spec_.model_type() == TrainerSpec::CHAR) {
-    CHECK_GE_OR_RETURN(trainer_spec_.vocab_size(), model_proto->pieces_size());
-    CHECK_GE_OR_RETURN(trainer_spec_.vocab_size(),
+  if (!trainer_spec.hard_vocab_limit() ||
+      trainer_spec.model_type() == TrainerSpec::CHAR) {
+    CHECK_GE_OR_RETURN(trainer_spec.vocab_size(), model_proto->pieces_size());
+    CHECK_GE_OR_RETURN(trainer_spec.vocab_size(),
                        static_cast<int32>(dup.size()));
     model_proto->mutable_trainer_spec()->set_vocab_size(
         model_proto->pieces_size());
   } else {
-    CHECK_EQ_OR_RETURN(trainer_spec_.vocab_size(), model_proto->pieces_size())
+    CHECK_EQ_OR_RETURN(trainer_spec.vocab_size(), model_proto->pieces_size())
         << absl::StrFormat(
                "Vocabulary size too high (%d). Please set it to a value <= %d.",
-               trainer_spec_.vocab_size(), model_proto->pieces_size());
-    CHECK_EQ_OR_RETURN(trainer_spec_.vocab_size(),
+               trainer_spec.vocab_size(), model_proto->pieces_size());
+    CHECK_EQ_OR_RETURN(trainer_spec.vocab_size(),
                        static_cast<int32>(dup.size()));
   }
 
@@ -602,25 +797,22 @@ util::Status TrainerInterface::Serialize(ModelProto *model_proto) const {
   return util::OkStatus();
 }
 
-util::Status TrainerInterface::SaveModel(absl::string_view filename) const {
+util::Status TrainerInterface::SaveModel(const ModelProto &model_proto,
+                                         absl::string_view filename) const {
   LOG(INFO) << "Saving model: " << filename;
-  ModelProto model_proto;
-  RETURN_IF_ERROR(Serialize(&model_proto));
-
   auto output = filesystem::NewWritableFile(filename.data(), true);
   RETURN_IF_ERROR(output->status());
   output->Write(model_proto.SerializeAsString());
   return util::OkStatus();
 }
 
-util::Status TrainerInterface::SaveVocab(absl::string_view filename) const {
+util::Status TrainerInterface::SaveVocab(const ModelProto &model_proto,
+                                         absl::string_view filename) const {
   LOG(INFO) << "Saving vocabs: " << filename;
-  ModelProto model_proto;
-  RETURN_IF_ERROR(Serialize(&model_proto));
   auto output = filesystem::NewWritableFile(filename);
   RETURN_IF_ERROR(output->status());
 
-  if (trainer_spec_.vocabulary_output_piece_score()) {
+  if (model_proto.trainer_spec().vocabulary_output_piece_score()) {
     for (const auto &piece : model_proto.pieces()) {
       std::ostringstream os;
       os << piece.piece() << "\t" << piece.score();
@@ -639,12 +831,29 @@ util::Status TrainerInterface::Save() const {
   if (output_model_proto_) {
     RETURN_IF_ERROR(Serialize(output_model_proto_));
   } else {
-    RETURN_IF_ERROR(SaveModel(trainer_spec_.model_prefix() + ".model"));
-    RETURN_IF_ERROR(SaveVocab(trainer_spec_.model_prefix() + ".vocab"));
+    ModelProto model_proto;
+    RETURN_IF_ERROR(Serialize(&model_proto));
+    RETURN_IF_ERROR(
+        SaveModel(model_proto, trainer_spec_.model_prefix() + ".model"));
+    RETURN_IF_ERROR(
+        SaveVocab(model_proto, trainer_spec_.model_prefix() + ".vocab"));
   }
   return util::OkStatus();
 }
 
+util::Status TrainerInterface::SaveSnapshot(
+    const TrainerSpec &trainer_spec,
+    const std::vector<std::pair<std::string, float>> &pieces) const {
+  CHECK_OR_RETURN(!trainer_spec.model_prefix().empty());
+  ModelProto model_proto;
+  RETURN_IF_ERROR(Serialize(trainer_spec, pieces, &model_proto));
+  RETURN_IF_ERROR(
+      SaveModel(model_proto, trainer_spec.model_prefix() + ".model"));
+  RETURN_IF_ERROR(
+      SaveVocab(model_proto, trainer_spec.model_prefix() + ".vocab"));
+  return util::OkStatus();
+}
+
 util::Status TrainerInterface::InitMetaPieces() {
   CHECK_OR_RETURN(meta_pieces_.empty());
   bool has_unk = false;
@@ -117,6 +117,24 @@ class TrainerInterface {
   // It loads at most input_sentence_size sentences.
   util::Status LoadSentences();
 
+  // Takes over the sentences and required characters already loaded by
+  // |other|, so that LoadSentences() does not read, normalize and count
+  // the corpus again. The specs of both trainers may only differ in the
+  // fields which do not affect the loading, e.g., model_type or vocab_size.
+  util::Status ShareCorpus(const TrainerInterface &other);
+
+  // Returns trainer_spec_, normalizer_spec_ and denormalizer_spec_
+  // serialized without the fields which do not change the trained model,
+  // e.g., model_prefix or num_threads. A corpus cache or a checkpoint is
+  // restored only when this is unchanged.
+  std::string GetResumeKey() const;
+
+  // Saves the preprocessed corpus, i.e., sentences_, required_chars_ and the
+  // self-testing samples, to |filename|. LoadCorpusCache() restores it
+  // without reading and normalizing the input again.
+  util::Status SaveCorpusCache(absl::string_view filename) const;
+  util::Status LoadCorpusCache(absl::string_view filename);
+
   // Splits all sentencecs by whitespaces and
   // replace the |sentences_| with tokenized string.
   // e.g.,
@@ -127,6 +145,13 @@ class TrainerInterface {
   // Save model files into spec.model_prefix().
   util::Status Save() const;
 
+  // Saves |pieces| as a model trained with |trainer_spec| into
+  // trainer_spec.model_prefix(). final_pieces_ and trainer_spec_ are left
+  // untouched, so this can run concurrently with the training loop.
+  util::Status SaveSnapshot(
+      const TrainerSpec &trainer_spec,
+      const std::vector<std::pair<std::string, float>> &pieces) const;
+
   // Set of characters which must be included in the final vocab.
   // The value of this map stores the frequency.
   absl::flat_hash_map<char32, int64> required_chars_;
@@ -134,8 +159,9 @@ class TrainerInterface {
   // Final output pieces
   std::vector<std::pair<std::string, float>> final_pieces_;
 
-  // All sentences.
-  Sentences sentences_;
+  // All sentences. Shared by the trainers of ShareCorpus() without copying,
+  // so they are replaced as a whole instead of being modified in place.
+  std::shared_ptr<const Sentences> sentences_ = std::make_shared<Sentences>();
 
   // Trainer spec.
   TrainerSpec trainer_spec_;
@@ -164,20 +190,34 @@ class TrainerInterface {
   // Serialize final_pieces_ to |model_proto|.
   util::Status Serialize(ModelProto *model_proto) const;
 
+  // Serialize |pieces| to |model_proto| with |trainer_spec|.
+  util::Status Serialize(
+      const TrainerSpec &trainer_spec,
+      const std::vector<std::pair<std::string, float>> &pieces,
+      ModelProto *model_proto) const;
+
   // Saves the best sentence split with the current model for debugging.
   util::Status SaveSplits(absl::string_view filename) const;
 
-  // Saves model file.
-  util::Status SaveModel(absl::string_view filename) const;
+  // Saves |model_proto| to model file.
+  util::Status SaveModel(const ModelProto &model_proto,
+                         absl::string_view filename) const;
 
-  // Saves vocabulary file for NMT.
-  util::Status SaveVocab(absl::string_view filename) const;
+  // Saves vocabulary file of |model_proto| for NMT.
+  util::Status SaveVocab(const ModelProto &model_proto,
+                         absl::string_view filename) const;
 
   // Initializes `meta_pieces_` from TrainerSpec.
   util::Status InitMetaPieces();
 
+  // Checks that the vocab size can hold required_chars_ and meta pieces.
+  util::Status VerifyVocabSize() const;
+
   // Randomly sampled raw sentences for self-testing.
   std::vector<std::string> self_test_samples_;
+
+  // True when the corpus is shared by ShareCorpus().
+  bool corpus_shared_ = false;
 };
 }  // namespace sentencepiece
 #endif  // TRAINER_INTERFACE_H_
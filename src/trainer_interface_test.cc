@@ -504,6 +504,37 @@ TEST(TrainerInterfaceTest, CharactersTest) {
   }
 }
 
+TEST(TrainerInterfaceTest, ShareCorpusTest) {
+  const std::string input_file =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "share_corpus_input");
+  {
+    auto output = filesystem::NewWritableFile(input_file);
+    output->WriteLine("hello world");
+    output->WriteLine("hello there");
+  }
+  TrainerSpec trainer_spec;
+  NormalizerSpec normalizer_spec;
+  NormalizerSpec denormalizer_spec;
+  trainer_spec.add_input(input_file);
+  trainer_spec.set_model_prefix("model");
+
+  TrainerInterface loader(trainer_spec, normalizer_spec, denormalizer_spec);
+  EXPECT_OK(loader.LoadSentences());
+  TrainerInterface trainer(trainer_spec, normalizer_spec, denormalizer_spec);
+  EXPECT_OK(trainer.ShareCorpus(loader));
+  EXPECT_OK(trainer.LoadSentences());
+
+  // The sentences are not copied.
+  EXPECT_EQ(loader.sentences_.get(), trainer.sentences_.get());
+  EXPECT_EQ(loader.required_chars_, trainer.required_chars_);
+
+  // Splitting the sentences does not change the shared ones.
+  const auto sentences = *loader.sentences_;
+  trainer.SplitSentencesByWhitespace();
+  EXPECT_EQ(sentences, *loader.sentences_);
+  EXPECT_NE(sentences, *trainer.sentences_);
+}
+
 TEST(TrainerInterfaceTest, MultiFileSentenceIteratorTest) {
   std::vector<std::string> files;
   std::vector<std::string> expected;
@@ -0,0 +1,342 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "trie_layout.h"
+
+#include <algorithm>
+#include <queue>
+
+#include "util.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace sentencepiece {
+namespace trie_layout {
+namespace {
+
+// The unit format of Darts-clone. See DoubleArrayUnit and
+// DoubleArrayBuilderUnit in darts.h.
+inline bool HasLeaf(uint32 unit) { return ((unit >> 8) & 1) == 1; }
+inline uint32 Value(uint32 unit) { return unit & ((1U << 31) - 1); }
+inline uint32 Label(uint32 unit) { return unit & ((1U << 31) | 0xFF); }
+
+inline bool IsValidOffset(uint32 offset) {
+  return offset < (1U << 21) || (offset < (1U << 29) && (offset & 0xFF) == 0);
+}
+
+inline uint32 EncodeOffset(uint32 offset) {
+  return offset < (1U << 21) ? (offset << 10) : ((offset << 2) | (1U << 9));
+}
+
+constexpr uint32 kBlockSize = 256;
+
+// The free units are searched only in the last blocks as Darts-clone does,
+// which bounds the time to place a node.
+constexpr uint32 kNumOpenBlocks = 16;
+
+constexpr uint32 kNone = static_cast<uint32>(-1);
+
+struct Node {
+  uint32 source = 0;  // position in the source array.
+  uint32 target = 0;  // position in the new array.
+  uint32 label = 0;
+  uint32 depth = 0;
+  bool has_leaf = false;
+  uint32 value = 0;
+  uint32 num_keys = 0;  // keys in the subtree.
+  uint64 weight = 0;
+  uint32 children_begin = 0;
+  uint32 children_end = 0;
+};
+
+// Enumerates the nodes of |units| in DFS order. The children of each node
+// are in |children| sorted by their labels.
+util::Status MakeNodes(const uint32 *units, size_t size,
+                       std::vector<Node> *nodes,
+                       std::vector<uint32> *children) {
+  nodes->clear();
+  children->clear();
+  nodes->emplace_back();
+  std::vector<uint32> stack = {0};
+  while (!stack.empty()) {
+    const uint32 n = stack.back();
+    stack.pop_back();
+    const uint32 unit = units[(*nodes)[n].source];
+    const uint32 base = (*nodes)[n].source ^ UnitOffset(unit);
+    CHECK_OR_RETURN(base < size) << "broken double array.";
+    if (HasLeaf(unit)) {
+      (*nodes)[n].has_leaf = true;
+      (*nodes)[n].value = Value(units[base]);
+    }
+    (*nodes)[n].children_begin = children->size();
+    for (uint32 c = 1; c < kBlockSize; ++c) {
+      const uint32 pos = base ^ c;
+      if (pos >= size || Label(units[pos]) != c) continue;
+      Node child;
+      child.source = pos;
+      child.label = c;
+      child.depth = (*nodes)[n].depth + 1;
+      children->push_back(nodes->size());
+      nodes->push_back(child);
+    }
+    (*nodes)[n].children_end = children->size();
+    for (uint32 i = (*nodes)[n].children_end; i > (*nodes)[n].children_begin;
+         --i) {
+      stack.push_back((*children)[i - 1]);
+    }
+  }
+
+  // Children always come after their parent.
+  for (size_t n = nodes->size(); n > 0; --n) {
+    auto &node = (*nodes)[n - 1];
+    node.num_keys = node.has_leaf ? 1 : 0;
+    for (uint32 i = node.children_begin; i < node.children_end; ++i) {
+      node.num_keys += (*nodes)[(*children)[i]].num_keys;
+    }
+  }
+
+  return util::OkStatus();
+}
+
+// Allocates the units of the new array block by block.
+class Allocator {
+ public:
+  Allocator() { Grow(); }
+
+  // Returns the base of the units of |labels| (sorted) whose parent is at
+  // |parent|. All the units are free, the base is not used by any other
+  // node, and the offset from the parent can be encoded.
+  uint32 FindBase(uint32 parent, const std::vector<uint32> &labels) {
+    for (uint32 pos = head_; pos != kNone; pos = next_[pos]) {
+      const uint32 base = pos ^ labels[0];
+      if (IsAvailable(parent, base, labels)) return base;
+    }
+
+    // Uses a new block, where the lower bits of the base are the same as the
+    // ones of the parent so that the offset can be encoded.
+    const uint32 begin = Grow();
+    return begin | (parent & (kBlockSize - 1));
+  }
+
+  void Use(uint32 pos) {
+    used_[pos] = true;
+    if (!open_[pos / kBlockSize]) return;
+    if (prev_[pos] != kNone) next_[prev_[pos]] = next_[pos];
+    if (next_[pos] != kNone) prev_[next_[pos]] = prev_[pos];
+    if (head_ == pos) head_ = next_[pos];
+    if (tail_ == pos) tail_ = prev_[pos];
+  }
+
+  void UseBase(uint32 base) { used_base_[base] = true; }
+
+  bool used(uint32 pos) const { return used_[pos]; }
+
+  size_t size() const { return used_.size(); }
+
+ private:
+  bool IsAvailable(uint32 parent, uint32 base,
+                   const std::vector<uint32> &labels) const {
+    if (used_base_[base] || !IsValidOffset(parent ^ base)) return false;
+    for (const uint32 label : labels) {
+      if (used_[base ^ label]) return false;
+    }
+    return true;
+  }
+
+  // Appends a block and returns its first position.
+  uint32 Grow() {
+    const uint32 begin = used_.size();
+    const uint32 end = begin + kBlockSize;
+    used_.resize(end, false);
+    used_base_.resize(end, false);
+    next_.resize(end, kNone);
+    prev_.resize(end, kNone);
+    open_.push_back(true);
+    for (uint32 pos = begin; pos < end; ++pos) {
+      prev_[pos] = tail_;
+      if (tail_ != kNone) next_[tail_] = pos;
+      if (head_ == kNone) head_ = pos;
+      tail_ = pos;
+    }
+
+    // Closes the oldest block.
+    if (open_.size() > kNumOpenBlocks) {
+      const uint32 block = open_.size() - kNumOpenBlocks - 1;
+      while (head_ != kNone && head_ / kBlockSize <= block) {
+        head_ = next_[head_];
+      }
+      if (head_ != kNone) prev_[head_] = kNone;
+      open_[block] = false;
+    }
+
+    return begin;
+  }
+
+  std::vector<bool> used_;
+  std::vector<bool> used_base_;
+  std::vector<bool> open_;
+
+  // Doubly-linked list of the free units of the open blocks.
+  std::vector<uint32> next_;
+  std::vector<uint32> prev_;
+  uint32 head_ = kNone;
+  uint32 tail_ = kNone;
+};
+}  // namespace
+
+UnitArray::~UnitArray() { Clear(); }
+
+void UnitArray::Clear() {
+#ifdef __linux__
+  if (mapped_ != nullptr) munmap(mapped_, mapped_size_);
+#endif
+  mapped_ = nullptr;
+  mapped_size_ = 0;
+  buffer_.clear();
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void UnitArray::Resize(size_t size, bool use_huge_pages) {
+  Clear();
+  size_ = size;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (use_huge_pages && size > 0) {
+    // Maps one more huge page to align the start.
+    constexpr size_t kHugePageSize = 2 << 20;
+    const size_t bytes = (size * sizeof(uint32) + kHugePageSize - 1) /
+                         kHugePageSize * kHugePageSize;
+    void *ptr = mmap(nullptr, bytes + kHugePageSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr != MAP_FAILED) {
+      mapped_ = ptr;
+      mapped_size_ = bytes + kHugePageSize;
+      const uintptr_t aligned =
+          (reinterpret_cast<uintptr_t>(ptr) + kHugePageSize - 1) /
+          kHugePageSize * kHugePageSize;
+      data_ = reinterpret_cast<uint32 *>(aligned);
+      // Best effort. The memory is usable without huge pages.
+      madvise(data_, bytes, MADV_HUGEPAGE);
+      return;
+    }
+  }
+#endif
+
+  buffer_.assign(size, 0);
+  data_ = buffer_.data();
+}
+
+std::vector<uint32> CountVisits(const Darts::DoubleArray &trie,
+                                const std::vector<absl::string_view> &sample) {
+  const auto *units = static_cast<const uint32 *>(trie.array());
+  std::vector<uint32> visits(trie.size(), 0);
+  if (visits.empty()) return visits;
+
+  for (const auto text : sample) {
+    for (size_t begin = 0; begin < text.size();
+         begin += string_util::OneCharLen(text.data() + begin)) {
+      uint32 pos = 0;
+      ++visits[pos];
+      for (size_t i = begin; i < text.size(); ++i) {
+        const uint32 label = static_cast<unsigned char>(text[i]);
+        pos ^= UnitOffset(units[pos]) ^ label;
+        if (pos >= visits.size() || Label(units[pos]) != label) break;
+        ++visits[pos];
+      }
+    }
+  }
+
+  return visits;
+}
+
+util::Status Relayout(const Darts::DoubleArray &trie,
+                      const std::vector<uint32> &visits, bool use_huge_pages,
+                      UnitArray *units) {
+  CHECK_OR_RETURN(units);
+  CHECK_OR_RETURN(trie.array() != nullptr && trie.size() > 0)
+      << "the size of the double array is unknown.";
+  CHECK_OR_RETURN(visits.empty() || visits.size() == trie.size());
+
+  std::vector<Node> nodes;
+  std::vector<uint32> children;
+  RETURN_IF_ERROR(MakeNodes(static_cast<const uint32 *>(trie.array()),
+                            trie.size(), &nodes, &children));
+  for (auto &node : nodes) {
+    node.weight = visits.empty() ? 0 : visits[node.source];
+  }
+
+  // Places the children of the hotter nodes first.
+  auto is_colder = [&nodes](uint32 a, uint32 b) {
+    const auto &x = nodes[a];
+    const auto &y = nodes[b];
+    if (x.weight != y.weight) return x.weight < y.weight;
+    if (x.depth != y.depth) return x.depth > y.depth;
+    if (x.num_keys != y.num_keys) return x.num_keys < y.num_keys;
+    return a > b;
+  };
+  std::priority_queue<uint32, std::vector<uint32>, decltype(is_colder)> agenda(
+      is_colder);
+
+  Allocator allocator;
+  std::vector<uint32> output(allocator.size(), 0);
+  allocator.Use(0);
+  agenda.push(0);
+
+  std::vector<uint32> labels;
+  while (!agenda.empty()) {
+    auto &node = nodes[agenda.top()];
+    agenda.pop();
+
+    labels.clear();
+    if (node.has_leaf) labels.push_back(0);
+    for (uint32 i = node.children_begin; i < node.children_end; ++i) {
+      labels.push_back(nodes[children[i]].label);
+    }
+    if (labels.empty()) continue;
+
+    const uint32 base = allocator.FindBase(node.target, labels);
+    output.resize(allocator.size(), 0);
+    allocator.UseBase(base);
+    output[node.target] |= EncodeOffset(node.target ^ base);
+
+    if (node.has_leaf) {
+      output[node.target] |= 1U << 8;
+      output[base] = node.value | (1U << 31);
+      allocator.Use(base);
+    }
+
+    for (uint32 i = node.children_begin; i < node.children_end; ++i) {
+      auto &child = nodes[children[i]];
+      child.target = base ^ child.label;
+      output[child.target] |= child.label;
+      allocator.Use(child.target);
+      agenda.push(children[i]);
+    }
+  }
+
+  // The free units must not match any label. A label never has the highest
+  // bit, which is reserved for the values.
+  for (uint32 pos = 0; pos < output.size(); ++pos) {
+    if (!allocator.used(pos)) output[pos] = 1U << 31;
+  }
+
+  units->Resize(output.size(), use_huge_pages);
+  std::copy(output.begin(), output.end(), units->data());
+
+  return util::OkStatus();
+}
+
+}  // namespace trie_layout
+}  // namespace sentencepiece
@@ -0,0 +1,103 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#ifndef TRIE_LAYOUT_H_
+#define TRIE_LAYOUT_H_
+
+#include <vector>
+
+#include "common.h"
+#include "sentencepiece_processor.h"
+#include "third_party/absl/strings/string_view.h"
+#include "third_party/darts_clone/darts.h"
+
+// Rebuilds a Darts-clone double array in a cache friendly layout.
+//
+// Darts-clone places the units in the order of the construction, so that
+// the transitions of the common prefixes are scattered over the array.
+// Relayout() makes a new array with the same keys and values in the unit
+// format of Darts-clone, where the children of the hot nodes are allocated
+// first, i.e., they are packed at the beginning of the array. The hot nodes
+// are the ones visited often by a sample text, and then the shallow nodes.
+//
+// The new array is used by DoubleArray::set_array(). traverse(),
+// commonPrefixSearch() and exactMatchSearch() return the same values and
+// lengths as the original array, though the node positions differ.
+
+namespace sentencepiece {
+namespace trie_layout {
+
+// Returns the offset from |unit| to its children. See DoubleArrayUnit in
+// darts.h.
+inline uint32 UnitOffset(uint32 unit) {
+  return (unit >> 10) << ((unit & (1U << 9)) >> 6);
+}
+
+// Prefetches the unit which |trie|.traverse() reads when it moves from
+// |node_pos| by |label|.
+inline void PrefetchChild(const Darts::DoubleArray &trie, size_t node_pos,
+                          unsigned char label) {
+#if defined(__GNUC__)
+  const auto *units = static_cast<const uint32 *>(trie.array());
+  __builtin_prefetch(units + (node_pos ^ UnitOffset(units[node_pos]) ^ label));
+#endif
+}
+
+// Memory holding the units of a double array. On Linux, it can be backed by
+// transparent huge pages.
+class UnitArray {
+ public:
+  UnitArray() {}
+  ~UnitArray();
+
+  // Allocates |size| zero-filled units. When |use_huge_pages| is true, the
+  // memory is aligned to and advised for huge pages if possible.
+  void Resize(size_t size, bool use_huge_pages);
+
+  uint32 *data() { return data_; }
+  const uint32 *data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Returns true if the memory is advised for huge pages.
+  bool huge_pages() const { return mapped_ != nullptr; }
+
+ private:
+  void Clear();
+
+  uint32 *data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<uint32> buffer_;
+
+  // The region allocated by mmap.
+  void *mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+
+  UnitArray(const UnitArray &) = delete;
+  UnitArray &operator=(const UnitArray &) = delete;
+};
+
+// Returns the number of the visits to each unit of |trie| by the common
+// prefix searches from the character boundaries of |sample|.
+// |trie| must know its size, i.e., it is built or set with the size.
+std::vector<uint32> CountVisits(const Darts::DoubleArray &trie,
+                                const std::vector<absl::string_view> &sample);
+
+// Rebuilds |trie| into |units|. |visits| is the output of CountVisits() and
+// can be empty, in which case the shallow nodes and the nodes with more keys
+// are hot.
+util::Status Relayout(const Darts::DoubleArray &trie,
+                      const std::vector<uint32> &visits, bool use_huge_pages,
+                      UnitArray *units);
+
+}  // namespace trie_layout
+}  // namespace sentencepiece
+#endif  // TRIE_LAYOUT_H_
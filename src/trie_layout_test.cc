@@ -0,0 +1,168 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "trie_layout.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "sentencepiece_processor.h"
+#include "testharness.h"
+#include "third_party/absl/strings/str_split.h"
+#include "util.h"
+
+namespace sentencepiece {
+namespace trie_layout {
+namespace {
+
+void ExpectSameTrie(const Darts::DoubleArray &expected,
+                    const Darts::DoubleArray &actual,
+                    const std::vector<std::string> &keys,
+                    const std::vector<std::string> &lines) {
+  for (const auto &key : keys) {
+    int expected_value = 0, actual_value = 0;
+    expected.exactMatchSearch(key.data(), expected_value, key.size());
+    actual.exactMatchSearch(key.data(), actual_value, key.size());
+    EXPECT_EQ(expected_value, actual_value);
+
+    // Searches the prefixes which are not keys.
+    const std::string longer = key + "\x01";
+    expected.exactMatchSearch(longer.data(), expected_value, longer.size());
+    actual.exactMatchSearch(longer.data(), actual_value, longer.size());
+    EXPECT_EQ(expected_value, actual_value);
+  }
+
+  constexpr size_t kMaxResults = 256;
+  Darts::DoubleArray::result_pair_type expected_results[kMaxResults];
+  Darts::DoubleArray::result_pair_type actual_results[kMaxResults];
+  for (const auto &line : lines) {
+    for (size_t begin = 0; begin < line.size(); ++begin) {
+      const size_t expected_size = expected.commonPrefixSearch(
+          line.data() + begin, expected_results, kMaxResults,
+          line.size() - begin);
+      const size_t actual_size =
+          actual.commonPrefixSearch(line.data() + begin, actual_results,
+                                    kMaxResults, line.size() - begin);
+      ASSERT_EQ(expected_size, actual_size);
+      for (size_t i = 0; i < expected_size; ++i) {
+        EXPECT_EQ(expected_results[i].value, actual_results[i].value);
+        EXPECT_EQ(expected_results[i].length, actual_results[i].length);
+      }
+
+      // traverse() returns -1 or -2 at the same key positions.
+      size_t expected_node = 0, actual_node = 0;
+      for (size_t key_pos = begin; key_pos < line.size();) {
+        size_t expected_key_pos = key_pos, actual_key_pos = key_pos;
+        const int expected_value = expected.traverse(
+            line.data(), expected_node, expected_key_pos, key_pos + 1);
+        const int actual_value = actual.traverse(
+            line.data(), actual_node, actual_key_pos, key_pos + 1);
+        EXPECT_EQ(expected_value, actual_value);
+        EXPECT_EQ(expected_key_pos, actual_key_pos);
+        if (expected_value == -2) break;
+        key_pos = expected_key_pos;
+      }
+    }
+  }
+}
+}  // namespace
+
+TEST(TrieLayoutTest, RelayoutTest) {
+  const auto lines = test::ReadLines("botchan.txt", 1000);
+  std::set<std::string> key_set;
+  for (const auto &line : lines) {
+    for (const auto &word : absl::StrSplit(line, " ")) {
+      if (!word.empty()) key_set.insert(std::string(word));
+    }
+  }
+  const std::vector<std::string> keys(key_set.begin(), key_set.end());
+  std::vector<const char *> key_ptrs;
+  std::vector<int> values;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    key_ptrs.push_back(keys[i].c_str());
+    values.push_back(i);
+  }
+
+  Darts::DoubleArray trie;
+  ASSERT_EQ(0, trie.build(key_ptrs.size(), key_ptrs.data(), nullptr,
+                          values.data()));
+
+  const std::vector<absl::string_view> sample(lines.begin(),
+                                              lines.begin() + 100);
+  const auto visits = CountVisits(trie, sample);
+  ASSERT_EQ(trie.size(), visits.size());
+  EXPECT_LT(0, visits[0]);
+
+  for (const bool use_visits : {true, false}) {
+    for (const bool use_huge_pages : {false, true}) {
+      UnitArray units;
+      EXPECT_TRUE(Relayout(trie, use_visits ? visits : std::vector<uint32>(),
+                           use_huge_pages, &units)
+                      .ok());
+      EXPECT_EQ(0, units.size() % 256);
+      if (!use_huge_pages) EXPECT_FALSE(units.huge_pages());
+
+      Darts::DoubleArray relayout;
+      relayout.set_array(units.data(), units.size());
+      ExpectSameTrie(trie, relayout, keys, lines);
+
+      // Relayouts the relayouted array again.
+      UnitArray units2;
+      EXPECT_TRUE(Relayout(relayout, CountVisits(relayout, sample),
+                           use_huge_pages, &units2)
+                      .ok());
+      Darts::DoubleArray relayout2;
+      relayout2.set_array(units2.data(), units2.size());
+      ExpectSameTrie(trie, relayout2, keys, lines);
+    }
+  }
+
+  // The size must be known.
+  Darts::DoubleArray unknown_size;
+  unknown_size.set_array(trie.array());
+  UnitArray units;
+  EXPECT_FALSE(Relayout(unknown_size, {}, false, &units).ok());
+  EXPECT_TRUE(CountVisits(unknown_size, sample).empty());
+}
+
+TEST(TrieLayoutTest, OptimizeTrieLayoutTest) {
+  const std::string model =
+      test::TrainModel("botchan.txt", "trie_layout", "--vocab_size=1000");
+
+  SentencePieceProcessor sp;
+  EXPECT_FALSE(sp.OptimizeTrieLayout({"sample"}).ok());
+  ASSERT_TRUE(sp.Load(model).ok());
+
+  SentencePieceProcessor expected;
+  ASSERT_TRUE(expected.Load(model).ok());
+
+  auto lines = test::ReadLines("botchan.txt", 2000);
+  lines.push_back("ＡＢＣ　ｱｲｳ①");  // Normalized by NFKC.
+  const std::vector<absl::string_view> sample(lines.begin(),
+                                              lines.begin() + 200);
+
+  for (const bool use_huge_pages : {false, true, false}) {
+    ASSERT_TRUE(sp.OptimizeTrieLayout(sample, use_huge_pages).ok());
+    for (const auto &line : lines) {
+      EXPECT_EQ(expected.EncodeAsIds(line), sp.EncodeAsIds(line));
+      EXPECT_EQ(expected.EncodeAsPieces(line), sp.EncodeAsPieces(line));
+      EXPECT_EQ(expected.PieceToId(line), sp.PieceToId(line));
+    }
+  }
+
+  EXPECT_TRUE(sp.OptimizeTrieLayout({}).ok());
+  EXPECT_EQ(expected.EncodeAsIds(lines[0]), sp.EncodeAsIds(lines[0]));
+}
+
+}  // namespace trie_layout
+}  // namespace sentencepiece
@@ -21,6 +21,7 @@
 #include <utility>
 #include <vector>
 
+#include "metrics.h"
 #include "third_party/absl/memory/memory.h"
 #include "third_party/absl/strings/str_split.h"
 #include "third_party/absl/strings/string_view.h"
@@ -389,6 +390,7 @@ void Model::PopulateNodes(Lattice *lattice) const {
   std::vector<Darts::DoubleArray::result_pair_type> trie_results(
       trie_results_size_ + 1);
 
+  int64 num_lattice_nodes = 0;
   for (int begin_pos = 0; begin_pos < len; ++begin_pos) {
     const char *begin = lattice->surface(begin_pos);
 
@@ -407,6 +409,7 @@ void Model::PopulateNodes(Lattice *lattice) const {
       const int id = trie_results[k].value;
       if (IsUnusedInlined(id)) continue;
       Lattice::Node *node = lattice->Insert(begin_pos, length);
+      ++num_lattice_nodes;
       node->id = id;  // the value of Trie stores vocab_id.
       // User defined symbol receives extra bonus to always be selected.
       node->score = IsUserDefinedInlined(id) ? (length * max_score_ - 0.1)
@@ -418,10 +421,15 @@ void Model::PopulateNodes(Lattice *lattice) const {
 
     if (!has_single_node) {
       Lattice::Node *node = lattice->Insert(begin_pos, 1);
+      ++num_lattice_nodes;
       node->id = unk_id_;  // add UNK node.
       node->score = unk_score;
     }
   }
+
+  // One prefix search from each position.
+  SPM_METRICS_ADD(TRIE_LOOKUPS, len);
+  SPM_METRICS_ADD(LATTICE_NODES, num_lattice_nodes);
 }
 
 int Model::PieceToId(absl::string_view piece) const {
@@ -455,6 +463,7 @@ void Model::BuildTrie(std::vector<std::pair<absl::string_view, int>> *pieces) {
   }
 
   trie_ = absl::make_unique<Darts::DoubleArray>();
+  trie_units_.reset();
   if (trie_->build(key.size(), const_cast<char **>(&key[0]), nullptr,
                    &value[0]) != 0) {
     status_ = util::InternalError("cannot build double-array.");
@@ -500,9 +509,38 @@ Model::Model(const ModelProto &model_proto) {
 
 Model::~Model() {}
 
+void Model::InitializePieceTable() {
+  ModelInterface::InitializePieceTable();
+
+  // Most of the models have neither unused pieces nor user defined symbols,
+  // so that their encoder does not check the type of every matched piece.
+  has_unused_ = false;
+  has_user_defined_ = false;
+  for (size_t id = 0; id < piece_table_.size(); ++id) {
+    has_unused_ |= IsUnusedInlined(id);
+    has_user_defined_ |= IsUserDefinedInlined(id);
+  }
+  if (has_unused_) {
+    encode_optimized_ = has_user_defined_ ? &Model::EncodeOptimized<true, true>
+                                          : &Model::EncodeOptimized<true, false>;
+  } else {
+    encode_optimized_ = has_user_defined_
+                            ? &Model::EncodeOptimized<false, true>
+                            : &Model::EncodeOptimized<false, false>;
+  }
+}
+
+std::string Model::GetEncoderVariant() const {
+  if (encoder_version_ != EncoderVersion::kOptimized) return "original";
+  std::string variant = "optimized";
+  if (has_unused_) variant += "_unused";
+  if (has_user_defined_) variant += "_user_defined";
+  return variant;
+}
+
 EncodeResult Model::Encode(absl::string_view normalized) const {
   if (encoder_version_ == EncoderVersion::kOptimized) {
-    return EncodeOptimized(normalized);
+    return (this->*encode_optimized_)(normalized);
   }
 
   if (!status().ok() || normalized.empty()) {
@@ -597,6 +635,21 @@ bool Model::VerifyOutputsEquivalent(absl::string_view expected,
   return true;
 }
 
+util::Status Model::RelayoutTrie(
+    const std::vector<absl::string_view> &normalized_sample,
+    bool use_huge_pages) {
+  RETURN_IF_ERROR(status());
+  CHECK_OR_RETURN(trie_);
+  auto units = absl::make_unique<trie_layout::UnitArray>();
+  RETURN_IF_ERROR(trie_layout::Relayout(
+      *trie_, trie_layout::CountVisits(*trie_, normalized_sample),
+      use_huge_pages, units.get()));
+  trie_->set_array(units->data(), units->size());
+  trie_units_ = std::move(units);
+  return util::OkStatus();
+}
+
+template <bool kHasUnused, bool kHasUserDefined>
 EncodeResult Model::EncodeOptimized(absl::string_view normalized) const {
   // An optimized Viterbi algorithm for unigram language models. Benchmarking
   // results show that it generates almost identical outputs and achieves 2.1x
@@ -668,7 +721,10 @@ EncodeResult Model::EncodeOptimized(absl::string_view normalized) const {
   std::vector<BestPathNode> best_path_ends_at(size + 1);
   // Generate lattice on-the-fly (not stored) and update best_path_ends_at.
   int starts_at = 0;
+  int64 num_trie_lookups = 0;
+  int64 num_lattice_nodes = 0;
   while (starts_at < size) {
+    ++num_trie_lookups;
     std::size_t node_pos = 0;
     std::size_t key_pos = starts_at;
     const auto best_path_score_till_here =
@@ -682,12 +738,13 @@ EncodeResult Model::EncodeOptimized(absl::string_view normalized) const {
           trie_->traverse(normalized.data(), node_pos, key_pos, key_pos + 1);
       if (ret == -2) break;
       if (ret >= 0) {
-        if (IsUnusedInlined(ret)) continue;
+        if (kHasUnused && IsUnusedInlined(ret)) continue;
+        ++num_lattice_nodes;
         // Update the best path node.
         auto &target_node = best_path_ends_at[key_pos];
         const auto length = (key_pos - starts_at);
         // User defined symbol receives extra bonus to always be selected.
-        const auto score = IsUserDefinedInlined(ret)
+        const auto score = kHasUserDefined && IsUserDefinedInlined(ret)
                                ? (length * max_score_ - 0.1)
                                : GetScoreInlined(ret);
         const auto candidate_best_path_score =
@@ -704,6 +761,7 @@ EncodeResult Model::EncodeOptimized(absl::string_view normalized) const {
       }
     }
     if (!has_single_node) {
+      ++num_lattice_nodes;
       auto &target_node = best_path_ends_at[starts_at + mblen];
       const auto candidate_best_path_score =
           unk_score + best_path_score_till_here;
@@ -717,6 +775,9 @@ EncodeResult Model::EncodeOptimized(absl::string_view normalized) const {
     // Move by one unicode character.
     starts_at += mblen;
   }
+  SPM_METRICS_ADD(TRIE_LOOKUPS, num_trie_lookups);
+  SPM_METRICS_ADD(LATTICE_NODES, num_lattice_nodes);
+
   // Backtrack to identify the best path.
   EncodeResult results;
   int ends_at = size;
@@ -729,5 +790,154 @@ EncodeResult Model::EncodeOptimized(absl::string_view normalized) const {
   std::reverse(results.begin(), results.end());
   return results;
 }
+
+std::vector<EncodeResult> Model::EncodeBatch(
+    const std::vector<absl::string_view> &normalized) const {
+  // The interleaving only pays off when the trie does not fit in the cache.
+  // Otherwise, it just adds the bookkeeping and the branch mispredictions.
+  constexpr size_t kMinInterleavedTrieSize = 1 << 20;  // 4MB.
+  if (encoder_version_ == EncoderVersion::kOptimized && trie_ != nullptr &&
+      trie_->size() >= kMinInterleavedTrieSize) {
+    return EncodeInterleaved(normalized);
+  }
+  return ModelInterface::EncodeBatch(normalized);
+}
+
+std::vector<EncodeResult> Model::EncodeInterleaved(
+    const std::vector<absl::string_view> &normalized) const {
+  std::vector<EncodeResult> results(normalized.size());
+  if (!status().ok()) return results;
+
+  // The lattice is the same as EncodeOptimized(). Each lane encodes one
+  // sentence, and the lanes take one step of their traversals in turn.
+  struct BestPathNode {
+    int id = -1;
+    float best_path_score = 0;
+    int starts_at = -1;
+  };
+  struct Lane {
+    bool active = false;
+    size_t index = 0;  // The index of the sentence.
+    absl::string_view text;
+    std::vector<BestPathNode> best_path_ends_at;
+    // The traversal from |starts_at|.
+    int starts_at = 0;
+    int mblen = 0;
+    float best_path_score_till_here = 0;
+    bool has_single_node = false;
+    std::size_t node_pos = 0;
+    std::size_t key_pos = 0;
+  };
+
+  // More lanes overlap more misses, but also mispredict more branches.
+  constexpr size_t kMaxLanes = 4;
+  std::vector<Lane> lanes(std::min(kMaxLanes, normalized.size()));
+  const float unk_score = min_score() - kUnkPenalty;
+  int64 num_trie_lookups = 0;
+  int64 num_lattice_nodes = 0;
+
+  auto start_traversal = [&](Lane *lane) {
+    ++num_trie_lookups;
+    lane->node_pos = 0;
+    lane->key_pos = lane->starts_at;
+    lane->best_path_score_till_here =
+        lane->best_path_ends_at[lane->starts_at].best_path_score;
+    lane->has_single_node = false;
+    lane->mblen = std::min<int>(
+        string_util::OneCharLen(lane->text.data() + lane->starts_at),
+        lane->text.size() - lane->starts_at);
+    trie_layout::PrefetchChild(*trie_, 0, lane->text[lane->starts_at]);
+  };
+
+  // Takes the next sentence. The results of empty sentences are empty.
+  size_t next = 0;
+  auto start_sentence = [&](Lane *lane) {
+    while (next < normalized.size() && normalized[next].empty()) ++next;
+    lane->active = next < normalized.size();
+    if (!lane->active) return;
+    lane->index = next;
+    lane->text = normalized[next++];
+    lane->best_path_ends_at.assign(lane->text.size() + 1, BestPathNode());
+    lane->starts_at = 0;
+    start_traversal(lane);
+  };
+
+  auto update = [](BestPathNode *target_node, float score, int starts_at,
+                   int id) {
+    if (target_node->starts_at == -1 ||
+        score > target_node->best_path_score) {
+      target_node->best_path_score = score;
+      target_node->starts_at = starts_at;
+      target_node->id = id;
+    }
+  };
+
+  size_t num_active = 0;
+  for (auto &lane : lanes) {
+    start_sentence(&lane);
+    if (lane.active) ++num_active;
+  }
+
+  while (num_active > 0) {
+    for (auto &lane : lanes) {
+      if (!lane.active) continue;
+      const int size = lane.text.size();
+
+      int ret = -2;
+      if (lane.key_pos < size) {
+        ret = trie_->traverse(lane.text.data(), lane.node_pos, lane.key_pos,
+                              lane.key_pos + 1);
+      }
+      if (ret >= 0 && !IsUnusedInlined(ret)) {
+        ++num_lattice_nodes;
+        const auto length = lane.key_pos - lane.starts_at;
+        // User defined symbol receives extra bonus to always be selected.
+        const auto score = IsUserDefinedInlined(ret)
+                               ? (length * max_score_ - 0.1)
+                               : GetScoreInlined(ret);
+        update(&lane.best_path_ends_at[lane.key_pos],
+               score + lane.best_path_score_till_here, lane.starts_at, ret);
+        if (length == lane.mblen) lane.has_single_node = true;
+      }
+      if (ret != -2 && lane.key_pos < size) {
+        trie_layout::PrefetchChild(*trie_, lane.node_pos,
+                                   lane.text[lane.key_pos]);
+        continue;
+      }
+
+      // The traversal from |starts_at| is done.
+      if (!lane.has_single_node) {
+        ++num_lattice_nodes;
+        update(&lane.best_path_ends_at[lane.starts_at + lane.mblen],
+               unk_score + lane.best_path_score_till_here, lane.starts_at,
+               unk_id_);
+      }
+      lane.starts_at += lane.mblen;
+      if (lane.starts_at < size) {
+        start_traversal(&lane);
+        continue;
+      }
+
+      // Backtracks the best path and moves on to the next sentence.
+      auto *result = &results[lane.index];
+      int ends_at = size;
+      while (ends_at > 0) {
+        const auto &node = lane.best_path_ends_at[ends_at];
+        result->emplace_back(
+            lane.text.substr(node.starts_at, ends_at - node.starts_at),
+            node.id);
+        ends_at = node.starts_at;
+      }
+      std::reverse(result->begin(), result->end());
+
+      start_sentence(&lane);
+      if (!lane.active) --num_active;
+    }
+  }
+  SPM_METRICS_ADD(TRIE_LOOKUPS, num_trie_lookups);
+  SPM_METRICS_ADD(LATTICE_NODES, num_lattice_nodes);
+
+  return results;
+}
 }  // namespace unigram
 }  // namespace sentencepiece
@@ -25,6 +25,7 @@
 #include "model_interface.h"
 #include "sentencepiece_model.pb.h"
 #include "third_party/darts_clone/darts.h"
+#include "trie_layout.h"
 
 namespace sentencepiece {
 namespace unigram {
@@ -121,6 +122,9 @@ class Model : public ModelInterface {
 
   EncodeResult Encode(absl::string_view normalized) const override;
 
+  std::vector<EncodeResult> EncodeBatch(
+      const std::vector<absl::string_view> &normalized) const override;
+
   NBestEncodeResult NBestEncode(absl::string_view normalized,
                                 int nbest_size) const override;
 
@@ -131,6 +135,11 @@ class Model : public ModelInterface {
 
   bool IsNBestEncodeAvailable() const override { return true; }
 
+  std::string GetEncoderVariant() const override;
+
+  // Also selects the optimized encoder for the types of the pieces.
+  void InitializePieceTable() override;
+
   // Returns the minimum score in sentence pieces.
   // min_score() - 10 is used for the cost of unknown sentence.
   float min_score() const { return min_score_; }
@@ -151,6 +160,10 @@ class Model : public ModelInterface {
   bool VerifyOutputsEquivalent(absl::string_view expected,
                                absl::string_view actual) const override;
 
+  util::Status RelayoutTrie(
+      const std::vector<absl::string_view> &normalized_sample,
+      bool use_huge_pages) override;
+
  protected:
   // Builds a Trie index.
   void BuildTrie(std::vector<std::pair<absl::string_view, int>> *pieces);
@@ -164,12 +177,31 @@ class Model : public ModelInterface {
   // 5. Does not depend on `class Lattice` nor call `SetSentence()`,
   // `PopulateNodes()`, or `Viterbi()`. It does everything in one function.
   // For detailed explanations please see the comments inside the function body.
+  // The checks of the piece types are compiled out when the model has no
+  // such pieces.
+  template <bool kHasUnused, bool kHasUserDefined>
   EncodeResult EncodeOptimized(absl::string_view normalized) const;
 
+  // EncodeOptimized() for several sentences at once. The trie traversals of
+  // the sentences are interleaved, and each of them prefetches the unit of
+  // its next step, so that the cache misses of a sentence overlap with the
+  // work on the others.
+  std::vector<EncodeResult> EncodeInterleaved(
+      const std::vector<absl::string_view> &normalized) const;
+
   float min_score_ = 0.0;
   float max_score_ = 0.0;
   std::unique_ptr<Darts::DoubleArray> trie_;
 
+  // The instance of EncodeOptimized() selected by InitializePieceTable().
+  EncodeResult (Model::*encode_optimized_)(absl::string_view) const =
+      &Model::EncodeOptimized<true, true>;
+  bool has_unused_ = true;
+  bool has_user_defined_ = true;
+
+  // Units of |trie_| after RelayoutTrie().
+  std::unique_ptr<trie_layout::UnitArray> trie_units_;
+
   // Maximum size of the return value of Trie, which corresponds
   // to the maximum size of shared common prefix in the sentence pieces.
   int trie_results_size_;
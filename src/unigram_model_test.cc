@@ -676,6 +676,114 @@ TEST_P(UnigramModelTest, EncodeWithUnusedTest) {
   }
 }
 
+TEST(UnigramModelTest, EncoderVariantTest) {
+  ModelProto model_proto = MakeBaseModelProto();
+  AddPiece(&model_proto, "abcd", 10.0);  // 3
+  AddPiece(&model_proto, "abc", 5.0);    // 4
+  AddPiece(&model_proto, "ab", 2.0);     // 5
+  AddPiece(&model_proto, "cd", 1.0);     // 6
+  AddPiece(&model_proto, "a", 0.0);      // 7
+  AddPiece(&model_proto, "b", 0.0);      // 8
+  AddPiece(&model_proto, "c", 0.0);      // 9
+  AddPiece(&model_proto, "d", 0.0);      // 10
+  AddPiece(&model_proto, "da", 0.0);     // 11
+
+  Model model(model_proto);
+  EXPECT_EQ("optimized", model.GetEncoderVariant());
+  EXPECT_TRUE(model.SetEncoderVersion(EncoderVersion::kOriginal).ok());
+  EXPECT_EQ("original", model.GetEncoderVariant());
+  EXPECT_TRUE(model.SetEncoderVersion(EncoderVersion::kOptimized).ok());
+
+  // Reselected when the types of the pieces change.
+  model_proto.mutable_pieces(3)->set_type(ModelProto::SentencePiece::UNUSED);
+  model.InitializePieceTable();
+  EXPECT_EQ("optimized_unused", model.GetEncoderVariant());
+  auto result = model.Encode("abcd");
+  ASSERT_EQ(2, result.size());
+  EXPECT_EQ("abc", result[0].first);
+  EXPECT_EQ("d", result[1].first);
+
+  model_proto.mutable_pieces(11)->set_type(
+      ModelProto::SentencePiece::USER_DEFINED);
+  model.InitializePieceTable();
+  EXPECT_EQ("optimized_unused_user_defined", model.GetEncoderVariant());
+  result = model.Encode("abcda");
+  ASSERT_EQ(2, result.size());
+  EXPECT_EQ("abc", result[0].first);
+  EXPECT_EQ("da", result[1].first);
+
+  model_proto.mutable_pieces(3)->set_type(ModelProto::SentencePiece::NORMAL);
+  model.InitializePieceTable();
+  EXPECT_EQ("optimized_user_defined", model.GetEncoderVariant());
+}
+
+// Exposes the interleaved encoder, which EncodeBatch() uses only for large
+// tries.
+class InterleavedModel : public Model {
+ public:
+  explicit InterleavedModel(const ModelProto &model_proto)
+      : Model(model_proto) {}
+  using Model::EncodeInterleaved;
+};
+
+TEST_P(UnigramModelTest, EncodeBatchTest) {
+  ModelProto model_proto = MakeBaseModelProto();
+
+  AddPiece(&model_proto, "abcd", 10.0);  // 3
+  AddPiece(&model_proto, "abc", 5.0);    // 4
+  AddPiece(&model_proto, "ab", 2.0);     // 5
+  AddPiece(&model_proto, "cd", 1.0);     // 6
+  AddPiece(&model_proto, "a", 0.0);      // 7
+  AddPiece(&model_proto, "b", 0.0);      // 8
+  AddPiece(&model_proto, "c", 0.0);      // 9
+  AddPiece(&model_proto, "d", 0.0);      // 10
+  AddPiece(&model_proto, "東京", 3.0);   // 11
+  AddPiece(&model_proto, "ABC", 0.0);    // 12
+  AddPiece(&model_proto, "bcd", 20.0);   // 13
+  model_proto.mutable_pieces(12)->set_type(
+      ModelProto::SentencePiece::USER_DEFINED);
+  model_proto.mutable_pieces(13)->set_type(ModelProto::SentencePiece::UNUSED);
+
+  Model model(model_proto);
+  EXPECT_TRUE(model.SetEncoderVersion(encoder_version_).ok());
+  EXPECT_TRUE(model.EncodeBatch({}).empty());
+
+  // More sentences than the lanes of the interleaved encoder, with various
+  // lengths and empty ones.
+  const std::vector<std::string> words = {"abcd", "x",   "東京", "ABC",
+                                          "bcd",  "abc", "東",   "dd"};
+  std::vector<std::string> sentences;
+  for (int i = 0; i < 50; ++i) {
+    std::string sentence;
+    for (int j = 0; j < (i * 7) % 11; ++j) {
+      sentence += words[(i + j * 3) % words.size()];
+    }
+    sentences.push_back(sentence);
+  }
+  const std::vector<absl::string_view> inputs(sentences.begin(),
+                                              sentences.end());
+
+  const auto results = model.EncodeBatch(inputs);
+  ASSERT_EQ(inputs.size(), results.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    EXPECT_EQ(model.Encode(inputs[i]), results[i]);
+  }
+
+  if (encoder_version_ == EncoderVersion::kOptimized) {
+    const InterleavedModel interleaved(model_proto);
+    EXPECT_TRUE(interleaved.EncodeInterleaved({}).empty());
+    for (const size_t size : {1, 3, 50}) {
+      const std::vector<absl::string_view> batch(inputs.begin(),
+                                                 inputs.begin() + size);
+      const auto results = interleaved.EncodeInterleaved(batch);
+      ASSERT_EQ(batch.size(), results.size());
+      for (size_t i = 0; i < batch.size(); ++i) {
+        EXPECT_EQ(model.Encode(batch[i]), results[i]);
+      }
+    }
+  }
+}
+
 TEST_P(UnigramModelTest, VerifyOutputsEquivalent) {
   ModelProto model_proto = MakeBaseModelProto();
 
@@ -18,15 +18,18 @@
 #include <functional>
 #include <memory>
 #include <numeric>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "filesystem.h"
 #include "normalizer.h"
 #include "pretokenizer_for_training.h"
 #include "sentencepiece_trainer.h"
 #include "third_party/absl/container/flat_hash_map.h"
 #include "third_party/absl/memory/memory.h"
+#include "third_party/absl/strings/str_cat.h"
 #include "third_party/esaxx/esa.hxx"  // Suffix array library.
 #include "unicode_script.h"
 #include "unigram_model_trainer.h"
@@ -35,6 +38,7 @@
 namespace sentencepiece {
 namespace unigram {
 namespace {
+constexpr char kCheckpointMagic[] = "sentencepiece.unigram.checkpoint.v1";
 
 double Digamma(double x) {
   double result = 0.0;
@@ -91,6 +95,7 @@ void TrainerModel::SetSentencePieces(SentencePieces &&sentencepieces) {
     piece->set_score(score);
   }
 
+  InitializePieceTable();
   BuildTrie(&pieces);
   CHECK(status().ok());
 }
@@ -98,28 +103,45 @@ void TrainerModel::SetSentencePieces(SentencePieces &&sentencepieces) {
 // Returns seed sentencepieces for EM training.
 template <typename node_int_type>
 TrainerModel::SentencePieces Trainer::MakeSeedSentencePieces() const {
-  CHECK(!sentences_.empty());
-  CHECK(!required_chars_.empty());
+  return MakeJointSeedSentencePieces<node_int_type>({this})[0];
+}
+
+template <typename node_int_type>
+std::vector<TrainerModel::SentencePieces> Trainer::MakeJointSeedSentencePieces(
+    const std::vector<const Trainer *> &trainers) {
+  CHECK(!trainers.empty());
+  for (const auto *trainer : trainers) {
+    CHECK(!trainer->sentences_->empty());
+    CHECK(!trainer->required_chars_.empty());
+  }
 
   // Pretokenizer applied only in training time.
   // Pretokenizer is used as a constraint of piece extractions.
   const auto *pretokenizer = SentencePieceTrainer::GetPretokenizerForTraining();
 
   // Merges all sentences into one array with 0x0000 delimiter.
+  // The sentences of the k-th trainer start at side_begin[k].
   std::vector<char32> array;
-  absl::flat_hash_map<std::string, int64> all_chars;
+  std::vector<absl::flat_hash_map<std::string, int64>> all_chars(
+      trainers.size());
+  std::vector<node_int_type> side_begin;
   constexpr char32 kSentenceBoundary = 0x0000;
 
-  for (const auto &w : sentences_) {
-    const auto ut = string_util::UTF8ToUnicodeText(
-        pretokenizer ? pretokenizer->PreTokenize(w.first) : w.first);
-    for (const auto &c : ut) {
-      array.push_back(c);
-      if (c != kUNKChar && c != kSentenceBoundary) {
-        all_chars[string_util::UnicodeCharToUTF8(c)] += w.second;
+  for (size_t k = 0; k < trainers.size(); ++k) {
+    side_begin.push_back(array.size());
+    for (const auto &w : *trainers[k]->sentences_) {
+      const auto ut = string_util::UTF8ToUnicodeText(
+          pretokenizer ? pretokenizer->PreTokenize(w.first) : w.first);
+      for (const auto &c : ut) {
+        array.push_back(c);
+        if (c != kUNKChar && c != kSentenceBoundary) {
+          all_chars[k][string_util::UnicodeCharToUTF8(c)] += w.second;
+        }
       }
     }
+    if (trainers.size() > 1) array.push_back(kSentenceBoundary);
   }
+  side_begin.push_back(array.size());
 
   const node_int_type n = array.size();
   std::vector<node_int_type> SA(n);  // suffix array
@@ -135,8 +157,32 @@ TrainerModel::SentencePieces Trainer::MakeSeedSentencePieces() const {
   CHECK_EQ(0, esaxx(array.begin(), SA.begin(), L.begin(), R.begin(), D.begin(),
                     n, kAlphabetSize, node_num));
 
+  // side_count[k][j] is the number of suffixes of the k-th trainer in
+  // SA[0, j), so that the frequency of a substring in the k-th trainer is
+  // given by its LCP interval [L, R). The last trainer takes the rest.
+  std::vector<std::vector<node_int_type>> side_count(
+      trainers.size() - 1, std::vector<node_int_type>(n + 1, 0));
+  for (size_t k = 0; k + 1 < trainers.size(); ++k) {
+    for (node_int_type j = 0; j < n; ++j) {
+      side_count[k][j + 1] =
+          side_count[k][j] +
+          (SA[j] >= side_begin[k] && SA[j] < side_begin[k + 1] ? 1 : 0);
+    }
+  }
+  auto get_freq = [&](size_t k, node_int_type i) {
+    if (k < side_count.size()) {
+      return side_count[k][R[i]] - side_count[k][L[i]];
+    }
+    node_int_type freq = R[i] - L[i];
+    for (const auto &count : side_count) {
+      freq -= count[R[i]] - count[L[i]];
+    }
+    return freq;
+  };
+
   LOG(INFO) << "Extracting frequent sub strings...";
-  std::vector<std::pair<node_int_type, node_int_type>> substr_index;
+  std::vector<std::vector<std::pair<node_int_type, node_int_type>>>
+      substr_index(trainers.size());
   for (node_int_type i = 0; i < node_num; ++i) {
     const node_int_type offset = SA[L[i]];
     const node_int_type len = D[i];
@@ -150,46 +196,53 @@ TrainerModel::SentencePieces Trainer::MakeSeedSentencePieces() const {
       continue;
     }
     const UnicodeText uw(begin, end);
-    if (!IsValidSentencePiece(uw)) {
-      continue;
-    }
+    for (size_t k = 0; k < trainers.size(); ++k) {
+      const node_int_type freq = get_freq(k, i);
+      // Keeps the substrings occurring more than once in this trainer.
+      if (freq <= 1 || !trainers[k]->IsValidSentencePiece(uw)) {
+        continue;
+      }
 
-    // character-wise coverage is the default score.
-    const node_int_type freq = R[i] - L[i];
-    const node_int_type score = freq * len;
-    substr_index.emplace_back(i, score);
+      // character-wise coverage is the default score.
+      const node_int_type score = freq * len;
+      substr_index[k].emplace_back(i, score);
+    }
   }
 
-  // all_chars must be included in the seed sentencepieces.
-  TrainerModel::SentencePieces seed_sentencepieces;
-  for (const auto &it : Sorted(all_chars)) {
-    seed_sentencepieces.emplace_back(it);
-  }
+  std::vector<TrainerModel::SentencePieces> result(trainers.size());
+  for (size_t k = 0; k < trainers.size(); ++k) {
+    // all_chars must be included in the seed sentencepieces.
+    TrainerModel::SentencePieces &seed_sentencepieces = result[k];
+    for (const auto &it : Sorted(all_chars[k])) {
+      seed_sentencepieces.emplace_back(it);
+    }
 
-  // Sort by the coverage of sub strings.
-  for (const auto &p : Sorted(substr_index)) {
-    const node_int_type offset = SA[L[p.first]];
-    const node_int_type len = D[p.first];
-    CHECK_GT(len, 0);
-    const char32 *begin = &array[offset];
-    const char32 *end = &array[offset + len];
-    const UnicodeText uw(begin, end);
-    CHECK(IsValidSentencePiece(uw));  // just in case.
-    const std::string w = string_util::UnicodeTextToUTF8(uw);
-    if (seed_sentencepieces.size() ==
-        static_cast<size_t>(trainer_spec_.seed_sentencepiece_size())) {
-      break;
+    // Sort by the coverage of sub strings.
+    for (const auto &p : Sorted(substr_index[k])) {
+      const node_int_type offset = SA[L[p.first]];
+      const node_int_type len = D[p.first];
+      CHECK_GT(len, 0);
+      const char32 *begin = &array[offset];
+      const char32 *end = &array[offset + len];
+      const UnicodeText uw(begin, end);
+      CHECK(trainers[k]->IsValidSentencePiece(uw));  // just in case.
+      const std::string w = string_util::UnicodeTextToUTF8(uw);
+      if (seed_sentencepieces.size() ==
+          static_cast<size_t>(
+              trainers[k]->trainer_spec_.seed_sentencepiece_size())) {
+        break;
+      }
+      CHECK(!port::ContainsKey(all_chars[k], w));
+      seed_sentencepieces.emplace_back(w, p.second);
     }
-    CHECK(!port::ContainsKey(all_chars, w));
-    seed_sentencepieces.emplace_back(w, p.second);
-  }
 
-  ToLogProb(seed_sentencepieces.begin(), seed_sentencepieces.end());
+    ToLogProb(seed_sentencepieces.begin(), seed_sentencepieces.end());
 
-  LOG(INFO) << "Initialized " << seed_sentencepieces.size()
-            << " seed sentencepieces";
+    LOG(INFO) << "Initialized " << seed_sentencepieces.size()
+              << " seed sentencepieces";
+  }
 
-  return seed_sentencepieces;
+  return result;
 }
 
 std::vector<float> Trainer::RunEStep(const TrainerModel &model, float *obj,
@@ -202,7 +255,7 @@ std::vector<float> Trainer::RunEStep(const TrainerModel &model, float *obj,
   pool->StartWorkers();
 
   int64 all_sentence_freq = 0;
-  for (const auto &w : sentences_) {
+  for (const auto &w : *sentences_) {
     all_sentence_freq += w.second;
   }
 
@@ -211,10 +264,10 @@ std::vector<float> Trainer::RunEStep(const TrainerModel &model, float *obj,
     pool->Schedule([&, n]() {
       Lattice lattice;
       expected[n].resize(model.GetPieceSize(), 0.0);
-      for (size_t i = n; i < sentences_.size();
+      for (size_t i = n; i < sentences_->size();
            i += trainer_spec_.num_threads()) {
-        const std::string &w = sentences_[i].first;
-        const int64 freq = sentences_[i].second;
+        const std::string &w = (*sentences_)[i].first;
+        const int64 freq = (*sentences_)[i].second;
         lattice.SetSentence(w);
         model.PopulateNodes(&lattice);
         const float Z = lattice.PopulateMarginal(freq, &expected[n]);
@@ -275,15 +328,108 @@ TrainerModel::SentencePieces Trainer::RunMStep(
   return new_sentencepieces;
 }
 
-TrainerModel::SentencePieces Trainer::PruneSentencePieces(
-    const TrainerModel &model) const {
+int Trainer::RunEMSubIterations(TrainerModel *model,
+                                RoundStats *stats) const {
+  const float threshold = trainer_spec_.em_convergence_threshold();
+  float prev_objective = 0.0;
+  RoundStats unused_stats;
+  if (stats == nullptr) stats = &unused_stats;
+  for (int iter = 0; iter < trainer_spec_.num_sub_iterations(); ++iter) {
+    // Executes E step
+    float objective = 0.0;
+    int64 num_tokens = 0;
+    util::Timer estep_timer;
+    const auto expected = RunEStep(*model, &objective, &num_tokens);
+    stats->estep_sec += estep_timer.Get();
+
+    // Executes M step.
+    util::Timer mstep_timer;
+    auto new_sentencepieces = RunMStep(*model, expected);
+    stats->mstep_sec += mstep_timer.Get();
+    util::Timer trie_timer;
+    model->SetSentencePieces(std::move(new_sentencepieces));
+    stats->trie_sec += trie_timer.Get();
+
+    ++stats->em_iterations;
+    stats->objective = objective;
+    stats->num_tokens = num_tokens;
+
+    LOG(INFO) << "EM sub_iter=" << iter << " size=" << model->GetPieceSize()
+              << " obj=" << objective << " num_tokens=" << num_tokens
+              << " num_tokens/piece="
+              << 1.0 * num_tokens / model->GetPieceSize();
+
+    // Stops the sub-iterations when the objective no longer moves.
+    if (threshold > 0.0 && iter > 0) {
+      const float change = std::fabs(objective - prev_objective) /
+                           std::max(std::fabs(prev_objective), FLT_EPSILON);
+      if (change < threshold) {
+        LOG(INFO) << "EM converged at sub_iter=" << iter
+                  << " relative_change=" << change;
+        return iter + 1;
+      }
+    }
+    prev_objective = objective;
+  }  // end of Sub EM iteration
+
+  return trainer_spec_.num_sub_iterations();
+}
+
+float Trainer::GetShrinkingFactor(size_t num_kept,
+                                  const std::vector<float> &losses) const {
+  const float shrinking_factor = trainer_spec_.shrinking_factor();
+  if (!trainer_spec_.adaptive_shrinking() || losses.empty()) {
+    return shrinking_factor;
+  }
+
+  // Counts the top candidates covering kLossCoverage of the total loss.
+  // The remaining tail barely changes the likelihood, so the whole tail
+  // can be removed in this round.
+  constexpr double kLossCoverage = 0.99;
+  double total_loss = 0.0;
+  for (const float loss : losses) {
+    total_loss += std::max(loss, 0.0f);
+  }
+
+  size_t num_covered = losses.size();
+  double covered_loss = 0.0;
+  for (size_t i = 0; i < losses.size() && total_loss > 0.0; ++i) {
+    covered_loss += std::max(losses[i], 0.0f);
+    if (covered_loss >= kLossCoverage * total_loss) {
+      num_covered = i + 1;
+      break;
+    }
+  }
+
+  const float ratio =
+      1.0 * (num_kept + num_covered) / (num_kept + losses.size());
+  const float result = std::min(
+      shrinking_factor, std::max(trainer_spec_.min_shrinking_factor(), ratio));
+
+  LOG(INFO) << "Adaptive shrinking: candidates=" << losses.size()
+            << " covering=" << num_covered << " ratio=" << ratio
+            << " shrinking_factor=" << result;
+
+  return result;
+}
+
+void Trainer::ViterbiFreq::Merge(const ViterbiFreq &other) {
+  vsum += other.vsum;
+  for (size_t i = 0; i < freq.size(); ++i) {
+    freq[i] += other.freq[i];
+  }
+}
+
+void Trainer::GetAlternatives(
+    const TrainerModel &model, std::vector<bool> *always_keep,
+    std::vector<std::vector<int>> *alternatives) const {
   const auto &sentencepieces = model.GetSentencePieces();
 
   Lattice lattice;
-  std::vector<bool> always_keep(sentencepieces.size(), true);
-  std::vector<std::vector<int>> alternatives(sentencepieces.size());
+  always_keep->assign(sentencepieces.size(), true);
+  alternatives->assign(sentencepieces.size(), std::vector<int>());
 
-  // First, segments the current sentencepieces to know
+  // Segments the current sentencepieces to know
   // how each sentencepiece is resegmented if this sentencepiece is removed
   // from the vocabulary.
   // To do so, we take the second best segmentation of sentencepiece[i].
@@ -295,66 +441,80 @@ TrainerModel::SentencePieces Trainer::PruneSentencePieces(
     const auto nbests = lattice.NBest(2);
     if (nbests.size() == 1) {
       // No second-best result is found. always keep this sentencepiece.
-      always_keep[i] = true;
+      (*always_keep)[i] = true;
       continue;
     } else if (nbests[0].size() >= 2) {
       // Can safely remove this sentencepiece if its Viterbi path is split.
-      always_keep[i] = false;
+      (*always_keep)[i] = false;
     } else if (nbests[0].size() == 1) {
-      always_keep[i] = true;
+      (*always_keep)[i] = true;
       for (const auto *node : nbests[1]) {
-        alternatives[i].push_back(node->id);
+        (*alternatives)[i].push_back(node->id);
       }
     }
   }
+}
+
+void Trainer::AddViterbiFreq(const TrainerModel &model, size_t index,
+                             Lattice *lattice, ViterbiFreq *freq) const {
+  const auto &w = (*sentences_)[index];
+  lattice->SetSentence(w.first);
+  model.PopulateNodes(lattice);
+  freq->vsum += w.second;
+  for (const auto *node : lattice->Viterbi()) {
+    if (node->id >= 0) {
+      freq->freq[node->id] += w.second;
+    }
+  }
+}
+
+TrainerModel::SentencePieces Trainer::PruneSentencePieces(
+    const TrainerModel &model) const {
+  const auto &sentencepieces = model.GetSentencePieces();
+
+  // First, computes the alternatives of each sentencepiece.
+  std::vector<bool> always_keep;
+  std::vector<std::vector<int>> alternatives;
+  GetAlternatives(model, &always_keep, &alternatives);
 
   // Second, segments all sentences to compute likelihood
-  // with a unigram language model. inverted[i] stores
-  // the set of sentence index where the sentencepieces[i] appears.
-  float vsum = 0.0;
-  std::vector<float> freq(sentencepieces.size(), 0.0);
-  std::vector<std::vector<int>> inverted(sentencepieces.size());
+  // with a unigram language model.
+  ViterbiFreq freq;
+  freq.freq.resize(sentencepieces.size(), 0.0);
   {
-    std::vector<float> vsums(trainer_spec_.num_threads(), 0.0);
-    std::vector<std::vector<float>> freqs(trainer_spec_.num_threads());
-    std::vector<std::vector<std::vector<int>>> inverteds(
-        trainer_spec_.num_threads());
+    std::vector<ViterbiFreq> freqs(trainer_spec_.num_threads());
 
     auto pool = absl::make_unique<ThreadPool>(trainer_spec_.num_threads());
     pool->StartWorkers();
     for (int n = 0; n < trainer_spec_.num_threads(); ++n) {
-      freqs[n].resize(sentencepieces.size(), 0.0);
-      inverteds[n].resize(sentencepieces.size());
+      freqs[n].freq.resize(sentencepieces.size(), 0.0);
 
       pool->Schedule([&, n]() {
         Lattice lattice;
-        for (size_t i = n; i < sentences_.size();
+        for (size_t i = n; i < sentences_->size();
              i += trainer_spec_.num_threads()) {
-          const auto &w = sentences_[i];
-          lattice.SetSentence(w.first);
-          model.PopulateNodes(&lattice);
-          vsums[n] += w.second;
-          for (const auto *node : lattice.Viterbi()) {
-            if (node->id >= 0) {
-              freqs[n][node->id] += w.second;
-              inverteds[n][node->id].push_back(i);
-            }
-          }
+          AddViterbiFreq(model, i, &lattice, &freqs[n]);
         }
       });
     }
     pool.reset(nullptr);
 
     for (int n = 0; n < trainer_spec_.num_threads(); ++n) {
-      vsum += vsums[n];
-      for (size_t i = 0; i < sentencepieces.size(); ++i) {
-        freq[i] += freqs[n][i];
-        std::copy(inverteds[n][i].begin(), inverteds[n][i].end(),
-                  std::back_inserter(inverted[i]));
-      }
+      freq.Merge(freqs[n]);
     }
   }
 
+  return PruneSentencePieces(model, always_keep, alternatives, freq);
+}
+
+TrainerModel::SentencePieces Trainer::PruneSentencePieces(
+    const TrainerModel &model, const std::vector<bool> &always_keep,
+    const std::vector<std::vector<int>> &alternatives,
+    const ViterbiFreq &viterbi_freq) const {
+  const auto &sentencepieces = model.GetSentencePieces();
+  const auto &freq = viterbi_freq.freq;
+  const float vsum = viterbi_freq.vsum;
+
   const float sum = std::accumulate(freq.begin(), freq.end(), 0.0);
   const float logsum = std::log(static_cast<double>(sum));
   std::vector<std::pair<int, float>> candidates;
@@ -373,11 +533,10 @@ TrainerModel::SentencePieces Trainer::PruneSentencePieces(
       // no alternatives. Keeps this entry.
       new_sentencepieces.push_back(sentencepieces[i]);
     } else {
-      float F = 0.0;  // the frequency of sentencepieces[i].
-      for (const int n : inverted[i]) {
-        F += sentences_[n].second;
-      }
-      F /= vsum;  // normalizes by all sentence frequency.
+      // The frequency of sentencepieces[i] normalized by all sentence
+      // frequency. Every occurrence of sentencepieces[i] adds the frequency
+      // of its sentence to freq[i], so no per-sentence index is needed.
+      const float F = freq[i] / vsum;
 
       // The logprob with the sentencepiece[i].
       const float logprob_sp = std::log(static_cast<double>(freq[i])) - logsum;
@@ -402,13 +561,29 @@ TrainerModel::SentencePieces Trainer::PruneSentencePieces(
     }
   }
 
+  const auto sorted_candidates = Sorted(candidates);
+  std::vector<float> losses;
+  losses.reserve(sorted_candidates.size());
+  for (const auto &w : sorted_candidates) {
+    losses.push_back(w.second);
+  }
+
+  const float shrinking_factor =
+      GetShrinkingFactor(new_sentencepieces.size(), losses);
+  // Does not prune below the next snapshot either, so that every snapshot
+  // is finalized from at least as many pieces as SaveSnapshots expects.
+  int min_size = desired_vocab_size_;
+  for (const int vocab_size : trainer_spec_.snapshot_vocab_sizes()) {
+    if (!port::ContainsKey(saved_snapshots_, vocab_size)) {
+      min_size = std::max(min_size, static_cast<int>(vocab_size * 1.1));
+    }
+  }
   const int pruned_size =
-      std::max<int>(desired_vocab_size_,
-                    trainer_spec_.shrinking_factor() * sentencepieces.size());
+      std::max<int>(min_size, shrinking_factor * sentencepieces.size());
 
-  // Keeps trainer_spec_.shrinking_factor * sentencepieces.size() pieces.
+  // Keeps shrinking_factor * sentencepieces.size() pieces.
   // shrinking_factor is 0.75 by default.
-  for (const auto &w : Sorted(candidates)) {
+  for (const auto &w : sorted_candidates) {
     if (new_sentencepieces.size() == static_cast<size_t>(pruned_size)) {
       break;
     }
@@ -420,6 +595,11 @@ TrainerModel::SentencePieces Trainer::PruneSentencePieces(
 
 TrainerModel::SentencePieces Trainer::FinalizeSentencePieces(
     const TrainerModel &model) const {
+  return FinalizeSentencePieces(model, trainer_spec_.vocab_size());
+}
+
+TrainerModel::SentencePieces Trainer::FinalizeSentencePieces(
+    const TrainerModel &model, int vocab_size) const {
   const auto &sentencepieces = model.GetSentencePieces();
   absl::flat_hash_map<std::string, float> final_sentencepieces;
   absl::flat_hash_map<std::string, float> sp(sentencepieces.begin(),
@@ -441,7 +621,7 @@ TrainerModel::SentencePieces Trainer::FinalizeSentencePieces(
     }
   }
 
-  const int vocab_size_size = trainer_spec_.vocab_size() - meta_pieces_.size();
+  const int vocab_size_size = vocab_size - meta_pieces_.size();
   CHECK_GT(vocab_size_size, 0);
 
   // Then keeps sentencepieces with higher scores.
@@ -458,68 +638,267 @@ TrainerModel::SentencePieces Trainer::FinalizeSentencePieces(
   return Sorted(final_sentencepieces);
 }
 
+void Trainer::SaveSnapshots(const TrainerModel &model, ThreadPool *pool) {
+  for (const int vocab_size : trainer_spec_.snapshot_vocab_sizes()) {
+    if (model.GetPieceSize() > static_cast<int>(vocab_size * 1.1) ||
+        !saved_snapshots_.insert(vocab_size).second) {
+      continue;
+    }
+
+    TrainerSpec trainer_spec = trainer_spec_;
+    trainer_spec.set_vocab_size(vocab_size);
+    trainer_spec.clear_snapshot_vocab_sizes();
+    trainer_spec.set_model_prefix(
+        absl::StrCat(trainer_spec_.model_prefix(), ".", vocab_size));
+    const auto pieces = FinalizeSentencePieces(model, vocab_size);
+
+    LOG(INFO) << "Saving snapshot: vocab_size=" << vocab_size
+              << " piece_size=" << model.GetPieceSize();
+    snapshot_status_.emplace_back();
+    util::Status *status = &snapshot_status_.back();
+    pool->Schedule([this, trainer_spec, pieces, status]() {
+      *status = SaveSnapshot(trainer_spec, pieces);
+    });
+  }
+}
+
+util::Status Trainer::SnapshotStatus() const {
+  for (const auto &status : snapshot_status_) {
+    RETURN_IF_ERROR(status);
+  }
+  return util::OkStatus();
+}
+
+
+util::Status Trainer::SaveCheckpoint(absl::string_view prefix, int round,
+                                     const TrainerModel &model) {
+  if (trainer_spec_.save_corpus_cache() && corpus_cache_.empty()) {
+    const std::string corpus_cache = absl::StrCat(prefix, ".corpus");
+    RETURN_IF_ERROR(SaveCorpusCache(corpus_cache));
+    corpus_cache_ = corpus_cache;
+  }
+
+  std::string data = string_util::EncodeString(kCheckpointMagic);
+  data += string_util::EncodeString(GetResumeKey());
+  data += string_util::EncodePOD<int32>(round);
+  data += string_util::EncodePOD<int32>(desired_vocab_size_);
+  data += string_util::EncodeString(corpus_cache_);
+  data += string_util::EncodePOD<uint32>(saved_snapshots_.size());
+  for (const int vocab_size : saved_snapshots_) {
+    data += string_util::EncodePOD<int32>(vocab_size);
+  }
+  const auto &sentencepieces = model.GetSentencePieces();
+  data += string_util::EncodePOD<uint32>(sentencepieces.size());
+  for (const auto &w : sentencepieces) {
+    data += string_util::EncodeString(w.first);
+    data += string_util::EncodePOD<float>(w.second);
+  }
+
+  const std::string filename = absl::StrCat(prefix, ".ckpt");
+  LOG(INFO) << "Saving checkpoint: " << filename << " round=" << round
+            << " size=" << sentencepieces.size();
+  return filesystem::WriteFileAtomically(filename, data);
+}
+
+util::Status Trainer::LoadCheckpoint(absl::string_view prefix, int *round,
+                                     TrainerModel *model) {
+  const std::string filename = absl::StrCat(prefix, ".ckpt");
+  LOG(INFO) << "Loading checkpoint: " << filename;
+  std::string data;
+  {
+    auto input = filesystem::NewReadableFile(filename, true);
+    RETURN_IF_ERROR(input->status());
+    CHECK_OR_RETURN(input->ReadAll(&data));
+  }
+
+  absl::string_view input(data);
+  std::string magic;
+  CHECK_OR_RETURN(string_util::ConsumeString(&input, &magic) &&
+                  magic == kCheckpointMagic)
+      << filename << " is not a checkpoint.";
+
+#define CONSUME_OR_RETURN(expr) \
+  CHECK_OR_RETURN(expr) << filename << " is broken."
+
+  std::string key;
+  CONSUME_OR_RETURN(string_util::ConsumeString(&input, &key));
+  CHECK_OR_RETURN(key == GetResumeKey())
+      << filename << " was saved with a different trainer_spec or "
+      << "normalizer_spec.";
+
+  int32 value = 0;
+  CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &value));
+  *round = value;
+  CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &value));
+  desired_vocab_size_ = value;
+  CONSUME_OR_RETURN(string_util::ConsumeString(&input, &corpus_cache_));
+
+  uint32 size = 0;
+  CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &size));
+  for (uint32 i = 0; i < size; ++i) {
+    CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &value));
+    saved_snapshots_.insert(value);
+  }
+
+  CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &size));
+  TrainerModel::SentencePieces sentencepieces(size);
+  for (auto &w : sentencepieces) {
+    CONSUME_OR_RETURN(string_util::ConsumeString(&input, &w.first));
+    CONSUME_OR_RETURN(string_util::ConsumePOD(&input, &w.second));
+  }
+  CONSUME_OR_RETURN(input.empty());
+#undef CONSUME_OR_RETURN
+
+  if (!corpus_cache_.empty()) {
+    RETURN_IF_ERROR(LoadCorpusCache(corpus_cache_));
+  } else {
+    RETURN_IF_ERROR(LoadSentences());
+    if (trainer_spec_.split_by_whitespace()) {
+      SplitSentencesByWhitespace();
+    }
+  }
+
+  model->SetSentencePieces(std::move(sentencepieces));
+  LOG(INFO) << "Resuming from round=" << *round
+            << " size=" << model->GetPieceSize();
+
+  return util::OkStatus();
+}
+
+std::string RoundStats::ToJson(absl::string_view side) const {
+  std::ostringstream os;
+  os << "{\"side\":\"" << side << "\",\"round\":" << round
+     << ",\"load_sec\":" << load_sec << ",\"estep_sec\":" << estep_sec
+     << ",\"mstep_sec\":" << mstep_sec << ",\"trie_sec\":" << trie_sec
+     << ",\"prune_sec\":" << prune_sec
+     << ",\"em_iterations\":" << em_iterations
+     << ",\"objective\":" << objective << ",\"num_tokens\":" << num_tokens
+     << ",\"num_pieces\":" << num_pieces
+     << ",\"rss_bytes\":" << util::GetCurrentRSS()
+     << ",\"peak_rss_bytes\":" << util::GetPeakRSS() << "}";
+  return os.str();
+}
+
+util::Status Trainer::NewStatsOutput(
+    std::unique_ptr<filesystem::WritableFile> *output) const {
+  output->reset();
+  if (trainer_spec_.training_stats_file().empty()) return util::OkStatus();
+  // The resumed rounds follow the stats written before the checkpoint.
+  *output = trainer_spec_.resume_from_checkpoint()
+                ? filesystem::NewAppendableFile(
+                      trainer_spec_.training_stats_file())
+                : filesystem::NewWritableFile(
+                      trainer_spec_.training_stats_file());
+  return (*output)->status();
+}
 
 util::Status Trainer::Train() {
   RETURN_IF_ERROR(status());
 
   CHECK_EQ_OR_RETURN(TrainerSpec::UNIGRAM, trainer_spec_.model_type());
   CHECK_OR_RETURN(normalizer_spec_.escape_whitespaces());
+  CHECK_OR_RETURN(output_model_proto_ == nullptr ||
+                  trainer_spec_.snapshot_vocab_sizes().empty())
+      << "--snapshot_vocab_sizes requires --model_prefix.";
+  CHECK_OR_RETURN(output_model_proto_ == nullptr ||
+                  (trainer_spec_.checkpoint_interval() == 0 &&
+                   !trainer_spec_.resume_from_checkpoint()))
+      << "Checkpoints require --model_prefix.";
 
   TrainerModel model(trainer_spec_, normalizer_spec_);
 
   RETURN_IF_ERROR(model.status());
-  RETURN_IF_ERROR(LoadSentences());
 
-  if (trainer_spec_.train_extremely_large_corpus()) {
-      LOG(INFO)<<"large";
-    auto seed_sentencepieces = MakeSeedSentencePieces<int64>();
-    model.SetSentencePieces(std::move(seed_sentencepieces));
+  std::unique_ptr<filesystem::WritableFile> stats_output;
+  RETURN_IF_ERROR(NewStatsOutput(&stats_output));
+
+  // The number of finished EM rounds.
+  int round = 0;
+  RoundStats stats;
+  util::Timer load_timer;
+
+  if (trainer_spec_.resume_from_checkpoint()) {
+    RETURN_IF_ERROR(
+        LoadCheckpoint(trainer_spec_.model_prefix(), &round, &model));
   } else {
-    auto seed_sentencepieces = MakeSeedSentencePieces<int32>();
-    model.SetSentencePieces(std::move(seed_sentencepieces));
-  }
+    RETURN_IF_ERROR(LoadSentences());
+
+    if (trainer_spec_.train_extremely_large_corpus()) {
+      LOG(INFO) << "large";
+      auto seed_sentencepieces = MakeSeedSentencePieces<int64>();
+      model.SetSentencePieces(std::move(seed_sentencepieces));
+    } else {
+      auto seed_sentencepieces = MakeSeedSentencePieces<int32>();
+      model.SetSentencePieces(std::move(seed_sentencepieces));
+    }
+
+    if (trainer_spec_.split_by_whitespace()) {
+      SplitSentencesByWhitespace();
+    }
 
-  if (trainer_spec_.split_by_whitespace()) {
-    SplitSentencesByWhitespace();
+    desired_vocab_size_ =
+        static_cast<size_t>(trainer_spec_.vocab_size() * 1.1);
   }
 
-  LOG(INFO) << "Using " << sentences_.size() << " sentences for EM training";
+  stats.load_sec = load_timer.Get();
+  LOG(INFO) << "Using " << sentences_->size() << " sentences for EM training";
 
-  desired_vocab_size_ = static_cast<size_t>(trainer_spec_.vocab_size() * 1.1);
+  // Writes the snapshot models while the training continues.
+  auto snapshot_pool = absl::make_unique<ThreadPool>(1);
+  snapshot_pool->StartWorkers();
 
   while (true) {
+    stats.round = round;
+
     // Sub-EM iteration.
-    for (int iter = 0; iter < trainer_spec_.num_sub_iterations(); ++iter) {
-      // Executes E step
-      float objective = 0.0;
-      int64 num_tokens = 0;
-      const auto expected = RunEStep(model, &objective, &num_tokens);
-
-      // Executes M step.
-      auto new_sentencepieces = RunMStep(model, expected);
-      model.SetSentencePieces(std::move(new_sentencepieces));
-
-      LOG(INFO) << "EM sub_iter=" << iter << " size=" << model.GetPieceSize()
-                << " obj=" << objective << " num_tokens=" << num_tokens
-                << " num_tokens/piece="
-                << 1.0 * num_tokens / model.GetPieceSize();
-    }  // end of Sub EM iteration
+    RunEMSubIterations(&model, &stats);
+
+    SaveSnapshots(model, snapshot_pool.get());
 
     // Stops the iteration when the size of sentences reaches to the
     // desired symbol size.
     if (model.GetPieceSize() <= desired_vocab_size_) {
+      stats.num_pieces = model.GetPieceSize();
+      if (stats_output) {
+        CHECK_OR_RETURN(stats_output->WriteLine(stats.ToJson("model")));
+      }
       break;
     }
 
     // Prunes pieces.
+    util::Timer prune_timer;
     auto new_sentencepieces = PruneSentencePieces(model);
+    stats.prune_sec = prune_timer.Get();
+    util::Timer trie_timer;
     model.SetSentencePieces(std::move(new_sentencepieces));
+    stats.trie_sec += trie_timer.Get();
+
+    stats.num_pieces = model.GetPieceSize();
+    if (stats_output) {
+      CHECK_OR_RETURN(stats_output->WriteLine(stats.ToJson("model")));
+    }
+    stats = RoundStats();
+
+    ++round;
+    if (trainer_spec_.checkpoint_interval() > 0 &&
+        round % trainer_spec_.checkpoint_interval() == 0) {
+      // The checkpoint records the snapshots as saved, so waits for them.
+      snapshot_pool.reset();
+      RETURN_IF_ERROR(SnapshotStatus());
+      snapshot_pool = absl::make_unique<ThreadPool>(1);
+      snapshot_pool->StartWorkers();
+      RETURN_IF_ERROR(
+          SaveCheckpoint(trainer_spec_.model_prefix(), round, model));
+    }
   }  // end of EM iteration
 
   // Finally, adjusts the size of sentencepices to be |vocab_size|.
   final_pieces_ = FinalizeSentencePieces(model);
 
-  return Save();
+  RETURN_IF_ERROR(Save());
+
+  snapshot_pool.reset();
+  return SnapshotStatus();
 }
 }  // namespace unigram
 }  // namespace sentencepiece
@@ -15,11 +15,14 @@
 #ifndef UNIGRAM_MODEL_TRAINER_H_
 #define UNIGRAM_MODEL_TRAINER_H_
 
+#include <deque>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "filesystem.h"
 #include "sentencepiece_model.pb.h"
 #include "third_party/absl/strings/string_view.h"
 #include "trainer_interface.h"
@@ -60,6 +63,25 @@ class TrainerModel : public Model {
   ModelProto model_proto_data_;
 };
 
+// Wall time and statistics of one EM round, i.e., the EM sub-iterations and
+// the prune following them. Written to training_stats_file as a JSON line.
+struct RoundStats {
+  int round = 0;
+  double load_sec = 0.0;  // loading and seeding the corpus. First round only.
+  double estep_sec = 0.0;
+  double mstep_sec = 0.0;
+  double trie_sec = 0.0;  // rebuilding the trie of the updated pieces.
+  double prune_sec = 0.0;
+  int em_iterations = 0;
+  float objective = 0.0;  // of the last E step.
+  int64 num_tokens = 0;   // of the last E step.
+  size_t num_pieces = 0;  // at the end of the round.
+
+  // Returns a JSON object of the stats and the current and peak RSS.
+  // |side| names the model, e.g., "src" or "tgt" of the align trainer.
+  std::string ToJson(absl::string_view side) const;
+};
+
 class Trainer : public TrainerInterface {
  public:
   Trainer(const TrainerSpec &trainer_spec,
@@ -79,6 +101,14 @@ class Trainer : public TrainerInterface {
   template <typename node_int_type>
   TrainerModel::SentencePieces MakeSeedSentencePieces() const;
 
+  // Same as above, but makes the seed pieces of all |trainers| from one
+  // suffix array over their sentences_, e.g., both sides of the align
+  // trainer. The frequency of a substring in each trainer is counted from
+  // its shared LCP interval. Returns the seed pieces of each trainer.
+  template <typename node_int_type>
+  static std::vector<TrainerModel::SentencePieces> MakeJointSeedSentencePieces(
+      const std::vector<const Trainer *> &trainers);
+
   // Executes the E step of EM and returns expected count.
   // The index of return array is the vocab id.
   // |objective| is a negative likelihood of the current model.
@@ -92,20 +122,102 @@ class Trainer : public TrainerInterface {
   TrainerModel::SentencePieces RunMStep(
       const TrainerModel &model, const std::vector<float> &expected) const;
 
+  // Runs at most num_sub_iterations EM steps on |model|. Stops earlier
+  // when the relative change of the objective falls below
+  // em_convergence_threshold. Returns the number of executed steps.
+  // The time of each step is added to |stats| if given.
+  int RunEMSubIterations(TrainerModel *model,
+                         RoundStats *stats = nullptr) const;
+
+  // Viterbi frequency of each piece over (a part of) sentences_.
+  struct ViterbiFreq {
+    std::vector<float> freq;  // indexed by the vocab id.
+    float vsum = 0.0;         // the sum of the sentence frequencies.
+
+    void Merge(const ViterbiFreq &other);
+  };
+
+  // Takes the second best segmentation of each piece of |model|, i.e., its
+  // |alternatives| when the piece is removed. Pieces whose Viterbi path is
+  // already split are marked as removable in |always_keep|.
+  void GetAlternatives(const TrainerModel &model,
+                       std::vector<bool> *always_keep,
+                       std::vector<std::vector<int>> *alternatives) const;
+
+  // Segments sentences_[index] with |model| and adds the pieces on the
+  // Viterbi path to |freq|. |lattice| is reused across calls.
+  void AddViterbiFreq(const TrainerModel &model, size_t index,
+                      Lattice *lattice, ViterbiFreq *freq) const;
+
   // Heuristically prunes the current pieces.
   // This is called after each EM sub-iteration.
   TrainerModel::SentencePieces PruneSentencePieces(
       const TrainerModel &model) const;
 
+  // Same as above, but takes the statistics computed by GetAlternatives()
+  // and AddViterbiFreq() over all sentences_.
+  TrainerModel::SentencePieces PruneSentencePieces(
+      const TrainerModel &model, const std::vector<bool> &always_keep,
+      const std::vector<std::vector<int>> &alternatives,
+      const ViterbiFreq &viterbi_freq) const;
+
+  // Returns the ratio of pieces kept by PruneSentencePieces.
+  // |num_kept| pieces are always kept, and |losses| are the losses of the
+  // prunable candidates sorted in descending order. Returns
+  // shrinking_factor unless adaptive_shrinking is enabled.
+  float GetShrinkingFactor(size_t num_kept,
+                           const std::vector<float> &losses) const;
+
   // Makes the final sentence pieces by incorporating the required characters
   // and control/user defined symbols.
   TrainerModel::SentencePieces FinalizeSentencePieces(
       const TrainerModel &model) const;
 
+  // Same as above, but makes the pieces for a model of |vocab_size|.
+  TrainerModel::SentencePieces FinalizeSentencePieces(const TrainerModel &model,
+                                                      int vocab_size) const;
+
+  // Finalizes a model for every size in snapshot_vocab_sizes which |model|
+  // has reached and saves it to <model_prefix>.<size> on |pool|, so that
+  // the training loop continues while the files are written.
+  void SaveSnapshots(const TrainerModel &model, ThreadPool *pool);
+
+  // Returns the first error of the snapshots saved by SaveSnapshots.
+  // The pool passed to SaveSnapshots must be joined before calling this.
+  util::Status SnapshotStatus() const;
+
+  // Saves the state of the training loop after |round| EM rounds, i.e., the
+  // pieces and scores of |model|, desired_vocab_size_ and the saved
+  // snapshots, to <prefix>.ckpt. When save_corpus_cache is set, the
+  // preprocessed corpus is saved to <prefix>.corpus once and the checkpoint
+  // refers to it. The snapshots passed to SaveSnapshots must be finished.
+  util::Status SaveCheckpoint(absl::string_view prefix, int round,
+                              const TrainerModel &model);
+
+  // Restores |round| and |model| from <prefix>.ckpt saved by SaveCheckpoint()
+  // and loads the corpus, from the cache if the checkpoint refers to one.
+  // The seeding is skipped. Fails when the checkpoint was saved with
+  // different specs, see GetResumeKey().
+  util::Status LoadCheckpoint(absl::string_view prefix, int *round,
+                              TrainerModel *model);
+
+  // Opens training_stats_file, for appending when resume_from_checkpoint is
+  // set. |output| is left empty when it is not set.
+  util::Status NewStatsOutput(
+      std::unique_ptr<filesystem::WritableFile> *output) const;
+
   // When the size of SentencePieces becomes less than desired_vocab_size_,
   // break the main training loop. desired_vocab_size_ = 1.1 * vocab_size_
   // for now.
   int desired_vocab_size_;
+
+  // Vocab sizes already passed to SaveSnapshots and the status of each
+  // snapshot, written by the thread saving it.
+  std::set<int> saved_snapshots_;
+  std::deque<util::Status> snapshot_status_;
+
+  // Preprocessed corpus cache referred from the checkpoints.
+  std::string corpus_cache_;
 };
 }  // namespace unigram
 }  // namespace sentencepiece
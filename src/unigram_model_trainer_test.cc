@@ -12,10 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.!
 
+#include "filesystem.h"
 #include "sentencepiece_model.pb.h"
 #include "sentencepiece_processor.h"
 #include "sentencepiece_trainer.h"
+#include "sentencepiece_trainer_align.h"
 #include "testharness.h"
+#include "third_party/absl/memory/memory.h"
+#include "third_party/absl/strings/match.h"
 #include "third_party/absl/strings/str_cat.h"
 #include "third_party/absl/strings/str_join.h"
 #include "unigram_model_trainer.h"
@@ -86,6 +90,331 @@ TEST(UnigramTrainerTest, EndToEndTest) {
 #endif
 }
 
+TEST(UnigramTrainerTest, GetShrinkingFactorTest) {
+  TrainerSpec trainer_spec;
+  NormalizerSpec normalizer_spec;
+  trainer_spec.set_shrinking_factor(0.75);
+  trainer_spec.set_min_shrinking_factor(0.5);
+
+  // One dominant loss followed by a long tail of negligible losses.
+  std::vector<float> skewed(99, 0.0001);
+  skewed.insert(skewed.begin(), 100.0);
+  const std::vector<float> uniform(100, 1.0);
+
+  {
+    const Trainer trainer(trainer_spec, normalizer_spec, normalizer_spec);
+    EXPECT_NEAR(0.75, trainer.GetShrinkingFactor(0, skewed), 0.001);
+    EXPECT_NEAR(0.75, trainer.GetShrinkingFactor(0, uniform), 0.001);
+  }
+
+  trainer_spec.set_adaptive_shrinking(true);
+  {
+    const Trainer trainer(trainer_spec, normalizer_spec, normalizer_spec);
+    EXPECT_NEAR(0.5, trainer.GetShrinkingFactor(0, skewed), 0.001);
+    EXPECT_NEAR(0.75, trainer.GetShrinkingFactor(0, uniform), 0.001);
+    EXPECT_NEAR(0.75, trainer.GetShrinkingFactor(100, {}), 0.001);
+  }
+}
+
+TEST(UnigramTrainerTest, AdaptiveScheduleTest) {
+  const std::string input =
+      util::JoinPath(absl::GetFlag(FLAGS_test_srcdir), kTestInputData);
+
+  ASSERT_TRUE(
+      SentencePieceTrainer::Train(
+          absl::StrCat(
+              "--model_prefix=",
+              util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "tmp_model"),
+              " --input=", input,
+              " --vocab_size=8000 --normalization_rule_name=identity",
+              " --model_type=unigram --max_sentence_length=2048",
+              " --num_sub_iterations=4 --em_convergence_threshold=0.01",
+              " --adaptive_shrinking --min_shrinking_factor=0.6"))
+          .ok());
+
+  SentencePieceProcessor sp;
+  EXPECT_TRUE(sp.Load(util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir),
+                                     "tmp_model.model"))
+                  .ok());
+  EXPECT_EQ(8000, sp.GetPieceSize());
+
+  EXPECT_FALSE(SentencePieceTrainer::Train(
+                   absl::StrCat("--model_prefix=",
+                                util::JoinPath(
+                                    absl::GetFlag(FLAGS_test_tmpdir),
+                                    "tmp_model"),
+                                " --input=", input,
+                                " --adaptive_shrinking --shrinking_factor=0.6",
+                                " --min_shrinking_factor=0.7"))
+                   .ok());
+}
+
+TEST(UnigramTrainerTest, SnapshotVocabSizesTest) {
+  const std::string input =
+      util::JoinPath(absl::GetFlag(FLAGS_test_srcdir), kTestInputData);
+  const std::string model_prefix =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "tmp_model");
+
+  ASSERT_TRUE(
+      SentencePieceTrainer::Train(
+          absl::StrCat("--model_prefix=", model_prefix, " --input=", input,
+                       " --vocab_size=8000 --normalization_rule_name=identity",
+                       " --model_type=unigram --max_sentence_length=2048",
+                       " --snapshot_vocab_sizes=12000,10000"))
+          .ok());
+
+  for (const int vocab_size : {8000, 10000, 12000}) {
+    const std::string filename =
+        vocab_size == 8000
+            ? absl::StrCat(model_prefix, ".model")
+            : absl::StrCat(model_prefix, ".", vocab_size) + ".model";
+    SentencePieceProcessor sp;
+    ASSERT_TRUE(sp.Load(filename).ok());
+    EXPECT_EQ(vocab_size, sp.GetPieceSize());
+    EXPECT_EQ(vocab_size, sp.model_proto().trainer_spec().vocab_size());
+    EXPECT_EQ(vocab_size == 8000 ? 2 : 0,
+              sp.model_proto().trainer_spec().snapshot_vocab_sizes_size());
+  }
+
+  EXPECT_FALSE(SentencePieceTrainer::Train(
+                   absl::StrCat("--model_prefix=", model_prefix,
+                                " --input=", input, " --vocab_size=8000",
+                                " --snapshot_vocab_sizes=8000"))
+                   .ok());
+}
+
+TEST(UnigramTrainerTest, SnapshotVocabSizesAcrossPruneStepTest) {
+  const std::string input =
+      util::JoinPath(absl::GetFlag(FLAGS_test_srcdir), kTestInputData);
+  const std::string model_prefix =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "tmp_model");
+
+  // A single prune step with shrinking_factor=0.5 passes both snapshots.
+  ASSERT_TRUE(
+      SentencePieceTrainer::Train(
+          absl::StrCat("--model_prefix=", model_prefix, " --input=", input,
+                       " --vocab_size=8000 --normalization_rule_name=identity",
+                       " --model_type=unigram --max_sentence_length=2048",
+                       " --shrinking_factor=0.5",
+                       " --snapshot_vocab_sizes=9000,8500"))
+          .ok());
+
+  for (const int vocab_size : {8500, 9000}) {
+    SentencePieceProcessor sp;
+    ASSERT_TRUE(
+        sp.Load(absl::StrCat(model_prefix, ".", vocab_size) + ".model").ok());
+    EXPECT_EQ(vocab_size, sp.GetPieceSize());
+  }
+}
+
+TEST(UnigramTrainerTest, CheckpointTest) {
+  const std::string input =
+      util::JoinPath(absl::GetFlag(FLAGS_test_srcdir), kTestInputData);
+  const std::string model_prefix =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "tmp_model");
+  const std::string args = absl::StrCat(
+      "--model_prefix=", model_prefix, " --input=", input,
+      " --vocab_size=8000 --normalization_rule_name=identity",
+      " --model_type=unigram --max_sentence_length=2048");
+
+  // Returns the pieces and scores, as trainer_spec differs between runs.
+  auto load_model = [&]() {
+    SentencePieceProcessor sp;
+    EXPECT_TRUE(sp.Load(model_prefix + ".model").ok());
+    std::string data;
+    for (const auto &piece : sp.model_proto().pieces()) {
+      data += piece.SerializeAsString();
+    }
+    return data;
+  };
+
+  // The checkpoint of the last round is left after the training.
+  ASSERT_TRUE(SentencePieceTrainer::Train(
+                  absl::StrCat(args, " --checkpoint_interval=1"))
+                  .ok());
+  const std::string expected = load_model();
+
+  // Resuming from it skips the seeding and gives the same model.
+  ASSERT_TRUE(SentencePieceTrainer::Train(
+                  absl::StrCat(args, " --checkpoint_interval=1",
+                               " --resume_from_checkpoint"))
+                  .ok());
+  EXPECT_EQ(expected, load_model());
+
+  // The corpus is restored from the cache referred from the checkpoint.
+  ASSERT_TRUE(SentencePieceTrainer::Train(
+                  absl::StrCat(args, " --checkpoint_interval=1",
+                               " --save_corpus_cache"))
+                  .ok());
+  ASSERT_TRUE(SentencePieceTrainer::Train(
+                  absl::StrCat(args, " --resume_from_checkpoint"))
+                  .ok());
+  EXPECT_EQ(expected, load_model());
+
+  // The training prunes 3 times, so the checkpoint is left at round 2 as if
+  // the training was stopped there. Resuming it gives the model of an
+  // uninterrupted run.
+  const std::string stats_file =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "stats.jsonl");
+  ASSERT_TRUE(SentencePieceTrainer::Train(args).ok());
+  EXPECT_EQ(expected, load_model());
+  ASSERT_TRUE(SentencePieceTrainer::Train(
+                  absl::StrCat(args, " --checkpoint_interval=2",
+                               " --training_stats_file=", stats_file))
+                  .ok());
+  ASSERT_TRUE(SentencePieceTrainer::Train(
+                  absl::StrCat(args, " --resume_from_checkpoint",
+                               " --training_stats_file=", stats_file))
+                  .ok());
+  EXPECT_EQ(expected, load_model());
+
+  // The stats of the resumed rounds are appended.
+  {
+    auto reader = filesystem::NewReadableFile(stats_file);
+    ASSERT_TRUE(reader->status().ok());
+    std::string line;
+    for (const int round : {0, 1, 2, 3, 2, 3}) {
+      ASSERT_TRUE(reader->ReadLine(&line));
+      EXPECT_TRUE(absl::StartsWith(
+          line, absl::StrCat("{\"side\":\"model\",\"round\":", round) +
+                    ","));
+    }
+    EXPECT_FALSE(reader->ReadLine(&line));
+  }
+
+  // The checkpoint is not resumed with different specs.
+  EXPECT_FALSE(SentencePieceTrainer::Train(
+                   absl::StrCat(args, " --resume_from_checkpoint",
+                                " --shrinking_factor=0.5"))
+                   .ok());
+  EXPECT_FALSE(SentencePieceTrainer::Train(
+                   absl::StrCat("--model_prefix=", model_prefix,
+                                " --input=", input, " --vocab_size=8000",
+                                " --normalization_rule_name=nfkc",
+                                " --model_type=unigram",
+                                " --max_sentence_length=2048",
+                                " --resume_from_checkpoint"))
+                   .ok());
+}
+
+TEST(UnigramTrainerTest, TrainingStatsFileTest) {
+  const std::string input =
+      util::JoinPath(absl::GetFlag(FLAGS_test_srcdir), kTestInputData);
+  const std::string model_prefix =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "tmp_model");
+  const std::string stats_file =
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "stats.jsonl");
+
+  ASSERT_TRUE(
+      SentencePieceTrainer::Train(
+          absl::StrCat("--model_prefix=", model_prefix, " --input=", input,
+                       " --vocab_size=8000 --normalization_rule_name=identity",
+                       " --model_type=unigram --max_sentence_length=2048",
+                       " --training_stats_file=", stats_file))
+          .ok());
+
+  // One line per EM round, in the order of the rounds.
+  auto reader = filesystem::NewReadableFile(stats_file);
+  ASSERT_TRUE(reader->status().ok());
+  std::string line;
+  int round = 0;
+  while (reader->ReadLine(&line)) {
+    EXPECT_TRUE(absl::StartsWith(
+        line, absl::StrCat("{\"side\":\"model\",\"round\":", round) + ","));
+    EXPECT_NE(std::string::npos, line.find("\"peak_rss_bytes\":"));
+    EXPECT_EQ('}', line.back());
+    ++round;
+  }
+  EXPECT_GT(round, 1);
+
+  EXPECT_FALSE(SentencePieceTrainer::Train(
+                   absl::StrCat("--model_prefix=", model_prefix,
+                                " --input=", input, " --vocab_size=1000",
+                                " --model_type=bpe",
+                                " --training_stats_file=", stats_file))
+                   .ok());
+}
+
+// Returns a trainer of one side of the align trainer which has loaded the
+// first |input_sentence_size| sentences of the test data, or all if 0.
+std::unique_ptr<Trainer> MakeSideTrainer(int input_sentence_size) {
+  TrainerSpec trainer_spec;
+  trainer_spec.add_input(
+      util::JoinPath(absl::GetFlag(FLAGS_test_srcdir), kTestInputData));
+  trainer_spec.set_model_prefix(
+      util::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "tmp_model"));
+  trainer_spec.set_vocab_size(8000);
+  trainer_spec.set_max_sentence_length(2048);
+  trainer_spec.set_input_sentence_size(input_sentence_size);
+  trainer_spec.set_shuffle_input_sentence(false);
+  auto trainer = absl::make_unique<Trainer>(
+      trainer_spec, SentencePieceTrainer::GetNormalizerSpec("identity"),
+      NormalizerSpec());
+  EXPECT_TRUE(trainer->LoadSentences().ok());
+  trainer->desired_vocab_size_ = 8800;
+  return trainer;
+}
+
+TEST(UnigramTrainerTest, JointSeedTest) {
+  // Both sides of the same corpus get the same seeds as a single trainer.
+  auto trainer = MakeSideTrainer(0);
+  const auto expected = trainer->MakeSeedSentencePieces<int32>();
+  auto seeds = Trainer::MakeJointSeedSentencePieces<int32>(
+      {trainer.get(), trainer.get()});
+  ASSERT_EQ(2, seeds.size());
+  EXPECT_EQ(expected, seeds[0]);
+  EXPECT_EQ(expected, seeds[1]);
+
+  // Each side counts its own substrings. A substring which branches only
+  // across the sides may be added, so the seeds of each side include the
+  // seeds made from that side alone.
+  auto small_trainer = MakeSideTrainer(500);
+  seeds = Trainer::MakeJointSeedSentencePieces<int64>(
+      {trainer.get(), small_trainer.get()});
+  ASSERT_EQ(2, seeds.size());
+  const auto small_expected = small_trainer->MakeSeedSentencePieces<int32>();
+  EXPECT_LT(small_expected.size(), expected.size());
+  auto contains_all = [](const TrainerModel::SentencePieces &pieces,
+                         const TrainerModel::SentencePieces &subset) {
+    std::set<std::string> keys;
+    for (const auto &p : pieces) keys.insert(p.first);
+    for (const auto &p : subset) {
+      if (keys.count(p.first) == 0) return false;
+    }
+    return true;
+  };
+  EXPECT_TRUE(contains_all(seeds[0], expected));
+  EXPECT_TRUE(contains_all(seeds[1], small_expected));
+  EXPECT_LT(seeds[1].size(), seeds[0].size());
+}
+
+TEST(UnigramTrainerTest, JointPruneTest) {
+  // The target side has fewer sentences than the source side.
+  std::unique_ptr<Trainer> trainers[] = {MakeSideTrainer(0),
+                                         MakeSideTrainer(500)};
+  std::vector<std::unique_ptr<TrainerModel>> models;
+  for (const auto &trainer : trainers) {
+    models.emplace_back(absl::make_unique<TrainerModel>(
+        trainer->trainer_spec_, trainer->normalizer_spec_));
+    models.back()->SetSentencePieces(trainer->MakeSeedSentencePieces<int32>());
+    trainer->SplitSentencesByWhitespace();
+    trainer->RunEMSubIterations(models.back().get());
+  }
+
+  // Pruning both sides jointly gives the same pieces as pruning each side.
+  std::vector<TrainerModel::SentencePieces> expected;
+  for (int i = 0; i < 2; ++i) {
+    expected.push_back(trainers[i]->PruneSentencePieces(*models[i]));
+    EXPECT_LT(expected[i].size(), models[i]->GetPieceSize());
+  }
+  ASSERT_TRUE(SentencePieceAlignTrainer::PruneSentencePiecesJoint(
+                  trainers[0], trainers[1], models[0].get(), models[1].get())
+                  .ok());
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(expected[i], models[i]->GetSentencePieces());
+  }
+}
+
 }  // namespace
 }  // namespace unigram
 }  // namespace sentencepiece
@@ -14,6 +14,11 @@
 
 #include <iostream>
 
+#ifndef OS_WIN
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
 #include "util.h"
 
 namespace sentencepiece {
@@ -220,6 +225,36 @@ std::vector<std::string> StrSplitAsCSV(absl::string_view text) {
 
   return result;
 }
+
+int64 GetCurrentRSS() {
+#ifdef __linux__
+  // The second field of statm is the number of resident pages.
+  FILE *fp = fopen("/proc/self/statm", "r");
+  if (fp == nullptr) return 0;
+  long pages = 0;
+  const bool ok = fscanf(fp, "%*s %ld", &pages) == 1;
+  fclose(fp);
+  return ok ? static_cast<int64>(pages) * sysconf(_SC_PAGESIZE) : 0;
+#else
+  return 0;
+#endif
+}
+
+int64 GetPeakRSS() {
+#ifndef OS_WIN
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+  return static_cast<int64>(usage.ru_maxrss);
+#else
+  // Linux reports ru_maxrss in kilobytes. It is updated lazily and can be
+  // behind the current RSS.
+  return std::max(static_cast<int64>(usage.ru_maxrss) * 1024, GetCurrentRSS());
+#endif
+#else
+  return 0;
+#endif
+}
 }  // namespace util
 
 #ifdef OS_WIN
@@ -19,6 +19,7 @@
 #include <string.h>
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <random>
@@ -110,6 +111,30 @@ inline std::string EncodePOD(const T &value) {
   return s;
 }
 
+// Removes a POD value from the front of |input| and stores it to |result|.
+template <typename T>
+inline bool ConsumePOD(absl::string_view *input, T *result) {
+  if (input->size() < sizeof(T) ||
+      !DecodePOD(input->substr(0, sizeof(T)), result)) {
+    return false;
+  }
+  input->remove_prefix(sizeof(T));
+  return true;
+}
+
+// Encodes |str| prefixed with its length, which is read by ConsumeString.
+inline std::string EncodeString(absl::string_view str) {
+  return EncodePOD<uint32>(str.size()) + std::string(str.data(), str.size());
+}
+
+inline bool ConsumeString(absl::string_view *input, std::string *result) {
+  uint32 size = 0;
+  if (!ConsumePOD(input, &size) || input->size() < size) return false;
+  result->assign(input->data(), size);
+  input->remove_prefix(size);
+  return true;
+}
+
 template <typename T>
 inline std::string IntToHex(T value) {
   std::ostringstream os;
@@ -351,6 +376,27 @@ std::string StrError(int errnum);
 
 std::vector<std::string> StrSplitAsCSV(absl::string_view text);
 
+// Returns the current and the peak resident set size of this process in
+// bytes, or 0 when it is not available on this platform.
+int64 GetCurrentRSS();
+int64 GetPeakRSS();
+
+// Measures the elapsed wall time.
+class Timer {
+ public:
+  Timer() : start_(std::chrono::steady_clock::now()) {}
+
+  // Returns the seconds since the construction.
+  double Get() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start_)
+        .count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
 inline Status OkStatus() { return Status(); }
 
 #define DECLARE_ERROR(FUNC)                                \
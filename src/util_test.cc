@@ -110,6 +110,29 @@ TEST(UtilTest, EncodePODTet) {
   }
 }
 
+TEST(UtilTest, ConsumePODTest) {
+  const std::string tmp = string_util::EncodePOD<int32>(10) +
+                          string_util::EncodeString("foo") +
+                          string_util::EncodePOD<float>(0.5);
+  absl::string_view input(tmp);
+  int32 i = 0;
+  std::string s;
+  float f = 0.0;
+  EXPECT_TRUE(string_util::ConsumePOD(&input, &i));
+  EXPECT_EQ(10, i);
+  EXPECT_TRUE(string_util::ConsumeString(&input, &s));
+  EXPECT_EQ("foo", s);
+  EXPECT_TRUE(string_util::ConsumePOD(&input, &f));
+  EXPECT_EQ(0.5, f);
+  EXPECT_TRUE(input.empty());
+
+  // Truncated data
+  EXPECT_FALSE(string_util::ConsumePOD(&input, &i));
+  input = absl::string_view(tmp).substr(0, 8);
+  EXPECT_TRUE(string_util::ConsumePOD(&input, &i));
+  EXPECT_FALSE(string_util::ConsumeString(&input, &s));
+}
+
 TEST(UtilTest, ItoaTest) {
   auto Itoa = [](int v) {
     char buf[16];
@@ -424,6 +447,15 @@ TEST(UtilTest, ReservoirSamplerTest) {
   EXPECT_EQ(10000, sampler.total_size());
 }
 
+TEST(UtilTest, MemoryUsageTest) {
+#ifdef __linux__
+  EXPECT_GT(util::GetCurrentRSS(), 0);
+  EXPECT_GE(util::GetPeakRSS(), util::GetCurrentRSS());
+#endif
+  util::Timer timer;
+  EXPECT_GE(timer.Get(), 0.0);
+}
+
 TEST(UtilTest, StrSplitAsCSVTest) {
   {
     const auto v = util::StrSplitAsCSV("foo,bar,buz");
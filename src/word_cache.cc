@@ -0,0 +1,49 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "word_cache.h"
+
+#include "metrics.h"
+
+namespace sentencepiece {
+
+WordCache::WordCache(size_t max_bytes) : cache_(max_bytes) {}
+
+WordCache::~WordCache() {}
+
+bool WordCache::Lookup(absl::string_view word, EncodeResult *output) {
+  const bool found =
+      cache_.Lookup(word, [&](const std::vector<Piece> &pieces) {
+        size_t begin = 0;
+        for (const auto &piece : pieces) {
+          output->emplace_back(word.substr(begin, piece.length), piece.id);
+          begin += piece.length;
+        }
+        return true;
+      });
+  SPM_METRICS_ADD(WORD_CACHE_HITS, found);
+  SPM_METRICS_ADD(WORD_CACHE_MISSES, !found);
+  return found;
+}
+
+void WordCache::Insert(absl::string_view word, const EncodeResult &pieces) {
+  std::vector<Piece> value;
+  value.reserve(pieces.size());
+  for (const auto &piece : pieces) {
+    value.push_back({static_cast<uint32>(piece.first.size()), piece.second});
+  }
+  const size_t evictions =
+      cache_.Insert(word, std::move(value), pieces.size() * sizeof(Piece));
+  SPM_METRICS_ADD(WORD_CACHE_EVICTIONS, evictions);
+}
+
+}  // namespace sentencepiece
@@ -0,0 +1,61 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#ifndef WORD_CACHE_H_
+#define WORD_CACHE_H_
+
+#include <vector>
+
+#include "common.h"
+#include "lru_cache.h"
+#include "sentencepiece_processor.h"
+#include "third_party/absl/strings/string_view.h"
+
+namespace sentencepiece {
+
+// A bounded LRU cache from a word to its encoding, shared by the encoding
+// threads.
+class WordCache {
+ public:
+  // |max_bytes| bounds the memory used by the entries.
+  explicit WordCache(size_t max_bytes);
+  ~WordCache();
+
+  WordCache(const WordCache &) = delete;
+  WordCache &operator=(const WordCache &) = delete;
+
+  // Appends the cached encoding of |word| to |output| and returns true.
+  // The pieces are views into |word|. Returns false if not cached.
+  bool Lookup(absl::string_view word, EncodeResult *output);
+
+  // Caches |pieces|, the encoding of |word|. The pieces must be views into
+  // |word| from its beginning to its end.
+  void Insert(absl::string_view word, const EncodeResult &pieces);
+
+  // Removes all the entries. The counters of the statistics are kept.
+  void Clear() { cache_.Clear(); }
+
+  CacheStats GetStats() const { return cache_.GetStats(); }
+
+  size_t max_bytes() const { return cache_.max_bytes(); }
+
+ private:
+  struct Piece {
+    uint32 length;
+    int id;
+  };
+
+  ShardedLruCache<std::vector<Piece>> cache_;
+};
+
+}  // namespace sentencepiece
+#endif  // WORD_CACHE_H_
@@ -0,0 +1,232 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.!
+
+#include "word_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "sentencepiece_model.pb.h"
+#include "sentencepiece_processor.h"
+#include "testharness.h"
+#include "third_party/absl/strings/str_cat.h"
+#include "util.h"
+
+namespace sentencepiece {
+namespace {
+
+EncodeResult MakePieces(absl::string_view word,
+                        const std::vector<std::pair<size_t, int>> &pieces) {
+  EncodeResult result;
+  size_t begin = 0;
+  for (const auto &piece : pieces) {
+    result.emplace_back(word.substr(begin, piece.first), piece.second);
+    begin += piece.first;
+  }
+  return result;
+}
+}  // namespace
+
+TEST(WordCacheTest, LookupTest) {
+  WordCache cache(1 << 20);
+  EncodeResult output;
+  EXPECT_FALSE(cache.Lookup("hello", &output));
+  EXPECT_TRUE(output.empty());
+
+  cache.Insert("hello", MakePieces("hello", {{2, 10}, {3, 20}}));
+  cache.Insert("world", MakePieces("world", {{5, 30}}));
+
+  // The pieces are views into the given word.
+  const std::string text = "hello";
+  EXPECT_TRUE(cache.Lookup(text, &output));
+  EXPECT_TRUE(cache.Lookup("world", &output));
+  ASSERT_EQ(3, output.size());
+  EXPECT_EQ("he", output[0].first);
+  EXPECT_EQ(text.data(), output[0].first.data());
+  EXPECT_EQ(10, output[0].second);
+  EXPECT_EQ("llo", output[1].first);
+  EXPECT_EQ(20, output[1].second);
+  EXPECT_EQ("world", output[2].first);
+  EXPECT_EQ(30, output[2].second);
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(0, stats.evictions);
+  EXPECT_EQ(2, stats.entries);
+  EXPECT_LT(0, stats.bytes);
+  EXPECT_NEAR(2.0 / 3, stats.hit_rate(), 0.001);
+
+  // The counters are kept.
+  cache.Clear();
+  EXPECT_FALSE(cache.Lookup("hello", &output));
+  stats = cache.GetStats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+  EXPECT_EQ(0, stats.entries);
+  EXPECT_EQ(0, stats.bytes);
+}
+
+TEST(WordCacheTest, EvictionTest) {
+  WordCache cache(32 * 1024);
+  std::vector<std::string> words;
+  for (int i = 0; i < 10000; ++i) words.push_back(absl::StrCat("word", i));
+  for (const auto &word : words) {
+    cache.Insert(word, MakePieces(word, {{4, 1}, {word.size() - 4, 2}}));
+  }
+
+  auto stats = cache.GetStats();
+  EXPECT_LE(stats.bytes, cache.max_bytes());
+  EXPECT_LT(0, stats.entries);
+  EXPECT_EQ(words.size(), stats.entries + stats.evictions);
+
+  // The recent words are kept.
+  EncodeResult output;
+  EXPECT_TRUE(cache.Lookup(words.back(), &output));
+  EXPECT_FALSE(cache.Lookup(words.front(), &output));
+
+  // Too large to cache.
+  WordCache small(16);
+  small.Insert("hello", MakePieces("hello", {{5, 1}}));
+  EXPECT_FALSE(small.Lookup("hello", &output));
+}
+
+TEST(WordCacheTest, ThreadTest) {
+  WordCache cache(64 * 1024);
+  std::vector<std::string> words;
+  for (int i = 0; i < 1000; ++i) words.push_back(absl::StrCat("w", i));
+
+  std::vector<int> num_errors(8, 0);
+  {
+    ThreadPool pool(8);
+    for (int n = 0; n < 8; ++n) {
+      pool.Schedule([&, n]() {
+        for (int i = 0; i < 20000; ++i) {
+          const auto &word = words[(i * (n + 1)) % words.size()];
+          EncodeResult output;
+          if (cache.Lookup(word, &output)) {
+            if (output.size() != 1 || output[0].first != word ||
+                output[0].second != static_cast<int>(word.size())) {
+              ++num_errors[n];
+            }
+          } else {
+            const int id = word.size();
+            cache.Insert(word, MakePieces(word, {{word.size(), id}}));
+          }
+        }
+      });
+    }
+  }
+
+  for (const int n : num_errors) EXPECT_EQ(0, n);
+  const auto stats = cache.GetStats();
+  EXPECT_EQ(8 * 20000, stats.hits + stats.misses);
+}
+
+TEST(WordCacheTest, ProcessorTest) {
+  const auto lines = test::ReadLines("botchan.txt");
+  for (const char *model_type : {"unigram", "bpe"}) {
+    const std::string model = test::TrainModel(
+        "botchan.txt", absl::StrCat("word_cache_", model_type),
+        absl::StrCat("--vocab_size=1000 --model_type=", model_type));
+
+    SentencePieceProcessor expected;
+    ASSERT_TRUE(expected.Load(model).ok());
+
+    SentencePieceProcessor sp;
+    EXPECT_FALSE(sp.SetWordCacheSize(1 << 20).ok());
+    EXPECT_EQ(0, sp.GetWordCacheStats().hits);
+    ASSERT_TRUE(sp.Load(model).ok());
+    ASSERT_TRUE(sp.SetWordCacheSize(1 << 20).ok());
+    for (const auto &line : lines) {
+      const auto ids_uncached = expected.EncodeAsIds(line);
+      const auto ids_cached = sp.EncodeAsIds(line);
+      EXPECT_EQ(ids_uncached, ids_cached);
+    }
+
+    // Unigram does not use the cache.
+    auto stats = sp.GetWordCacheStats();
+    if (std::string(model_type) == "unigram") {
+      EXPECT_EQ(0, stats.hits + stats.misses);
+      continue;
+    }
+    EXPECT_LT(stats.misses, stats.hits);
+    EXPECT_LT(0, stats.entries);
+
+    // The vocabulary changes the encodings.
+    ASSERT_TRUE(sp.SetVocabulary({"▁the", "▁a"}).ok());
+    ASSERT_TRUE(expected.SetVocabulary({"▁the", "▁a"}).ok());
+    EXPECT_EQ(0, sp.GetWordCacheStats().entries);
+    for (size_t i = 0; i < 100; ++i) {
+      EXPECT_EQ(expected.EncodeAsIds(lines[i]), sp.EncodeAsIds(lines[i]));
+    }
+    ASSERT_TRUE(sp.ResetVocabulary().ok());
+    ASSERT_TRUE(expected.ResetVocabulary().ok());
+    EXPECT_EQ(0, sp.GetWordCacheStats().entries);
+
+    // Disabled.
+    ASSERT_TRUE(sp.SetWordCacheSize(0).ok());
+    EXPECT_EQ(0, sp.GetWordCacheStats().hits);
+    EXPECT_EQ(expected.EncodeAsIds(lines[0]), sp.EncodeAsIds(lines[0]));
+  }
+}
+
+TEST(WordCacheTest, UnsafeModelTest) {
+  ModelProto model_proto;
+  model_proto.mutable_trainer_spec()->set_model_type(TrainerSpec::BPE);
+  auto *unk = model_proto.add_pieces();
+  unk->set_type(ModelProto::SentencePiece::UNKNOWN);
+  unk->set_piece("<unk>");
+  for (const char *piece : {"a", "b", "▁", "▁a", "ab"}) {
+    auto *sp = model_proto.add_pieces();
+    sp->set_piece(piece);
+    sp->set_score(0.0);
+  }
+
+  SentencePieceProcessor sp;
+  ASSERT_TRUE(sp.Load(model_proto).ok());
+  ASSERT_TRUE(sp.SetWordCacheSize(1 << 20).ok());
+  sp.EncodeAsIds("a ab");
+  EXPECT_LT(0, sp.GetWordCacheStats().misses);
+
+  // A piece spans over a whitespace.
+  model_proto.add_pieces()->set_piece("a▁a");
+  ASSERT_TRUE(sp.Load(model_proto).ok());
+  ASSERT_TRUE(sp.SetWordCacheSize(1 << 20).ok());
+  sp.EncodeAsIds("a ab");
+  EXPECT_EQ(0, sp.GetWordCacheStats().misses);
+
+  // Pieces are not split by whitespaces.
+  model_proto.mutable_pieces()->RemoveLast();
+  model_proto.mutable_trainer_spec()->set_split_by_whitespace(false);
+  ASSERT_TRUE(sp.Load(model_proto).ok());
+  ASSERT_TRUE(sp.SetWordCacheSize(1 << 20).ok());
+  sp.EncodeAsIds("a ab");
+  EXPECT_EQ(0, sp.GetWordCacheStats().misses);
+
+  // Unigram model.
+  model_proto.mutable_trainer_spec()->set_split_by_whitespace(true);
+  model_proto.mutable_trainer_spec()->set_model_type(TrainerSpec::UNIGRAM);
+  ASSERT_TRUE(sp.Load(model_proto).ok());
+  ASSERT_TRUE(sp.SetWordCacheSize(1 << 20).ok());
+  sp.EncodeAsIds("a ab");
+  EXPECT_EQ(0, sp.GetWordCacheStats().misses);
+
+  // Character model.
+  model_proto.mutable_trainer_spec()->set_model_type(TrainerSpec::CHAR);
+  ASSERT_TRUE(sp.Load(model_proto).ok());
+  ASSERT_TRUE(sp.SetWordCacheSize(1 << 20).ok());
+  sp.EncodeAsIds("a ab");
+  EXPECT_EQ(0, sp.GetWordCacheStats().misses);
+}
+
+}  // namespace sentencepiece
@@ -33,7 +33,7 @@ util::Status Trainer::Train() {
   RETURN_IF_ERROR(LoadSentences());
 
   absl::flat_hash_map<std::string, uint64> freq;
-  for (const auto &it : sentences_) {
+  for (const auto &it : *sentences_) {
     for (const auto &s : SplitIntoWords(it.first)) {
       freq[std::string(s)] += it.second;
     }